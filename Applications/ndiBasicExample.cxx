@@ -3,56 +3,6 @@
 #include <cstring>
 
 #include <iostream>
-#if _MSC_VER >= 1700
-  #include <vector>
-  #include <algorithm>
-  #include <future>
-#endif
-
-#if _MSC_VER >= 1700
-//----------------------------------------------------------------------------
-bool ParallelProbe(ndicapi*& outDevice, bool checkDSR)
-{
-  const int MAX_SERIAL_PORT_NUMBER = 20; // the serial port is almost surely less than this number
-  std::vector<bool> deviceExists(MAX_SERIAL_PORT_NUMBER);
-  std::fill(begin(deviceExists), end(deviceExists), false);
-  std::vector<std::future<void>> tasks;
-  std::mutex deviceNameMutex;
-  for (int i = 0; i < MAX_SERIAL_PORT_NUMBER; i++)
-  {
-    std::future<void> result = std::async([i, &deviceNameMutex, &deviceExists]()
-    {
-      std::string devName;
-      {
-        std::lock_guard<std::mutex> guard(deviceNameMutex);
-        devName = std::string(ndiSerialDeviceName(i));
-      }
-      int errnum = ndiSerialProbe(devName.c_str(),checkDSR);
-      if (errnum == NDI_OKAY)
-      {
-        deviceExists[i] = true;
-      }
-    });
-    tasks.push_back(std::move(result));
-  }
-  for (int i = 0; i < MAX_SERIAL_PORT_NUMBER; i++)
-  {
-    tasks[i].wait();
-  }
-  for (int i = 0; i < MAX_SERIAL_PORT_NUMBER; i++)
-  {
-    // use first device found
-    if (deviceExists[i] == true)
-    {
-      char* devicename = ndiSerialDeviceName(i);
-      outDevice = ndiOpenSerial(devicename);
-      return true;
-    }
-  }
-
-  return false;
-}
-#endif
 
 struct ndicapi;
 
@@ -61,27 +11,18 @@ int main(int argc, char * argv[])
   bool checkDSR = false;
   ndicapi* device(nullptr);
   const char* name(nullptr);
+  ndiSerialProbeResult found;
 
   if(argc > 1)
     name = argv[1];
   else
   {
-#if _MSC_VER >= 1700
-    ParallelProbe(device,argc > 1 ? argv[1]: 0, checkDSR);
-#else
+    // probe all serial ports at once, starting with where the device was last time
+    if (ndiSerialProbeAll(&found, 1, checkDSR, 2000) > 0)
     {
-      const int MAX_SERIAL_PORTS = 20;
-      for (int i = 0; i < MAX_SERIAL_PORTS; ++i)
-      {
-        name = ndiSerialDeviceName(i);
-        int result = ndiSerialProbe(name,checkDSR);
-        if (result == NDI_OKAY)
-        {
-          break;
-        }
-      }
+      std::cout << "Found " << found.Firmware << " on " << found.Device << std::endl;
+      name = found.Device;
     }
-#endif
   }
 
   if (name != nullptr)
@@ -0,0 +1,177 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check that the components of a BX2 reply are decoded when they are
+// asked for, when lazy decoding is on, and only if they are in the mask.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // A 3D component that says it has more markers than it holds
+  std::string BadMarkers()
+  {
+    std::string items;
+    ndiTestPut16(items, 1);
+    ndiTestPut16(items, 5);
+    items += std::string(16, '\0');
+    return ndiTestComponent(NDI_COMPONENTID_3D, 0, 1, items);
+  }
+
+  //----------------------------------------------------------------------------
+  // A reply with a passive frame and an active frame, each with one tool
+  std::string TwoFrames(const std::string& extra)
+  {
+    std::vector<std::string> passive;
+    passive.push_back(ndiTestTool(1, 1));
+    passive.push_back(extra);
+    std::vector<std::string> active;
+    active.push_back(ndiTestTool(1, 2));
+    std::vector<std::string> frames;
+    frames.push_back(ndiTestFrame(NDI_BX2_FRAME_PASSIVE, 10, passive));
+    frames.push_back(ndiTestFrame(NDI_BX2_FRAME_ACTIVE, 11, active));
+    return ndiTestBinaryReply(ndiTestGBF(frames));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestLazy(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiSetBX2LazyDecoding(pol, true);
+
+    // the 3D component is only read when it is asked for
+    ndiTestQueueReply(device, TwoFrames(BadMarkers()));
+    ndiCommand(pol, "BX2 --6d=tools --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 2);
+    NDI_TEST_CHECK(pol->Bx2PendingComponents & NDI_BX2_DECODE_6D);
+
+    float transform[8];
+    NDI_TEST_CHECK(ndiGetBX2Transform(pol, 1, transform) == NDI_OKAY);
+    NDI_TEST_CHECK(transform[4] == 2);
+    NDI_TEST_CHECK((pol->Bx2PendingComponents & NDI_BX2_DECODE_6D) == 0);
+
+    // each frame keeps its own pending components
+    NDI_TEST_CHECK(ndiSelectBX2Frame(pol, 0) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2Transform(pol, 1, transform) == NDI_OKAY);
+    NDI_TEST_CHECK(transform[4] == 1);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2NumberOf3Ds(pol, 1) == 0);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+
+    // without lazy decoding the same reply is rejected as it arrives
+    ndiSetBX2LazyDecoding(pol, false);
+    ndiTestQueueReply(device, TwoFrames(BadMarkers()));
+    ndiCommand(pol, "BX2 --6d=tools --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 0);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestMask(ndicapi* pol, ndiTestDevice* device)
+  {
+    NDI_TEST_CHECK(ndiGetBX2DecodeMask(pol) == NDI_BX2_DECODE_ALL);
+
+    // components that are not in the mask are skipped without being read
+    ndiSetBX2DecodeMask(pol, NDI_BX2_DECODE_6D);
+    NDI_TEST_CHECK(ndiGetBX2DecodeMask(pol) == NDI_BX2_DECODE_6D);
+    std::vector<std::pair<int, int> > alerts(1, std::make_pair(NDI_SYS_ALERT_FAULT, 3));
+    ndiTestQueueReply(device, TwoFrames(ndiTestAlerts(alerts)));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiSelectBX2Frame(pol, 0) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2SystemAlertsCount(pol) == 0);
+    float transform[8];
+    NDI_TEST_CHECK(ndiGetBX2Transform(pol, 1, transform) == NDI_OKAY);
+
+    ndiTestQueueReply(device, TwoFrames(BadMarkers()));
+    ndiCommand(pol, "BX2 --6d=tools --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 2);
+    NDI_TEST_CHECK(ndiGetBX2NumberOf3Ds(pol, 1) == 0);
+
+    // the frames are still decoded when 6D is not in the mask
+    ndiSetBX2DecodeMask(pol, NDI_BX2_DECODE_SYS_ALERT);
+    ndiTestQueueReply(device, TwoFrames(ndiTestAlerts(alerts)));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 2);
+    NDI_TEST_CHECK(ndiGetBX2Transform(pol, 1, transform) == NDI_DISABLED);
+    NDI_TEST_CHECK(ndiSelectBX2Frame(pol, 0) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2Frame(pol) == 10);
+    NDI_TEST_CHECK(ndiGetBX2SystemAlertsCount(pol) == 1);
+
+    ndiSetBX2DecodeMask(pol, NDI_BX2_DECODE_ALL);
+  }
+
+  //----------------------------------------------------------------------------
+  // A reply with an active frame that has alerts and a pressed button
+  std::string EventFrame(unsigned int frameNumber, int code, char pressed)
+  {
+    std::vector<std::string> components;
+    components.push_back(ndiTestTool(1, 1));
+    components.push_back(ndiTestButtons(1, std::string(1, pressed)));
+    components.push_back(ndiTestAlerts(std::vector<std::pair<int, int> >(1, std::make_pair(NDI_SYS_ALERT_ALERT, code))));
+    std::vector<std::string> frames(1, ndiTestFrame(NDI_BX2_FRAME_ACTIVE, frameNumber, components));
+    return ndiTestBinaryReply(ndiTestGBF(frames));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestLazyEvents(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiSetBX2LazyDecoding(pol, true);
+
+    // the alerts and buttons stay undecoded while events are not used
+    unsigned int events = NDI_BX2_DECODE_SYS_ALERT | NDI_BX2_DECODE_1D;
+    ndiTestQueueReply(device, EventFrame(40, 1, 1));
+    ndiCommand(pol, "BX2 --6d=tools --1d=buttons");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK((pol->Bx2PendingComponents & events) == events);
+
+    ndiAlertEvent alert;
+    ndiButtonEvent button;
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 0);
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 0);
+
+    // once they are, each reply is decoded for its edges
+    ndiTestQueueReply(device, EventFrame(41, 2, 1));
+    ndiCommand(pol, "BX2 --6d=tools --1d=buttons");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK((pol->Bx2PendingComponents & events) == 0);
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 1 && alert.Onset == 1 && alert.Code == 2 && alert.FrameNumber == 41);
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 1 && button.Pressed == 1 && button.FrameNumber == 41);
+
+    ndiTestQueueReply(device, EventFrame(42, 2, 0));
+    ndiCommand(pol, "BX2 --6d=tools --1d=buttons");
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 0);
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 1 && button.Pressed == 0 && button.FrameNumber == 42);
+    NDI_TEST_CHECK(ndiGetAlertEventsDropped(pol) == 0 && ndiGetButtonEventsDropped(pol) == 0);
+
+    ndiSetBX2LazyDecoding(pol, false);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestLazy(pol, &device);
+  TestMask(pol, &device);
+  TestLazyEvents(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
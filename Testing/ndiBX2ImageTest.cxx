@@ -0,0 +1,128 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check the sensor images and UV spots of BX2 replies, and the ring that
+// keeps copies of the latest images.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // An image component with one 4 x 2 image, each pixel set to 'value'
+  std::string Image(unsigned int bytesPerPixel, char value)
+  {
+    std::string items;
+    ndiTestPut16(items, 0);
+    ndiTestPut16(items, bytesPerPixel);
+    ndiTestPut32(items, 4);
+    ndiTestPut32(items, 2);
+    items += std::string(4 * 2 * bytesPerPixel, value);
+    return ndiTestComponent(NDI_COMPONENTID_IMAGE, 0, 1, items);
+  }
+
+  //----------------------------------------------------------------------------
+  // A UV component with two spots seen by sensor 1
+  std::string Spots()
+  {
+    std::string items;
+    ndiTestPut16(items, 1);
+    ndiTestPut16(items, 2);
+    float spots[6] = { 10, 20, 0.5f, 30, 40, 0.75f };
+    for (int i = 0; i < 6; i++)
+    {
+      ndiTestPutFloat(items, spots[i]);
+    }
+    return ndiTestComponent(NDI_COMPONENTID_UV, 0, 1, items);
+  }
+
+  //----------------------------------------------------------------------------
+  std::string Reply(unsigned int frameNumber, const std::vector<std::string>& components)
+  {
+    std::vector<std::string> frames(1, ndiTestFrame(NDI_BX2_FRAME_BACKGROUND, frameNumber, components));
+    return ndiTestBinaryReply(ndiTestGBF(frames));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestViews(ndicapi* pol, ndiTestDevice* device)
+  {
+    std::vector<std::string> components;
+    components.push_back(Image(2, 7));
+    components.push_back(Spots());
+    ndiTestQueueReply(device, Reply(50, components));
+    ndiCommand(pol, "BX2 --sensor=all");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    NDI_TEST_CHECK(ndiGetBX2NumberOfImages(pol) == 1);
+    const ndiBX2Image* image = ndiGetBX2Image(pol, 0);
+    NDI_TEST_CHECK(image != NULL && image->Width == 4 && image->Height == 2 && image->BytesPerPixel == 2);
+    NDI_TEST_CHECK(image != NULL && image->Size == 16 && image->FrameNumber == 50 && image->Pixels[15] == 7);
+    NDI_TEST_CHECK(ndiGetBX2Image(pol, 1) == NULL);
+
+    NDI_TEST_CHECK(ndiGetBX2NumberOfUVs(pol) == 1);
+    const ndiBX2UV* uv = ndiGetBX2UV(pol, 0);
+    NDI_TEST_CHECK(uv != NULL && uv->Sensor == 1 && uv->SpotCount == 2);
+    float values[3];
+    NDI_TEST_CHECK(uv != NULL && ndiGetBX2UVSpot(uv, 1, values) == NDI_OKAY);
+    NDI_TEST_CHECK(values[0] == 30 && values[1] == 40 && values[2] == 0.75f);
+    NDI_TEST_CHECK(uv != NULL && ndiGetBX2UVSpot(uv, 2, values) == NDI_DISABLED);
+
+    // more than 4 bytes per pixel
+    ndiTestQueueReply(device, Reply(51, std::vector<std::string>(1, Image(5, 0))));
+    ndiCommand(pol, "BX2 --sensor=all");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    NDI_TEST_CHECK(ndiGetBX2NumberOfImages(pol) == 0);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestRing(ndicapi* pol, ndiTestDevice* device)
+  {
+    NDI_TEST_CHECK(ndiSetBX2ImageRing(pol, -1) == NDI_DISABLED);
+    NDI_TEST_CHECK(ndiSetBX2ImageRing(pol, 2) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2RingImage(pol, 0) == NULL);
+
+    for (int i = 0; i < 3; i++)
+    {
+      ndiTestQueueReply(device, Reply(60 + i, std::vector<std::string>(1, Image(1, (char)i))));
+      ndiCommand(pol, "BX2 --sensor=all");
+      NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    }
+
+    // the ring images are copies, they outlive the reply
+    ndiCommand(pol, "BEEP:1");
+    const ndiBX2Image* latest = ndiGetBX2RingImage(pol, 0);
+    const ndiBX2Image* before = ndiGetBX2RingImage(pol, 1);
+    NDI_TEST_CHECK(latest != NULL && latest->FrameNumber == 62 && latest->Size == 8 && latest->Pixels[7] == 2);
+    NDI_TEST_CHECK(before != NULL && before->FrameNumber == 61 && before->Pixels[0] == 1);
+    NDI_TEST_CHECK(ndiGetBX2RingImage(pol, 2) == NULL);
+
+    // changing the depth empties the ring
+    NDI_TEST_CHECK(ndiSetBX2ImageRing(pol, 4) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2RingImage(pol, 0) == NULL);
+    NDI_TEST_CHECK(ndiSetBX2ImageRing(pol, 0) == NDI_OKAY);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestViews(pol, &device);
+  TestRing(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,116 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check that the frames of BX2 replies are split into one stream per
+// frame type, with callbacks, a history and statistics for each.
+
+#include "ndiTestDevice.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // The frame numbers that a stream callback saw
+  void Collect(ndicapi* pol, int frameType, void* userdata)
+  {
+    std::vector<unsigned int>* frames = (std::vector<unsigned int>*)userdata;
+    frames->push_back(ndiGetBX2Frame(pol));
+  }
+
+  //----------------------------------------------------------------------------
+  // A frame with one tool at (x, 0, 0)
+  std::string ToolFrame(int frameType, unsigned int frameNumber, float x, unsigned int seconds = 0, unsigned int nanoseconds = 0)
+  {
+    return ndiTestFrame(frameType, frameNumber, std::vector<std::string>(1, ndiTestTool(1, x)), seconds, nanoseconds);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestCallbacks(ndicapi* pol, ndiTestDevice* device)
+  {
+    std::vector<unsigned int> passive;
+    std::vector<unsigned int> active;
+    NDI_TEST_CHECK(ndiAddBX2StreamCallback(pol, NDI_BX2_FRAME_PASSIVE, &Collect, &passive) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiAddBX2StreamCallback(pol, NDI_BX2_FRAME_ACTIVE, &Collect, &active) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiAddBX2StreamCallback(pol, NDI_BX2_FRAME_TYPE_COUNT, &Collect, &active) == NDI_DISABLED);
+
+    // each callback sees the frames of its type, in reply order
+    std::vector<std::string> frames;
+    frames.push_back(ToolFrame(NDI_BX2_FRAME_PASSIVE, 10, 1));
+    frames.push_back(ToolFrame(NDI_BX2_FRAME_ACTIVE, 11, 2));
+    frames.push_back(ToolFrame(NDI_BX2_FRAME_PASSIVE, 12, 3));
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(frames)));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(passive.size() == 2 && passive[0] == 10 && passive[1] == 12);
+    NDI_TEST_CHECK(active.size() == 1 && active[0] == 11);
+
+    NDI_TEST_CHECK(ndiRemoveBX2StreamCallback(pol, NDI_BX2_FRAME_PASSIVE, &Collect, &passive) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiRemoveBX2StreamCallback(pol, NDI_BX2_FRAME_ACTIVE, &Collect, &active) == NDI_OKAY);
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(frames)));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(passive.size() == 2 && active.size() == 1);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestHistory(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiResetBX2Stream(pol, NDI_BX2_FRAME_PASSIVE);
+    NDI_TEST_CHECK(ndiSetBX2StreamHistory(pol, NDI_BX2_FRAME_PASSIVE, 2) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2StreamFrame(pol, NDI_BX2_FRAME_PASSIVE, 0) == NULL);
+
+    // one passive frame every 100 milliseconds, each in its own reply
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      std::vector<std::string> frames;
+      frames.push_back(ToolFrame(NDI_BX2_FRAME_PASSIVE, 20 + i, 5.0f + i, 7, i * 100000000));
+      frames.push_back(ToolFrame(NDI_BX2_FRAME_ACTIVE, 30 + i, 0));
+      ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(frames)));
+      ndiCommand(pol, "BX2 --6d=tools");
+      NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    }
+
+    // the frames are kept after the reply that held them is gone
+    const ndiFrame* latest = ndiGetBX2StreamFrame(pol, NDI_BX2_FRAME_PASSIVE, 0);
+    const ndiFrame* before = ndiGetBX2StreamFrame(pol, NDI_BX2_FRAME_PASSIVE, 1);
+    NDI_TEST_CHECK(latest != NULL && latest->FrameNumber == 22 && latest->ToolCount == 1 && latest->Transforms[4][0] == 7);
+    NDI_TEST_CHECK(before != NULL && before->FrameNumber == 21 && before->Transforms[4][0] == 6);
+    NDI_TEST_CHECK(ndiGetBX2StreamFrame(pol, NDI_BX2_FRAME_PASSIVE, 2) == NULL);
+    NDI_TEST_CHECK(ndiGetBX2StreamFrame(pol, NDI_BX2_FRAME_ACTIVE, 0) == NULL);
+
+    ndiBX2StreamStats stats;
+    NDI_TEST_CHECK(ndiGetBX2StreamStats(pol, NDI_BX2_FRAME_PASSIVE, &stats) == NDI_OKAY);
+    NDI_TEST_CHECK(stats.FrameCount == 3 && stats.LastFrameNumber == 22);
+    NDI_TEST_CHECK(stats.LastTimestampSeconds == 7 && stats.LastTimestampNanoseconds == 200000000);
+    NDI_TEST_CHECK(fabs(stats.FrameRate - 10) < 0.01);
+    NDI_TEST_CHECK(ndiGetBX2StreamStats(pol, -1, &stats) == NDI_DISABLED);
+
+    ndiResetBX2Stream(pol, NDI_BX2_FRAME_PASSIVE);
+    NDI_TEST_CHECK(ndiGetBX2StreamStats(pol, NDI_BX2_FRAME_PASSIVE, &stats) == NDI_OKAY);
+    NDI_TEST_CHECK(stats.FrameCount == 0);
+    NDI_TEST_CHECK(ndiGetBX2StreamFrame(pol, NDI_BX2_FRAME_PASSIVE, 0) == NULL);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestCallbacks(pol, &device);
+  TestHistory(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,155 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check that a binary reply is passed to a stream callback a piece at a
+// time, and that a stopped or damaged reply is read to its end.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // The pieces that a stream callback saw, and when it should stop
+  struct Pieces
+  {
+    std::string Data;
+    int Count = 0;
+    int StopAfter = 0;                    // zero to never stop
+    unsigned int Received = 0;
+    unsigned int Total = 0;
+  };
+
+  //----------------------------------------------------------------------------
+  int Collect(const char* data, int length, unsigned int received, unsigned int total, void* userdata)
+  {
+    Pieces* pieces = (Pieces*)userdata;
+    pieces->Data.append(data, length);
+    pieces->Count++;
+    pieces->Received = received;
+    pieces->Total = total;
+    return (pieces->Count == pieces->StopAfter ? 1 : 0);
+  }
+
+  //----------------------------------------------------------------------------
+  // A log that is longer than one read of the receive buffer
+  std::string Log()
+  {
+    std::string log;
+    for (int i = 0; i < 10000; i++)
+    {
+      log += (char)(i % 251);
+    }
+    return log;
+  }
+
+  //----------------------------------------------------------------------------
+  void Encode(ndiEncodedCommand* command)
+  {
+    ndiEncodeBegin(command, "GETLOG", ':');
+    ndiEncodeString(command, "sys.log", 0);
+    ndiEncodeEnd(command);
+  }
+
+  //----------------------------------------------------------------------------
+  // The device must still answer the next command as usual
+  bool NextCommandWorks(ndicapi* pol)
+  {
+    ndiCommand(pol, "BEEP:1");
+    return (ndiGetError(pol) == NDI_OKAY);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestWhole(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiEncodedCommand command;
+    Encode(&command);
+
+    Pieces pieces;
+    ndiTestQueueReply(device, ndiTestBinaryReply(Log()));
+    NDI_TEST_CHECK(ndiCommandStream(pol, &command, &Collect, &pieces) == NDI_OKAY);
+    NDI_TEST_CHECK(pieces.Data == Log());
+    NDI_TEST_CHECK(pieces.Count > 1);
+    NDI_TEST_CHECK(pieces.Received == 10000 && pieces.Total == 10000);
+    NDI_TEST_CHECK(NextCommandWorks(pol));
+
+    // a buffer that is too small stops the transfer
+    char data[100];
+    ndiStreamBuffer buffer = { data, sizeof(data), 0 };
+    ndiTestQueueReply(device, ndiTestBinaryReply(Log()));
+    NDI_TEST_CHECK(ndiCommandStream(pol, &command, &ndiStreamToBuffer, &buffer) == NDI_STREAM_STOPPED);
+    NDI_TEST_CHECK(buffer.Length == 0);
+    NDI_TEST_CHECK(NextCommandWorks(pol));
+
+    // an error reply is not passed to the callback
+    pieces = Pieces();
+    ndiTestQueueReply(device, ndiTestAsciiReply("ERROR03"));
+    NDI_TEST_CHECK(ndiCommandStream(pol, &command, &Collect, &pieces) == 0x03);
+    NDI_TEST_CHECK(ndiGetError(pol) == 0x03 && pieces.Count == 0);
+    NDI_TEST_CHECK(NextCommandWorks(pol));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestStop(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiEncodedCommand command;
+    Encode(&command);
+
+    Pieces pieces;
+    pieces.StopAfter = 1;
+    ndiTestQueueReply(device, ndiTestBinaryReply(Log()));
+    NDI_TEST_CHECK(ndiCommandStream(pol, &command, &Collect, &pieces) == NDI_STREAM_STOPPED);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_STREAM_STOPPED);
+    NDI_TEST_CHECK(pieces.Count == 1 && pieces.Data.size() < 10000);
+
+    // the rest of the reply was thrown away
+    NDI_TEST_CHECK(NextCommandWorks(pol));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestCRC(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiEncodedCommand command;
+    Encode(&command);
+
+    // the data is passed on, and the bad CRC is only seen at the end
+    Pieces pieces;
+    std::string reply = ndiTestBinaryReply(Log());
+    reply[reply.size() - 1] ^= 0x55;
+    ndiTestQueueReply(device, reply);
+    NDI_TEST_CHECK(ndiCommandStream(pol, &command, &Collect, &pieces) == NDI_BAD_CRC);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_CRC);
+    NDI_TEST_CHECK(pieces.Data == Log());
+    NDI_TEST_CHECK(NextCommandWorks(pol));
+
+    // a command that could not be encoded is not sent
+    std::vector<std::string>::size_type sent = ndiTestCommands(device).size();
+    command.Length = -1;
+    NDI_TEST_CHECK(ndiCommandStream(pol, &command, &Collect, &pieces) == NDI_COMMAND_TOO_LONG);
+    NDI_TEST_CHECK(ndiTestCommands(device).size() == sent);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestWhole(pol, &device);
+  TestStop(pol, &device);
+  TestCRC(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
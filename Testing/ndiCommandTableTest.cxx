@@ -0,0 +1,129 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check that commands are told apart by the hashed command table: which
+// replies are binary, which helpers are called, and which commands are
+// replayed after a reconnect.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // A command that is answered with a binary reply, which is a BX reply
+  // without handles or a BX2 reply without components
+  bool IsBinary(ndicapi* pol, ndiTestDevice* device, const char* command)
+  {
+    std::string body = (command[2] == '2' ? ndiTestGBF(std::vector<std::string>()) : std::string(3, '\0'));
+    ndiTestQueueReply(device, ndiTestBinaryReply(body));
+    ndiCommand(pol, command);
+    return (ndiGetError(pol) == NDI_OKAY);
+  }
+
+  //----------------------------------------------------------------------------
+  // A command that is answered with an ASCII reply
+  bool IsAscii(ndicapi* pol, ndiTestDevice* device, const char* command)
+  {
+    ndiTestQueueReply(device, ndiTestAsciiReply("OKAY"));
+    ndiCommand(pol, command);
+    return (ndiGetError(pol) == NDI_OKAY);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestLookup(ndicapi* pol, ndiTestDevice* device)
+  {
+    NDI_TEST_CHECK(IsBinary(pol, device, "BX:0001"));
+    NDI_TEST_CHECK(IsBinary(pol, device, "BX2 --6d=none"));
+    NDI_TEST_CHECK(IsBinary(pol, device, "GETLOG:0"));
+    NDI_TEST_CHECK(IsBinary(pol, device, "VGET:0"));
+
+    // mnemonics that share a prefix with a binary command
+    NDI_TEST_CHECK(IsAscii(pol, device, "B:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "BX22:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "GETLO:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "VGETS:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "bx:0001"));
+
+    // mnemonics that fall into the hash slot of a binary command
+    NDI_TEST_CHECK(IsAscii(pol, device, "AC:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "EU:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "CE:"));
+    NDI_TEST_CHECK(IsAscii(pol, device, "BF:"));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestHelpers(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiTestQueueReply(device, ndiTestAsciiReply("020A0010B031"));
+    ndiCommand(pol, "PHSR:00");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetPHSRNumberOfHandles(pol) == 2);
+    NDI_TEST_CHECK(ndiGetPHSRHandle(pol, 1) == 0x0B);
+
+    // the helper is not called for a command that only starts the same way
+    ndiTestQueueReply(device, ndiTestAsciiReply("01FF000"));
+    ndiCommand(pol, "PHSRX:00");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetPHSRNumberOfHandles(pol) == 2);
+
+    ndiCommand(pol, "TSTART:");
+    NDI_TEST_CHECK(pol->IsTracking);
+    ndiCommand(pol, "TSTOP:");
+    NDI_TEST_CHECK(!pol->IsTracking);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestSession(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiSetReconnectMode(pol, true);
+    ndiCommand(pol, "INIT:");
+    ndiCommand(pol, "PHRQ:*********1****");
+    ndiCommand(pol, "PINIT:01");
+    ndiCommand(pol, "PHINF:01");
+    ndiCommand(pol, "IRATE:1");
+    ndiCommand(pol, "BEEP:1");
+    ndiCommand(pol, "PENA:01D");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    size_t dropped = ndiTestCommands(device).size();
+    ndiTestDrop(device);
+    ndiCommand(pol, "APIREV:");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetReconnectCount(pol) == 1);
+
+    // only the commands that configure the device are replayed
+    std::vector<std::string> commands = ndiTestCommands(device);
+    std::string replayed;
+    for (size_t i = dropped; i < commands.size(); i++)
+    {
+      replayed += commands[i].substr(0, commands[i].find_first_of(": ")) + " ";
+    }
+    NDI_TEST_CHECK(replayed == "TSTOP INIT PHRQ PINIT IRATE PENA APIREV ");
+    ndiSetReconnectMode(pol, false);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestLookup(pol, &device);
+  TestHelpers(pol, &device);
+  TestSession(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,138 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Drop the link to a device in memory, and check that the session is
+// restored, both for a command and for the tracking thread.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // A BX reply with no handles, that takes about a frame to arrive
+  std::string BXReply(const std::string& command)
+  {
+    if (command.compare(0, 2, "BX") != 0)
+    {
+      return ndiTestAsciiReply("OKAY");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::string body;
+    body += (char)0;
+    ndiTestPut16(body, 0);
+    return ndiTestBinaryReply(body);
+  }
+
+  //----------------------------------------------------------------------------
+  // The position of a command in the log, at or after 'start'
+  size_t Find(const std::vector<std::string>& commands, const std::string& prefix, size_t start)
+  {
+    for (size_t i = start; i < commands.size(); i++)
+    {
+      if (commands[i].compare(0, prefix.size(), prefix) == 0)
+      {
+        return i;
+      }
+    }
+    return commands.size();
+  }
+
+  //----------------------------------------------------------------------------
+  // The session is replayed before a command that failed is sent again
+  void TestCommand()
+  {
+    ndiTestDevice device;
+    ndicapi* pol = ndiTestOpenDevice(&device);
+    NDI_TEST_CHECK(pol != NULL);
+    if (pol == NULL)
+    {
+      return;
+    }
+    ndiSetReconnectMode(pol, true);
+
+    ndiCommand(pol, "INIT:");
+    ndiCommand(pol, "PENA:%02X%c", 1, 'D');
+    ndiCommand(pol, "TSTART:");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    // the timeout is set through the transport, which has no low-latency mode
+    ndiTimeoutSocket(pol, 250);
+    NDI_TEST_CHECK(device.Timeout == 250);
+    NDI_TEST_CHECK(ndiSetSerialLowLatency(pol, true) == -1);
+
+    size_t dropped = ndiTestCommands(&device).size();
+    ndiTestDrop(&device);
+    ndiCommand(pol, "BEEP:1");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetReconnectCount(pol) == 1);
+    NDI_TEST_CHECK(device.OpenCount == 2);
+    NDI_TEST_CHECK(device.Timeout == 250);
+
+    // a device that cannot be sent a break is stopped with TSTOP
+    std::vector<std::string> commands = ndiTestCommands(&device);
+    size_t stop = Find(commands, "TSTOP", dropped);
+    size_t init = Find(commands, "INIT", stop);
+    size_t enable = Find(commands, "PENA", init);
+    size_t start = Find(commands, "TSTART", enable);
+    size_t beep = Find(commands, "BEEP", start);
+    NDI_TEST_CHECK(beep < commands.size());
+
+    ndiCommand(pol, "TSTOP:");
+    ndiCloseTransport(pol);
+  }
+
+  //----------------------------------------------------------------------------
+  // The tracking thread restores the session on its own
+  void TestThread()
+  {
+    ndiTestDevice device;
+    device.Handler = &BXReply;
+    ndicapi* pol = ndiTestOpenDevice(&device);
+    NDI_TEST_CHECK(pol != NULL);
+    if (pol == NULL)
+    {
+      return;
+    }
+    ndiSetReconnectMode(pol, true);
+    ndiSetThreadMode(pol, true);
+
+    ndiCommand(pol, "INIT:");
+    ndiCommand(pol, "TSTART:");
+    ndiCommand(pol, "BX:0001");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    size_t dropped = ndiTestCommands(&device).size();
+    ndiTestDrop(&device);
+    for (int i = 0; i < 500 && ndiGetReconnectCount(pol) == 0; i++)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    NDI_TEST_CHECK(ndiGetReconnectCount(pol) == 1);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    // the thread carries on with its command
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ndiCommand(pol, "BX:0001");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    std::vector<std::string> commands = ndiTestCommands(&device);
+    size_t start = Find(commands, "TSTART", Find(commands, "INIT", dropped));
+    NDI_TEST_CHECK(Find(commands, "BX", start) < commands.size());
+
+    ndiCommand(pol, "TSTOP:");
+    ndiCloseTransport(pol);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  TestCommand();
+  TestThread();
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
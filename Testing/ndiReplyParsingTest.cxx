@@ -0,0 +1,300 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check the framing, the command encoding and the decoding of BX and BX2
+// replies, with replies that are made up byte by byte.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void TestFraming()
+  {
+    std::string okay = ndiTestAsciiReply("OKAY");
+    NDI_TEST_CHECK(ndiReplyLength(okay.data(), (int)okay.size(), false) == (int)okay.size());
+    NDI_TEST_CHECK(ndiReplyLength(okay.data(), (int)okay.size() - 1, false) == 0);
+
+    // the next reply is not part of this one
+    std::string two = okay + okay;
+    NDI_TEST_CHECK(ndiReplyLength(two.data(), (int)two.size(), false) == (int)okay.size());
+
+    // an ERROR reply to a binary command is ASCII
+    std::string error = ndiTestAsciiReply("ERROR01");
+    NDI_TEST_CHECK(ndiReplyLength(error.data(), (int)error.size(), true) == (int)error.size());
+
+    std::string binary = ndiTestBinaryReply(std::string(300, '\r'));
+    NDI_TEST_CHECK(ndiBinaryReplySize(binary.data(), 4) == (int)binary.size());
+    NDI_TEST_CHECK(ndiBinaryReplySize(binary.data(), 3) == 0);
+    NDI_TEST_CHECK(ndiReplyLength(binary.data(), (int)binary.size(), true) == (int)binary.size());
+    NDI_TEST_CHECK(ndiReplyLength(binary.data(), (int)binary.size() - 1, true) == 0);
+    NDI_TEST_CHECK(ndiBinaryReplySize("OKAY", 4) == -1);
+
+    // the extended header has a 4 byte length
+    std::string extended;
+    ndiTestPut16(extended, 0xa5c8);
+    ndiTestPut32(extended, 70000);
+    NDI_TEST_CHECK(ndiBinaryReplySize(extended.data(), 5) == 0);
+    NDI_TEST_CHECK(ndiBinaryReplySize(extended.data(), 6) == 70010);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestEncoding(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiEncodedCommand command;
+
+    ndiEncodeBegin(&command, "INIT", ':');
+    ndiEncodeEnd(&command);
+    NDI_TEST_CHECK(strcmp(command.Text, "INIT:E3A5\r") == 0);
+
+    ndiEncodeGX(&command, NDI_XFORMS_AND_STATUS);
+    NDI_TEST_CHECK(std::string(command.Text) == ndiTestAsciiReply("GX:0001"));
+
+    // without the colon there is no CRC
+    ndiEncodeBegin(&command, "BX2", ' ');
+    ndiEncodeString(&command, "--6d=tools", 0);
+    ndiEncodeEnd(&command);
+    NDI_TEST_CHECK(strcmp(command.Text, "BX2 --6d=tools\r") == 0);
+
+    // ndiCommand() sends the same bytes as the encoder
+    ndiEncodeBegin(&command, "PENA", ':');
+    ndiEncodeHex(&command, 0x0A, 2);
+    ndiEncodeChar(&command, 'D');
+    ndiEncodeEnd(&command);
+    ndiCommand(pol, "PENA:%02X%c", 0x0A, 'D');
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiTestCommands(device).back() + "\r" == command.Text);
+
+    // a reply with a bad CRC is not accepted
+    std::string reply = ndiTestAsciiReply("OKAY");
+    reply[5] = (reply[5] == '0' ? '1' : '0');
+    ndiTestQueueReply(device, reply);
+    ndiCommand(pol, "BEEP:1");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_CRC);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestBX(ndicapi* pol, ndiTestDevice* device)
+  {
+    std::string body;
+    body += (char)2;                      // handles
+    body += (char)0x0A;
+    body += (char)NDI_HANDLE_VALID;
+    float transform[8] = { 1, 0, 0, 0, 10, 20, 30, 0.25f };
+    for (int i = 0; i < 8; i++)
+    {
+      ndiTestPutFloat(body, transform[i]);
+    }
+    ndiTestPut32(body, 0x31);             // port status
+    ndiTestPut32(body, 1234);             // frame number
+    body += (char)0x0B;
+    body += (char)NDI_HANDLE_MISSING;
+    ndiTestPut32(body, 0x11);
+    ndiTestPut32(body, 1234);
+    ndiTestPut16(body, 0x0001);           // system status
+
+    ndiTestQueueReply(device, ndiTestBinaryReply(body));
+    ndiCommand(pol, "BX:0001");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    float values[8];
+    NDI_TEST_CHECK(ndiGetBXTransform(pol, 0x0A, values) == NDI_OKAY);
+    NDI_TEST_CHECK(values[4] == 10 && values[5] == 20 && values[6] == 30 && values[7] == 0.25f);
+    NDI_TEST_CHECK(ndiGetBXPortStatus(pol, 0x0A) == 0x31);
+    NDI_TEST_CHECK(ndiGetBXFrame(pol, 0x0A) == 1234);
+    NDI_TEST_CHECK(ndiGetBXTransform(pol, 0x0B, values) == NDI_MISSING);
+    NDI_TEST_CHECK(ndiGetBXSystemStatus(pol) == 0x0001);
+
+    // a reply that is cut short inside the second handle
+    std::string truncated = body.substr(0, 1 + 2 + 32 + 4 + 4 + 2 + 4);
+    ndiTestQueueReply(device, ndiTestBinaryReply(truncated));
+    ndiCommand(pol, "BX:0001");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    NDI_TEST_CHECK(ndiGetBXTransform(pol, 0x0A, values) == NDI_DISABLED);
+
+    // as is a reply that has nothing after its header
+    ndiTestQueueReply(device, ndiTestBinaryReply(body));
+    ndiCommand(pol, "BX:0001");
+    ndiTestQueueReply(device, ndiTestBinaryReply(""));
+    ndiCommand(pol, "BX:0001");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    NDI_TEST_CHECK(ndiGetBXTransform(pol, 0x0A, values) == NDI_DISABLED);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestBX2Events(ndicapi* pol, ndiTestDevice* device)
+  {
+    std::vector<std::pair<int, int> > alerts;
+    alerts.push_back(std::make_pair(NDI_SYS_ALERT_ALERT, 5));
+    std::vector<std::string> active;
+    active.push_back(ndiTestTool(1, 1));
+    active.push_back(ndiTestButtons(1, std::string(1, '\1')));
+    active.push_back(ndiTestAlerts(alerts));
+    std::vector<std::string> passive;
+    passive.push_back(ndiTestTool(2, 2));
+
+    // a passive frame without alerts or buttons follows the active frame
+    std::vector<std::string> frames;
+    frames.push_back(ndiTestFrame(NDI_BX2_FRAME_ACTIVE, 100, active));
+    frames.push_back(ndiTestFrame(NDI_BX2_FRAME_PASSIVE, 101, passive));
+
+    // nothing is tracked until the application asks for events
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(frames)));
+    ndiCommand(pol, "BX2 --6d=tools --1d=buttons");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(pol->Bx2AlertState == NULL && pol->Bx2ButtonState == NULL);
+    ndiAlertEvent alert;
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 0);
+    ndiButtonEvent button;
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 0);
+
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(frames)));
+    ndiCommand(pol, "BX2 --6d=tools --1d=buttons");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 2);
+    NDI_TEST_CHECK(ndiGetBX2FrameType(pol) == NDI_BX2_FRAME_PASSIVE);
+
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 1);
+    NDI_TEST_CHECK(alert.Onset == 1 && alert.Type == NDI_SYS_ALERT_ALERT && alert.Code == 5 && alert.FrameNumber == 100);
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 0);
+
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 1);
+    NDI_TEST_CHECK(button.Pressed == 1 && button.Handle == 1 && button.Button == 0 && button.FrameNumber == 100);
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 0);
+
+    // the next active frame has cleared the alert and released the button
+    active.clear();
+    active.push_back(ndiTestTool(1, 1));
+    active.push_back(ndiTestButtons(1, std::string(1, '\0')));
+    active.push_back(ndiTestAlerts(std::vector<std::pair<int, int> >()));
+    frames.clear();
+    frames.push_back(ndiTestFrame(NDI_BX2_FRAME_ACTIVE, 102, active));
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(frames)));
+    ndiCommand(pol, "BX2 --6d=tools --1d=buttons");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    NDI_TEST_CHECK(ndiPollAlertEvent(pol, &alert) == 1);
+    NDI_TEST_CHECK(alert.Onset == 0 && alert.Code == 5 && alert.FrameNumber == 102);
+    NDI_TEST_CHECK(ndiPollButtonEvent(pol, &button) == 1);
+    NDI_TEST_CHECK(button.Pressed == 0 && button.Handle == 1 && button.FrameNumber == 102);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestBX2Components(ndicapi* pol, ndiTestDevice* device)
+  {
+    // an alert component that follows the last frame belongs to that frame
+    std::vector<std::string> inner;
+    inner.push_back(ndiTestTool(3, 7));
+    std::vector<std::pair<int, int> > alerts;
+    alerts.push_back(std::make_pair(NDI_SYS_ALERT_FAULT, 9));
+    std::vector<std::string> components;
+    components.push_back(ndiTestFrame(NDI_BX2_FRAME_PASSIVE, 200, inner));
+    components.push_back(ndiTestAlerts(alerts));
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(components)));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 1);
+    NDI_TEST_CHECK(ndiSelectBX2Frame(pol, 0) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiGetBX2SystemAlertsCount(pol) == 1);
+    unsigned short* alert = ndiGetBX2SystemAlert(pol, 0);
+    NDI_TEST_CHECK(alert != NULL && alert[0] == NDI_SYS_ALERT_FAULT && alert[1] == 9);
+
+    float transform[8];
+    NDI_TEST_CHECK(ndiGetBX2Transform(pol, 3, transform) == NDI_OKAY);
+    NDI_TEST_CHECK(transform[4] == 7);
+
+    // a component that is longer than the reply drops the whole reply
+    std::string tool = ndiTestTool(3, 7);
+    tool[2] = (char)0xff;
+    components.clear();
+    components.push_back(ndiTestFrame(NDI_BX2_FRAME_PASSIVE, 201, std::vector<std::string>(1, tool)));
+    ndiTestQueueReply(device, ndiTestBinaryReply(ndiTestGBF(components)));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    NDI_TEST_CHECK(ndiGetBX2FrameCount(pol) == 0);
+  }
+
+  //----------------------------------------------------------------------------
+  // A BX2 reply with a single passive frame that holds the given component
+  std::string OneComponent(const std::string& component)
+  {
+    std::vector<std::string> frames;
+    frames.push_back(ndiTestFrame(NDI_BX2_FRAME_PASSIVE, 300, std::vector<std::string>(1, component)));
+    return ndiTestBinaryReply(ndiTestGBF(frames));
+  }
+
+  //----------------------------------------------------------------------------
+  void TestBX2Bounds(ndicapi* pol, ndiTestDevice* device)
+  {
+    // a 2D component with one tool that has no lines of sight
+    std::string items;
+    ndiTestPut16(items, 1);
+    ndiTestPut16(items, 0);
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_2D, 0, 1, items)));
+    ndiCommand(pol, "BX2 --2d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    // more items than the component can hold
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_2D, 0, 1000, items)));
+    ndiCommand(pol, "BX2 --2d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_LINE_SEP, 0, 2, items)));
+    ndiCommand(pol, "BX2 --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_3D_ERROR, 0, 0, items)));
+    ndiCommand(pol, "BX2 --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+
+    // bytes that are left over after the items
+    std::string marker = items;
+    marker[2] = 1;
+    marker += std::string(16, '\0');
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_3D, 0, 1, marker)));
+    ndiCommand(pol, "BX2 --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_3D, 0, 1, marker + "xx")));
+    ndiCommand(pol, "BX2 --3d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+
+    std::string tool = ndiTestTool(1, 1);
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_6D, 0, 1, tool.substr(12) + "xx")));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+
+    std::string alert;
+    ndiTestPut16(alert, NDI_SYS_ALERT_FAULT);
+    ndiTestPut16(alert, 1);
+    ndiTestQueueReply(device, OneComponent(ndiTestComponent(NDI_COMPONENTID_SYS_ALERT, 0, 1, alert + "xx")));
+    ndiCommand(pol, "BX2 --6d=tools");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_BAD_GBF);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestFraming();
+  TestEncoding(pol, &device);
+  TestBX(pol, &device);
+  TestBX2Events(pol, &device);
+  TestBX2Components(pol, &device);
+  TestBX2Bounds(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
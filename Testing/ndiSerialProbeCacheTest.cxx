@@ -0,0 +1,208 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check the file in which ndiSerialProbeAll() keeps the port and baud rate
+// of the last device, with a device on a pseudo-terminal.  The file is
+// read by the probe, and written by the probe and by COMM, but by COMM
+// only once the application has set the file.
+
+#include "ndiTestDevice.h"
+
+#include <atomic>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // A device at the other end of a pseudo-terminal, which answers GETINFO
+  // with its firmware version and every other command with OKAY
+  struct PtyDevice
+  {
+    int Master = -1;
+    int Slave = -1;                       // kept open, so that the device stays when the port is closed
+    std::string Name;
+    std::atomic<bool> IsDone{ false };
+    std::thread Thread;
+  };
+
+  //----------------------------------------------------------------------------
+  void RunDevice(PtyDevice* device)
+  {
+    std::string received;
+    while (!device->IsDone)
+    {
+      struct pollfd fds = { device->Master, POLLIN, 0 };
+      char data[256];
+      ssize_t n = (poll(&fds, 1, 20) > 0 ? read(device->Master, data, sizeof(data)) : 0);
+      if (n <= 0)
+      {
+        continue;
+      }
+      received.append(data, n);
+
+      size_t end;
+      while ((end = received.find('\r')) != std::string::npos)
+      {
+        std::string command = received.substr(0, end);
+        received.erase(0, end + 1);
+        std::string reply = ndiTestAsciiReply(command.compare(0, 8, "GETINFO:") == 0 ? "Features.Firmware.Version=007.000.011" : "OKAY");
+        if (write(device->Master, reply.data(), reply.size()) != (ssize_t)reply.size())
+        {
+          return;
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  bool StartDevice(PtyDevice* device)
+  {
+    device->Master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (device->Master < 0 || grantpt(device->Master) != 0 || unlockpt(device->Master) != 0)
+    {
+      return false;
+    }
+    device->Name = ptsname(device->Master);
+    device->Slave = open(device->Name.c_str(), O_RDWR | O_NOCTTY);
+    if (device->Slave < 0)
+    {
+      return false;
+    }
+
+    // no echo until the port is opened by the ndicapi
+    struct termios settings;
+    tcgetattr(device->Slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(device->Slave, TCSANOW, &settings);
+
+    device->Thread = std::thread(&RunDevice, device);
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void StopDevice(PtyDevice* device)
+  {
+    device->IsDone = true;
+    if (device->Thread.joinable())
+    {
+      device->Thread.join();
+    }
+    close(device->Slave);
+    close(device->Master);
+  }
+
+  //----------------------------------------------------------------------------
+  std::string ReadFile(const std::string& filename)
+  {
+    std::string text;
+    FILE* file = fopen(filename.c_str(), "r");
+    if (file != NULL)
+    {
+      char line[512];
+      if (fgets(line, sizeof(line), file) != NULL)
+      {
+        text = line;
+      }
+      fclose(file);
+    }
+    return text;
+  }
+
+  //----------------------------------------------------------------------------
+  void WriteFile(const std::string& filename, const std::string& text)
+  {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (file != NULL)
+    {
+      fputs(text.c_str(), file);
+      fclose(file);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Send COMM to the device at 115200 baud
+  bool SendComm(const PtyDevice& device)
+  {
+    ndicapi* pol = ndiOpenSerial(device.Name.c_str());
+    if (pol == NULL)
+    {
+      return false;
+    }
+    ndiCommand(pol, "COMM:%d%03d%d", NDI_115200, NDI_8N1, NDI_NOHANDSHAKE);
+    bool isSent = (ndiGetError(pol) == NDI_OKAY);
+    ndiCloseSerial(pol);
+    return isSent;
+  }
+
+  //----------------------------------------------------------------------------
+  void TestComm(const PtyDevice& device, const std::string& dir)
+  {
+    // the default file is left alone by COMM
+    std::string defaultFile = dir + "/ndicapi-serial-probe";
+    NDI_TEST_CHECK(SendComm(device));
+    NDI_TEST_CHECK(access(defaultFile.c_str(), F_OK) != 0);
+
+    // a file that has been set is written
+    std::string cacheFile = dir + "/cache";
+    ndiSetSerialProbeCache(cacheFile.c_str());
+    NDI_TEST_CHECK(SendComm(device));
+    NDI_TEST_CHECK(ReadFile(cacheFile) == device.Name + "\t115200\n");
+    NDI_TEST_CHECK(access(defaultFile.c_str(), F_OK) != 0);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestProbe(const PtyDevice& device, const std::string& dir)
+  {
+    std::string cacheFile = dir + "/cache";
+
+    // the device is found where the file says, at the baud rate it says,
+    // and no other port is probed
+    ndiSerialProbeResult result;
+    NDI_TEST_CHECK(ndiSerialProbeAll(&result, 1, false, 100) == 1);
+    NDI_TEST_CHECK(device.Name == result.Device && result.Baud == 115200);
+    NDI_TEST_CHECK(strcmp(result.Firmware, "Features.Firmware.Version=007.000.011") == 0);
+
+    // the probe writes what it found
+    WriteFile(cacheFile, device.Name + "\t0\n");
+    NDI_TEST_CHECK(ndiSerialProbeAll(&result, 1, false, 100) == 1);
+    NDI_TEST_CHECK(result.Baud == 9600);
+    NDI_TEST_CHECK(ReadFile(cacheFile) == device.Name + "\t9600\n");
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  char dir[] = "/tmp/ndiProbeCacheXXXXXX";
+  if (mkdtemp(dir) == NULL)
+  {
+    fprintf(stderr, "Could not make a directory for the cache\n");
+    return EXIT_FAILURE;
+  }
+  setenv("XDG_CACHE_HOME", dir, 1);
+
+  PtyDevice device;
+  if (!StartDevice(&device))
+  {
+    fprintf(stderr, "Could not open a pseudo-terminal\n");
+    return EXIT_FAILURE;
+  }
+
+  TestComm(device, dir);
+  TestProbe(device, dir);
+
+  StopDevice(&device);
+  ndiSetSerialProbeCache(NULL);
+  remove((std::string(dir) + "/cache").c_str());
+  rmdir(dir);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,126 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// Check that a stream is started with STREAM and stopped with USTREAM,
+// and that the replies that the device pushes in between are read as
+// the replies to the streamed command.
+
+#include "ndiTestDevice.h"
+
+#include <stdlib.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // A pushed BX2 reply with one passive frame
+  std::string Pushed(unsigned int frameNumber)
+  {
+    std::vector<std::string> frames(1, ndiTestFrame(NDI_BX2_FRAME_PASSIVE, frameNumber, std::vector<std::string>(1, ndiTestTool(1, 1))));
+    return ndiTestBinaryReply(ndiTestGBF(frames));
+  }
+
+  //----------------------------------------------------------------------------
+  void Encode(ndiEncodedCommand* command)
+  {
+    ndiEncodeBegin(command, "BX2", ' ');
+    ndiEncodeString(command, "--6d=tools", 0);
+    ndiEncodeEnd(command);
+  }
+
+  //----------------------------------------------------------------------------
+  std::string LastCommand(ndiTestDevice* device)
+  {
+    std::vector<std::string> commands = ndiTestCommands(device);
+    return (commands.empty() ? std::string() : commands.back());
+  }
+
+  //----------------------------------------------------------------------------
+  void TestStart(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiEncodedCommand command;
+    Encode(&command);
+
+    // the replies that arrive along with the OKAY are kept for the first reads
+    ndiTestQueueReply(device, ndiTestAsciiReply("OKAY") + Pushed(1) + Pushed(2));
+    NDI_TEST_CHECK(ndiStartStreaming(pol, &command, "tools") == NDI_OKAY);
+    NDI_TEST_CHECK(LastCommand(device) == "STREAM --id=tools --cmd=\"BX2 --6d=tools\"");
+
+    ndiReadStreamedReply(pol);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY && ndiGetBX2Frame(pol) == 1);
+    ndiReadStreamedReply(pol);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY && ndiGetBX2Frame(pol) == 2);
+
+    // nothing else can be sent while the stream runs
+    size_t sent = ndiTestCommands(device).size();
+    ndiCommand(pol, "BEEP:1");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_STREAMING);
+    NDI_TEST_CHECK(ndiStartStreaming(pol, &command, "again") == NDI_STREAMING);
+    NDI_TEST_CHECK(ndiTestCommands(device).size() == sent);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestStop(ndicapi* pol, ndiTestDevice* device)
+  {
+    // a reply that was pushed before the device saw USTREAM is thrown away
+    ndiTestQueueReply(device, Pushed(3) + ndiTestAsciiReply("OKAY"));
+    NDI_TEST_CHECK(ndiStopStreaming(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(LastCommand(device) == "USTREAM --id=tools");
+    NDI_TEST_CHECK(ndiGetBX2Frame(pol) == 2);
+
+    ndiReadStreamedReply(pol);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_STREAMING);
+    ndiCommand(pol, "BEEP:1");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    // nothing is sent without a stream
+    size_t sent = ndiTestCommands(device).size();
+    NDI_TEST_CHECK(ndiStopStreaming(pol) == NDI_OKAY);
+    NDI_TEST_CHECK(ndiTestCommands(device).size() == sent);
+  }
+
+  //----------------------------------------------------------------------------
+  void TestRefused(ndicapi* pol, ndiTestDevice* device)
+  {
+    ndiEncodedCommand command;
+    Encode(&command);
+
+    // a device that does not agree leaves no stream behind
+    ndiTestQueueReply(device, ndiTestAsciiReply("ERROR01"));
+    NDI_TEST_CHECK(ndiStartStreaming(pol, &command, "tools") == 0x01);
+    ndiReadStreamedReply(pol);
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_STREAMING);
+    ndiCommand(pol, "BEEP:1");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+
+    // USTREAM is answered with an error, but the stream is still forgotten
+    ndiTestQueueReply(device, ndiTestAsciiReply("OKAY"));
+    NDI_TEST_CHECK(ndiStartStreaming(pol, &command, "tools") == NDI_OKAY);
+    ndiTestQueueReply(device, ndiTestAsciiReply("ERROR01"));
+    NDI_TEST_CHECK(ndiStopStreaming(pol) == 0x01);
+    ndiCommand(pol, "BEEP:1");
+    NDI_TEST_CHECK(ndiGetError(pol) == NDI_OKAY);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main()
+{
+  ndiTestDevice device;
+  ndicapi* pol = ndiTestOpenDevice(&device);
+  if (pol == NULL)
+  {
+    fprintf(stderr, "Could not open the test device\n");
+    return EXIT_FAILURE;
+  }
+
+  TestStart(pol, &device);
+  TestStop(pol, &device);
+  TestRefused(pol, &device);
+
+  ndiCloseTransport(pol);
+
+  return (ndiTestFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,345 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// A device in memory for the tests, reached through a transport that is
+// registered as "test".  Each command is answered with the next reply
+// that the test has queued, or with OKAY.  The link can be dropped, to
+// check what the ndicapi does when a device goes away.  The replies,
+// down to the components of a BX2 reply, are built with the helpers below.
+
+#ifndef NDI_TEST_DEVICE_H
+#define NDI_TEST_DEVICE_H
+
+#include <ndicapi.h>
+#include <ndicapi_transport.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Report a failed check, and carry on with the rest of the test
+#define NDI_TEST_CHECK(condition) \
+  if (!(condition)) \
+  { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+    ndiTestFailures++; \
+  }
+
+static int ndiTestFailures = 0;
+
+struct ndiTestDevice
+{
+  std::mutex Mutex;
+  bool IsConnected = false;
+  int OpenCount = 0;
+  int Timeout = 100;
+  std::string Pending;                    // reply bytes that have not been read yet
+  std::deque<std::string> Replies;        // replies for the next commands
+  std::vector<std::string> Commands;      // the commands received, without the carriage return
+  std::string (*Handler)(const std::string& command) = NULL;  // used when no reply is queued
+};
+
+//----------------------------------------------------------------------------
+// The CRC of the NDI protocol, computed bit by bit so that it does not
+// depend on the table in the ndicapi
+inline unsigned short ndiTestCRC(const std::string& data)
+{
+  unsigned short crc = 0;
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    crc ^= (unsigned char)data[i];
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 1) ? (unsigned short)((crc >> 1) ^ 0xA001) : (unsigned short)(crc >> 1);
+    }
+  }
+  return crc;
+}
+
+//----------------------------------------------------------------------------
+// An ASCII reply with its CRC and carriage return
+inline std::string ndiTestAsciiReply(const std::string& text)
+{
+  char crc[8];
+  snprintf(crc, sizeof(crc), "%04X\r", ndiTestCRC(text));
+  return text + crc;
+}
+
+//----------------------------------------------------------------------------
+inline void ndiTestPut16(std::string& data, unsigned int value)
+{
+  data += (char)(value & 0xff);
+  data += (char)((value >> 8) & 0xff);
+}
+
+//----------------------------------------------------------------------------
+inline void ndiTestPut32(std::string& data, unsigned int value)
+{
+  ndiTestPut16(data, value & 0xffff);
+  ndiTestPut16(data, value >> 16);
+}
+
+//----------------------------------------------------------------------------
+inline void ndiTestPutFloat(std::string& data, float value)
+{
+  data.append((const char*)&value, sizeof(value));
+}
+
+//----------------------------------------------------------------------------
+// A binary reply with the A5C4 header, its header CRC and its CRC
+inline std::string ndiTestBinaryReply(const std::string& body)
+{
+  std::string reply;
+  ndiTestPut16(reply, 0xa5c4);
+  ndiTestPut16(reply, (unsigned int)body.size());
+  ndiTestPut16(reply, ndiTestCRC(reply));
+  reply += body;
+  ndiTestPut16(reply, ndiTestCRC(reply));
+  return reply;
+}
+
+//----------------------------------------------------------------------------
+inline ndiTestDevice* ndiTestGetDevice(ndicapi* pol)
+{
+  return (ndiTestDevice*)pol->TransportData;
+}
+
+//----------------------------------------------------------------------------
+inline bool ndiTestOpen(ndicapi* pol, const char* address)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  device->IsConnected = true;
+  device->OpenCount++;
+  device->Pending.clear();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+inline void ndiTestClose(ndicapi* pol)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  device->IsConnected = false;
+}
+
+//----------------------------------------------------------------------------
+inline int ndiTestWrite(ndicapi* pol, const char* data, int length)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  if (!device->IsConnected)
+  {
+    return -1;
+  }
+
+  std::string command(data, length);
+  if (!command.empty() && command[command.size() - 1] == '\r')
+  {
+    command.erase(command.size() - 1);
+  }
+  device->Commands.push_back(command);
+
+  if (!device->Replies.empty())
+  {
+    device->Pending += device->Replies.front();
+    device->Replies.pop_front();
+  }
+  else if (device->Handler != NULL)
+  {
+    device->Pending += device->Handler(command);
+  }
+  else
+  {
+    device->Pending += ndiTestAsciiReply("OKAY");
+  }
+  return length;
+}
+
+//----------------------------------------------------------------------------
+inline int ndiTestReadSome(ndicapi* pol, char* buffer, int n, int expected, int milliseconds)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  if (!device->IsConnected)
+  {
+    return -1;
+  }
+
+  int m = (int)device->Pending.size() < n ? (int)device->Pending.size() : n;
+  device->Pending.copy(buffer, m);
+  device->Pending.erase(0, m);
+  return m;
+}
+
+//----------------------------------------------------------------------------
+inline bool ndiTestFlush(ndicapi* pol, int flushtype)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  if (flushtype == NDI_IFLUSH || flushtype == NDI_IOFLUSH)
+  {
+    device->Pending.clear();
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+inline bool ndiTestSetTimeout(ndicapi* pol, int milliseconds)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  device->Timeout = milliseconds;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+inline int ndiTestGetTimeout(ndicapi* pol)
+{
+  ndiTestDevice* device = ndiTestGetDevice(pol);
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  return device->Timeout;
+}
+
+//----------------------------------------------------------------------------
+inline void ndiTestSleep(ndicapi* pol, int milliseconds)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+static const ndiTransport ndiTestTransport =
+{
+  "test",
+  &ndiTestOpen,
+  &ndiTestClose,
+  &ndiTestWrite,
+  &ndiTestReadSome,
+  &ndiTestFlush,
+  &ndiTestSetTimeout,
+  &ndiTestGetTimeout,
+  &ndiTestSleep,
+  NULL,
+  NULL,
+  NULL
+};
+
+//----------------------------------------------------------------------------
+// Open the ndicapi on a test device
+inline ndicapi* ndiTestOpenDevice(ndiTestDevice* device)
+{
+  ndiRegisterTransport(&ndiTestTransport);
+  return ndiOpenTransport("test", "memory", device);
+}
+
+//----------------------------------------------------------------------------
+// Queue the reply to the next command
+inline void ndiTestQueueReply(ndiTestDevice* device, const std::string& reply)
+{
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  device->Replies.push_back(reply);
+}
+
+//----------------------------------------------------------------------------
+// Lose the link, as if the cable was pulled
+inline void ndiTestDrop(ndiTestDevice* device)
+{
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  device->IsConnected = false;
+}
+
+//----------------------------------------------------------------------------
+inline std::vector<std::string> ndiTestCommands(ndiTestDevice* device)
+{
+  std::lock_guard<std::mutex> lock(device->Mutex);
+  return device->Commands;
+}
+
+//----------------------------------------------------------------------------
+// A GBF component: its header and its items
+inline std::string ndiTestComponent(unsigned int type, unsigned int itemFormat, unsigned int itemCount, const std::string& items)
+{
+  std::string component;
+  ndiTestPut16(component, type);
+  ndiTestPut32(component, 12 + (unsigned int)items.size());
+  ndiTestPut16(component, itemFormat);
+  ndiTestPut32(component, itemCount);
+  return component + items;
+}
+
+//----------------------------------------------------------------------------
+// A GBF: its version, the number of components and the components
+inline std::string ndiTestGBF(const std::vector<std::string>& components)
+{
+  std::string gbf;
+  ndiTestPut16(gbf, 1);
+  ndiTestPut16(gbf, (unsigned int)components.size());
+  for (size_t i = 0; i < components.size(); i++)
+  {
+    gbf += components[i];
+  }
+  return gbf;
+}
+
+//----------------------------------------------------------------------------
+// A frame component that holds the given components
+inline std::string ndiTestFrame(int frameType, unsigned int frameNumber, const std::vector<std::string>& components,
+                                unsigned int seconds = 0, unsigned int nanoseconds = 0)
+{
+  std::string header;
+  header += (char)frameType;
+  header += (char)0;                      // sequence index
+  ndiTestPut16(header, 0);                // frame status
+  ndiTestPut32(header, frameNumber);
+  ndiTestPut32(header, seconds);          // timestamp
+  ndiTestPut32(header, nanoseconds);
+  return ndiTestComponent(NDI_COMPONENTID_FRAME, 0, 1, header + ndiTestGBF(components));
+}
+
+//----------------------------------------------------------------------------
+// A 6D component with one tool that is seen at (x, 0, 0)
+inline std::string ndiTestTool(unsigned int handle, float x)
+{
+  std::string items;
+  ndiTestPut16(items, handle);
+  ndiTestPut16(items, 0);
+  float transform[8] = { 1, 0, 0, 0, x, 0, 0, 0.1f };
+  for (int i = 0; i < 8; i++)
+  {
+    ndiTestPutFloat(items, transform[i]);
+  }
+  return ndiTestComponent(NDI_COMPONENTID_6D, 0, 1, items);
+}
+
+//----------------------------------------------------------------------------
+// A system alert component, with (type, code) pairs
+inline std::string ndiTestAlerts(const std::vector<std::pair<int, int> >& alerts)
+{
+  std::string items;
+  for (size_t i = 0; i < alerts.size(); i++)
+  {
+    ndiTestPut16(items, alerts[i].first);
+    ndiTestPut16(items, alerts[i].second);
+  }
+  return ndiTestComponent(NDI_COMPONENTID_SYS_ALERT, 0, (unsigned int)alerts.size(), items);
+}
+
+//----------------------------------------------------------------------------
+// A 1D component with the buttons of one tool
+inline std::string ndiTestButtons(unsigned int handle, const std::string& states)
+{
+  std::string items;
+  ndiTestPut16(items, handle);
+  ndiTestPut16(items, (unsigned int)states.size());
+  items += states;
+  return ndiTestComponent(NDI_COMPONENTID_1D, 0, 1, items);
+}
+
+#endif
@@ -37,18 +37,24 @@ POSSIBILITY OF SUCH DAMAGES.
 #endif
 
 #include "ndicapi.h"
+#include "ndicapi_internal.h"
 #include "ndicapi_socket.h"
 #include "ndicapi_thread.h"
 
 #include <string.h>
 #include <stdlib.h>
+#include <chrono>
 #include <iostream>
+#include <mutex>
 
 #include <stdio.h>
 #include <math.h>
 
 #if defined(__APPLE__)
   #include <dirent.h>
+#elif defined(__linux__)
+  #include <dirent.h>
+  #include <limits.h>
 #endif
 
 #ifdef __cplusplus
@@ -56,6 +62,9 @@ POSSIBILITY OF SUCH DAMAGES.
   #include <sstream>
 #endif
 
+// Smallest read into the receive buffer, so that most replies take one read
+#define NDI_RECEIVE_CHUNK 4096
+
 //----------------------------------------------------------------------------
 // Prototype for the error helper function, the definition is at the
 // end of this file.  A call to this function will both set ndicapi
@@ -76,18 +85,418 @@ namespace
     return errnum;
   }
 
-  void parseComponents(ndicapi* api, const char* data);
+  // The GBF parsers return false if the data does not fit between data and end,
+  // or if the arena could not hold it, in which case NDI_BAD_ALLOC is set
+  bool parseComponents(ndicapi* api, const char* data, const char* end, int depth);
+
+  // Build the ndiFrame for the latest tracking reply into an arena
+  ndiFrame* ndiBuildFrame(ndicapi* pol, int source, ndiArena*& arena);
+
+  // Per-frame-type BX2 streams and system alert edges
+  void ndiBX2StreamsUpdate(ndicapi* api);
+  bool ndiBX2StreamsCreate(ndicapi* api);
+  void ndiBX2StreamsDestroy(ndicapi* api);
+  void ndiBX2AlertsDestroy(ndicapi* api);
+  void ndiBX2ButtonsDestroy(ndicapi* api);
+  void ndiBX2ImageRingDestroy(ndicapi* api);
+
+  bool parseFrameComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parse6DComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parse3DComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parse1DComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parseUndecodedComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parse1DImageComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parseUVComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+  bool parseSystemAlertComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+}
+
+//----------------------------------------------------------------------------
+// Per-reply bump allocator for the decoded BX and BX2 data.
+//
+// Storage is handed out in order and released all at once when the next
+// reply arrives, so the decoded arrays can be sized from the item counts
+// in the reply instead of from fixed limits.  A reply that does not fit
+// spills into an extra block; the next rewind replaces all blocks with a
+// single one that is large enough, so steady-state tracking never calls
+// malloc.
+//
+// Allocations are rounded to NDI_ARENA_ALIGNMENT, which suits any of the
+// decoded types.  The ndiFrame arrays are allocated with
+// ndiArenaAllocAligned() instead, so that they meet NDI_FRAME_ALIGNMENT.
+#define NDI_ARENA_ALIGNMENT   16
+#define NDI_ARENA_BLOCK_SIZE  4096
+
+struct ndiArenaBlock
+{
+  ndiArenaBlock* Next;                    // block that was filled before this one
+  char* Data;                             // aligned start of the storage
+  size_t Size;                            // bytes of storage
+  size_t Used;                            // bytes handed out from this block
+};
+
+struct ndiArena
+{
+  ndiArenaBlock* Head;                    // block currently being filled
+  size_t Total;                           // bytes handed out since the rewind
+};
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  size_t ndiArenaRoundUp(size_t bytes, size_t alignment)
+  {
+    return (bytes + alignment - 1) & ~(alignment - 1);
+  }
+
+  //----------------------------------------------------------------------------
+  ndiArenaBlock* ndiArenaNewBlock(size_t size, ndiArenaBlock* next)
+  {
+    ndiArenaBlock* block = (ndiArenaBlock*)malloc(sizeof(ndiArenaBlock) + size + NDI_FRAME_ALIGNMENT);
+    if (block != NULL)
+    {
+      block->Next = next;
+      block->Data = (char*)ndiArenaRoundUp((size_t)(block + 1), NDI_FRAME_ALIGNMENT);
+      block->Size = size;
+      block->Used = 0;
+    }
+    return block;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiArenaFreeBlocks(ndiArenaBlock* block)
+  {
+    while (block != NULL)
+    {
+      ndiArenaBlock* next = block->Next;
+      free(block);
+      block = next;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Release everything handed out for the previous reply.  The arena is
+  // created on first use.
+  ndiArena* ndiArenaRewind(ndiArena*& arena)
+  {
+    if (arena == NULL)
+    {
+      arena = (ndiArena*)calloc(1, sizeof(ndiArena));
+      if (arena == NULL)
+      {
+        return NULL;
+      }
+    }
+
+    if (arena->Head != NULL && arena->Head->Next != NULL)
+    {
+      // the previous reply spilled, replace the blocks with one that fits it
+      ndiArenaFreeBlocks(arena->Head);
+      arena->Head = ndiArenaNewBlock(arena->Total, NULL);
+    }
+
+    if (arena->Head != NULL)
+    {
+      arena->Head->Used = 0;
+    }
+    arena->Total = 0;
+
+    return arena;
+  }
+
+  //----------------------------------------------------------------------------
+  // Hand out zero-filled storage that stays valid until the next rewind.  The
+  // storage starts on a multiple of alignment and is padded to one; alignment
+  // is a power of two from NDI_ARENA_ALIGNMENT to NDI_FRAME_ALIGNMENT.
+  void* ndiArenaAllocAligned(ndiArena* arena, size_t bytes, size_t alignment)
+  {
+    if (arena == NULL)
+    {
+      return NULL;
+    }
+
+    bytes = ndiArenaRoundUp(bytes, alignment);
+
+    ndiArenaBlock* block = arena->Head;
+    size_t offset = (block != NULL ? ndiArenaRoundUp(block->Used, alignment) : 0);
+    if (block == NULL || offset + bytes > block->Size)
+    {
+      // spill into a new block, at least as large as the current one
+      size_t size = bytes;
+      if (size < NDI_ARENA_BLOCK_SIZE)
+      {
+        size = NDI_ARENA_BLOCK_SIZE;
+      }
+      if (block != NULL && size < block->Size)
+      {
+        size = block->Size;
+      }
+      block = ndiArenaNewBlock(size, arena->Head);
+      if (block == NULL)
+      {
+        return NULL;
+      }
+      arena->Head = block;
+      offset = 0;
+    }
+
+    char* data = block->Data + offset;
+    block->Used = offset + bytes;
+    // count the most padding this could need, so that a single block of
+    // the total size holds the same allocations after the rewind
+    arena->Total += bytes + alignment - NDI_ARENA_ALIGNMENT;
+    memset(data, 0, bytes);
+
+    return data;
+  }
+
+  //----------------------------------------------------------------------------
+  void* ndiArenaAlloc(ndiArena* arena, size_t bytes)
+  {
+    return ndiArenaAllocAligned(arena, bytes, NDI_ARENA_ALIGNMENT);
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiArenaDestroy(ndiArena*& arena)
+  {
+    if (arena != NULL)
+    {
+      ndiArenaFreeBlocks(arena->Head);
+      free(arena);
+      arena = NULL;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Location of a BX2 component within the current reply.  When lazy decoding
+// is enabled the first pass over a reply only fills in one of these for each
+// component type, and the component is decoded on first access.
+// Slot n corresponds to bit n of the NDI_BX2_DECODE_xxx mask.
+#define NDI_BX2_SLOT_6D          0
+#define NDI_BX2_SLOT_3D          1
+#define NDI_BX2_SLOT_1D          2
+#define NDI_BX2_SLOT_2D          3
+#define NDI_BX2_SLOT_LINE_SEP    4
+#define NDI_BX2_SLOT_3D_ERROR    5
+#define NDI_BX2_SLOT_IMAGE       6
+#define NDI_BX2_SLOT_UV          7
+#define NDI_BX2_SLOT_SYS_ALERT   8
+#define NDI_BX2_SLOT_COUNT       9
+
+struct ndiBX2Component
+{
+  const char* Data;                       // first byte after the component header
+  const char* End;                        // one past the last byte of the component
+  unsigned short ItemOption;
+  unsigned int ItemCount;
+};
+
+//----------------------------------------------------------------------------
+// The decoded data of one frame component of a BX2 reply.  The Bx2 members
+// of the ndicapi structure hold the selected frame, the others are kept
+// here and swapped in by ndiSelectBX2Frame().  All of the arrays belong to
+// the Bx2Arena, so they stay valid until the next reply.
+struct ndiBX2Frame
+{
+  ndiBX2Frame* Next;                      // the frame that follows in the reply
+
+  unsigned char FrameType;
+  unsigned int FrameNumber;
+  unsigned char FrameSequenceIndex;
+  unsigned char Timestamp[8];
+
+  unsigned int HandleCount;
+  unsigned short* Handles;
+  unsigned short* HandlesStatus;
+  bool* HandleAveragingEnabled;
+  float (*Transforms)[8];
+
+  unsigned int SystemAlertsCount;
+  unsigned short (*SystemAlerts)[2];
+
+  unsigned int _3DCount;
+  unsigned short* _3DHandles;
+  unsigned short* _3DMarkerCount;
+  char** _3DMarkerStatus;
+  float (**_3DMarkerPosition)[3];
+
+  unsigned int _1DCount;
+  unsigned short* _1DHandles;
+  unsigned short* _1DButtonCount;
+  unsigned char** _1DButtons;
+
+  unsigned int ImageCount;
+  ndiBX2Image* Images;
+  unsigned int UVCount;
+  ndiBX2UV* UVs;
+
+  unsigned int PresentComponents;
+  unsigned int PendingComponents;
+  ndiBX2Component* Components;
+};
+
+namespace
+{
+  typedef bool (*ndiBX2ComponentParser)(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount);
+
+  // indexed by NDI_BX2_SLOT_xxx
+  const ndiBX2ComponentParser ndiBX2ComponentParsers[NDI_BX2_SLOT_COUNT] =
+  {
+    parse6DComponent,
+    parse3DComponent,
+    parse1DComponent,
+    parseUndecodedComponent,              // 2D
+    parseUndecodedComponent,              // line separation
+    parseUndecodedComponent,              // 3D error
+    parse1DImageComponent,
+    parseUVComponent,
+    parseSystemAlertComponent
+  };
+
+  //----------------------------------------------------------------------------
+  // Return NDI_DISABLED, NDI_MISSING or NDI_OKAY for a BX2 tool status
+  int ndiBX2HandleState(unsigned short status)
+  {
+    unsigned short error = status & NDI_BX2_ERROR_BITS;
+    if (error == NDI_BX2_TRACKING_NOT_ENABLED || error == NDI_BX2_TOOL_UNPLUGGED)
+    {
+      return NDI_DISABLED;
+    }
+    else if (status & NDI_BX2_MISSING_BIT)
+    {
+      return NDI_MISSING;
+    }
+    return NDI_OKAY;
+  }
+
+  //----------------------------------------------------------------------------
+  // Return the NDI_BX2_SLOT_xxx for a component type, or -1 if the type is
+  // a frame or is not known
+  int ndiBX2ComponentSlot(unsigned short componentType)
+  {
+    switch (componentType)
+    {
+    case NDI_COMPONENTID_6D:
+      return NDI_BX2_SLOT_6D;
+    case NDI_COMPONENTID_3D:
+      return NDI_BX2_SLOT_3D;
+    case NDI_COMPONENTID_1D:
+      return NDI_BX2_SLOT_1D;
+    case NDI_COMPONENTID_2D:
+      return NDI_BX2_SLOT_2D;
+    case NDI_COMPONENTID_LINE_SEP:
+      return NDI_BX2_SLOT_LINE_SEP;
+    case NDI_COMPONENTID_3D_ERROR:
+      return NDI_BX2_SLOT_3D_ERROR;
+    case NDI_COMPONENTID_IMAGE:
+      return NDI_BX2_SLOT_IMAGE;
+    case NDI_COMPONENTID_UV:
+      return NDI_BX2_SLOT_UV;
+    case NDI_COMPONENTID_SYS_ALERT:
+      return NDI_BX2_SLOT_SYS_ALERT;
+    default:
+      return -1;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Decode a component that was located by a lazy pass but not decoded yet.
+  // This writes to the Bx2 members, so the getters that call it have the
+  // same threading rules as ndiCommand(), see ndiSetBX2LazyDecoding().
+  void ndiBX2DecodePending(ndicapi* api, int slot)
+  {
+    unsigned int bit = 1u << slot;
+    if ((api->Bx2PendingComponents & bit) == 0)
+    {
+      return;
+    }
+    api->Bx2PendingComponents &= ~bit;
+
+    const ndiBX2Component& component = api->Bx2Components[slot];
+    if (!ndiBX2ComponentParsers[slot](api, component.Data, component.End, component.ItemOption, component.ItemCount) &&
+        api->ErrorCode != NDI_BAD_ALLOC)
+    {
+      ndiSetError(api, NDI_BAD_GBF);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Copy the Bx2 members that describe one frame into a frame record
+  void ndiBX2SaveFrame(const ndicapi* api, ndiBX2Frame* frame)
+  {
+    frame->FrameType = api->Bx2FrameType;
+    frame->FrameNumber = api->Bx2FrameNumber;
+    frame->FrameSequenceIndex = api->Bx2FrameSequenceIndex;
+    memcpy(frame->Timestamp, api->Bx2Timestamp, sizeof(frame->Timestamp));
+
+    frame->HandleCount = api->Bx2HandleCount;
+    frame->Handles = api->Bx2Handles;
+    frame->HandlesStatus = api->Bx2HandlesStatus;
+    frame->HandleAveragingEnabled = api->Bx2HandleAveragingEnabled;
+    frame->Transforms = api->Bx2Transforms;
 
-  void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parse6DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parse3DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parse1DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parse2DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parseLineSepComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parse3DErrorComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parse1DImageComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parseUVComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
-  void parseSystemAlertComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount);
+    frame->SystemAlertsCount = api->Bx2SystemAlertsCount;
+    frame->SystemAlerts = api->Bx2SystemAlerts;
+
+    frame->_3DCount = api->Bx2_3DCount;
+    frame->_3DHandles = api->Bx2_3DHandles;
+    frame->_3DMarkerCount = api->Bx2_3DMarkerCount;
+    frame->_3DMarkerStatus = api->Bx2_3DMarkerStatus;
+    frame->_3DMarkerPosition = api->Bx2_3DMarkerPosition;
+
+    frame->_1DCount = api->Bx2_1DCount;
+    frame->_1DHandles = api->Bx2_1DHandles;
+    frame->_1DButtonCount = api->Bx2_1DButtonCount;
+    frame->_1DButtons = api->Bx2_1DButtons;
+
+    frame->ImageCount = api->Bx2ImageCount;
+    frame->Images = api->Bx2Images;
+    frame->UVCount = api->Bx2UVCount;
+    frame->UVs = api->Bx2UVs;
+
+    frame->PresentComponents = api->Bx2PresentComponents;
+    frame->PendingComponents = api->Bx2PendingComponents;
+    frame->Components = api->Bx2Components;
+  }
+
+  //----------------------------------------------------------------------------
+  // The reverse of ndiBX2SaveFrame()
+  void ndiBX2LoadFrame(ndicapi* api, const ndiBX2Frame* frame)
+  {
+    api->Bx2FrameType = frame->FrameType;
+    api->Bx2FrameNumber = frame->FrameNumber;
+    api->Bx2FrameSequenceIndex = frame->FrameSequenceIndex;
+    memcpy(api->Bx2Timestamp, frame->Timestamp, sizeof(api->Bx2Timestamp));
+
+    api->Bx2HandleCount = frame->HandleCount;
+    api->Bx2Handles = frame->Handles;
+    api->Bx2HandlesStatus = frame->HandlesStatus;
+    api->Bx2HandleAveragingEnabled = frame->HandleAveragingEnabled;
+    api->Bx2Transforms = frame->Transforms;
+
+    api->Bx2SystemAlertsCount = frame->SystemAlertsCount;
+    api->Bx2SystemAlerts = frame->SystemAlerts;
+
+    api->Bx2_3DCount = frame->_3DCount;
+    api->Bx2_3DHandles = frame->_3DHandles;
+    api->Bx2_3DMarkerCount = frame->_3DMarkerCount;
+    api->Bx2_3DMarkerStatus = frame->_3DMarkerStatus;
+    api->Bx2_3DMarkerPosition = frame->_3DMarkerPosition;
+
+    api->Bx2_1DCount = frame->_1DCount;
+    api->Bx2_1DHandles = frame->_1DHandles;
+    api->Bx2_1DButtonCount = frame->_1DButtonCount;
+    api->Bx2_1DButtons = frame->_1DButtons;
+
+    api->Bx2ImageCount = frame->ImageCount;
+    api->Bx2Images = frame->Images;
+    api->Bx2UVCount = frame->UVCount;
+    api->Bx2UVs = frame->UVs;
+
+    api->Bx2PresentComponents = frame->PresentComponents;
+    api->Bx2PendingComponents = frame->PendingComponents;
+    api->Bx2Components = frame->Components;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -97,6 +506,24 @@ ndicapiExport void ndiSetErrorCallback(ndicapi* pol, NDIErrorCallback callback,
   pol->ErrorCallbackData = userdata;
 }
 
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetBX2LazyDecoding(ndicapi* pol, bool mode)
+{
+  pol->Bx2LazyDecoding = mode;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetBX2DecodeMask(ndicapi* pol, unsigned int mask)
+{
+  pol->Bx2DecodeMask = mask;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport unsigned int ndiGetBX2DecodeMask(ndicapi* pol)
+{
+  return pol->Bx2DecodeMask;
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport void ndiLogState(ndicapi* pol, char outInformation[USHRT_MAX])
 {
@@ -214,28 +641,43 @@ ndicapiExport void ndiLogState(ndicapi* pol, char outInformation[USHRT_MAX])
   ss << "TxPassiveStrayCount: " << pol->TxPassiveStrayCount << std::endl;
   ss << "TxPassiveStrayOov[14]: " << pol->TxPassiveStrayOov << std::endl;
   ss << "TxPassiveStray[1052]: " << pol->TxPassiveStray << std::endl;
-  ss << "BxHandleCount: " << pol->BxHandleCount << std::endl;
-  ss << "BxHandles[NDI_MAX_HANDLES]: " << pol->BxHandles << std::endl;
-  ss << "BxHandlesStatus[NDI_MAX_HANDLES]: " << pol->BxHandlesStatus << std::endl;
-  ss << "BxFrameNumber[NDI_MAX_HANDLES]: " << pol->BxFrameNumber << std::endl;
+  ss << "BxHandleCount: " << (int)pol->BxHandleCount << std::endl;
+  for (int i = 0; i < pol->BxHandleCount; ++i)
+  {
+    ss << "BxHandles[" << i << "]: " << (int)pol->BxHandles[i] << std::endl;
+    ss << "BxHandlesStatus[" << i << "]: " << (int)pol->BxHandlesStatus[i] << std::endl;
+    ss << "BxFrameNumber[" << i << "]: " << pol->BxFrameNumber[i] << std::endl;
+  }
   for (int i = 0; i < pol->BxHandleCount; ++i)
   {
     ss << "BxTransforms[" << i << "][8]: " << pol->BxTransforms[i] << std::endl;
   }
-  ss << "BxPortStatus[NDI_MAX_HANDLES]: " << pol->BxPortStatus << std::endl;
+  for (int i = 0; i < pol->BxHandleCount; ++i)
+  {
+    ss << "BxPortStatus[" << i << "]: " << pol->BxPortStatus[i] << std::endl;
+  }
   for (int i = 0; i < pol->BxHandleCount; ++i)
   {
     ss << "BxToolMarkerInformation[" << i << "][11]: " << pol->BxToolMarkerInformation[i] << std::endl;
   }
-  ss << "BxActiveSingleStrayMarkerStatus[NDI_MAX_HANDLES]: " << pol->BxActiveSingleStrayMarkerStatus << std::endl;
+  for (int i = 0; i < pol->BxHandleCount; ++i)
+  {
+    ss << "BxActiveSingleStrayMarkerStatus[" << i << "]: " << (int)pol->BxActiveSingleStrayMarkerStatus[i] << std::endl;
+  }
   for (int i = 0; i < pol->BxHandleCount; ++i)
   {
     ss << "BxActiveSingleStrayMarkerPosition[" << i << "][3]: " << pol->BxActiveSingleStrayMarkerPosition[i] << std::endl;
   }
-  ss << "Bx3DMarkerCount[NDI_MAX_HANDLES]: " << pol->Bx3DMarkerCount << std::endl;
   for (int i = 0; i < pol->BxHandleCount; ++i)
   {
-    ss << "Bx3DMarkerOutOfVolume[" << i << "][3]: " << pol->Bx3DMarkerOutOfVolume[i] << std::endl;
+    ss << "Bx3DMarkerCount[" << i << "]: " << (int)pol->Bx3DMarkerCount[i] << std::endl;
+  }
+  for (int i = 0; i < pol->BxHandleCount; ++i)
+  {
+    for (int j = 0; j < (pol->Bx3DMarkerCount[i] + 7) / 8; j++)
+    {
+      ss << "Bx3DMarkerOutOfVolume[" << i << "][" << j << "]: " << (int)pol->Bx3DMarkerOutOfVolume[i][j] << std::endl;
+    }
   }
   for (int i = 0; i < pol->BxHandleCount; ++i)
   {
@@ -245,7 +687,10 @@ ndicapiExport void ndiLogState(ndicapi* pol, char outInformation[USHRT_MAX])
     }
   }
   ss << "BxPassiveStrayCount: " << pol->BxPassiveStrayCount << std::endl;
-  ss << "BxPassiveStrayOutOfVolume[30]: " << pol->BxPassiveStrayOutOfVolume << std::endl;
+  for (int i = 0; i < (pol->BxPassiveStrayCount + 7) / 8; ++i)
+  {
+    ss << "BxPassiveStrayOutOfVolume[" << i << "]: " << (int)pol->BxPassiveStrayOutOfVolume[i] << std::endl;
+  }
   for (int i = 0; i < pol->BxPassiveStrayCount; ++i)
   {
     ss << "BxPassiveStrayPosition[" << i << "][3]: " << pol->BxPassiveStrayPosition[i] << std::endl;
@@ -261,7 +706,10 @@ ndicapiExport void ndiLogState(ndicapi* pol, char outInformation[USHRT_MAX])
 //----------------------------------------------------------------------------
 ndicapiExport void ndiTimeoutSocket(ndicapi* pol, int timeoutMsec)
 {
-  ndiSocketTimeout(pol->Socket, timeoutMsec);
+  if (pol->Transport != NULL && pol->IsTransportOpen)
+  {
+    pol->Transport->SetTimeout(pol, timeoutMsec);
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -598,7 +1046,12 @@ ndicapiExport const char* ndiErrorString(int errnum)
     "Serial port write error",
     "Serial port read error",
     "Measurement System failed to reset on break",
-    "Measurement System not found on specified port"
+    "Measurement System not found on specified port",
+    "Malformed binary reply from Measurement System",
+    "Command is too long",
+    "Streamed reply was stopped by the receiver",
+    "Not possible while a stream is running, or without one",
+    "Out of memory while storing a reply"
   };
 
   static const char* textarray_serial[] = // values specific to serial errors
@@ -617,7 +1070,7 @@ ndicapiExport const char* ndiErrorString(int errnum)
   {
     return textarray_high[errnum - 0xf1];
   }
-  else if (errnum >= 0x0100 && errnum <= 0x0107)
+  else if (errnum >= 0x0100 && errnum <= 0x010C)
   {
     return textarray_api[errnum - 0x0100];
   }
@@ -750,238 +1203,684 @@ ndicapiExport const char* ndiSerialDeviceName(int i)
 #endif
 }
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiSerialProbe(const char* device, bool checkDSR)
+namespace
 {
-  char reply[1024];
-  char init_reply[16];
-  NDIFileHandle serial_port;
-  int n;
+  // How long ndiSerialProbeAll() waits for the reply to INIT, and for the
+  // replies after it unless the device had to be reset
+#define NDI_PROBE_INIT_TIMEOUT 250
+
+  // A serial port to probe, how to probe it, and what was found there
+  struct ndiProbe
+  {
+    const char* Device;
+    bool CheckDSR;
+    int CachedBaud;                         // tried before 9600, if it is not zero
+    int InitTimeout;                        // milliseconds to wait for the reply to INIT
+    int ResetTimeout;                       // milliseconds to wait for the reply to a break
+    int Pause;                              // milliseconds to wait after sending a command
+    NDIMutex OpenMutex;                     // held to open or close the port, if not NULL
+    NDIThread Thread;
+    bool IsThreaded;
+
+    int ErrorCode;
+    int Baud;
+    char Firmware[256];
+
+    char Received[1024];                    // characters read but not yet taken as a reply
+    int ReceivedLength;
+  };
 
-  serial_port = ndiSerialOpen(device);
-  if (serial_port == NDI_INVALID_HANDLE)
+  //----------------------------------------------------------------------------
+  // Read the next reply through the receive buffer of the probe, which keeps
+  // the characters that arrive after it for the next one.  At most 'size'
+  // characters of the reply are copied to 'reply', which is not terminated,
+  // and the return value is as for ndiSerialRead().
+  int ndiProbeRead(ndiProbe& probe, NDIFileHandle serial_port, char* reply, int size, int* errorCode)
   {
-    return NDI_OPEN_ERROR;
+    ndiSerialReader reader = { serial_port };
+    int n = ndiFrameReply(reader, ndiSerialGetTimeout(serial_port), probe.Received, sizeof(probe.Received),
+                          probe.ReceivedLength, false, errorCode);
+    if (n <= 0)
+    {
+      return n;
+    }
+
+    int m = (n < size ? n : size);
+    memcpy(reply, probe.Received, m);
+    probe.ReceivedLength -= n;
+    memmove(probe.Received, probe.Received + n, probe.ReceivedLength);
+    return m;
   }
 
-  // check DSR line to see whether any device is connected
-  if (checkDSR && !ndiSerialCheckDSR(serial_port))
+  //----------------------------------------------------------------------------
+  // Flush the serial port, and the characters that the probe has read from it
+  int ndiProbeFlush(ndiProbe& probe, NDIFileHandle serial_port)
   {
-    ndiSerialClose(serial_port);
-    return NDI_DSR_FAILURE;
+    probe.ReceivedLength = 0;
+    return ndiSerialFlush(serial_port, NDI_IOFLUSH);
   }
 
-  // set comm parameters to default, but decrease timeout to 0.1s
-  if (ndiSerialComm(serial_port, 9600, "8N1", 0) < 0 || ndiSerialTimeout(serial_port, 100) < 0)
+  //----------------------------------------------------------------------------
+  // Keep a reply, without its CRC and carriage return, as the firmware version
+  void ndiProbeFirmware(ndiProbe& probe, const char* reply, int n)
   {
-    ndiSerialClose(serial_port);
-    return NDI_BAD_COMM;
+    if (n >= 5 && reply[n - 1] == '\r')
+    {
+      n -= 5;
+    }
+    if (n > (int)sizeof(probe.Firmware) - 1)
+    {
+      n = sizeof(probe.Firmware) - 1;
+    }
+    memcpy(probe.Firmware, reply, n);
+    probe.Firmware[n] = '\0';
+  }
+
+  //----------------------------------------------------------------------------
+  // Send INIT at the current baud rate, and check the reply
+  bool ndiProbeInit(ndiProbe& probe, NDIFileHandle serial_port)
+  {
+    char init_reply[16];
+    int errorCode;
+
+    return (ndiSerialWrite(serial_port, "INIT:E3A5\r", 10) == 10 && ndiSerialSleep(serial_port, probe.Pause) >= 0 &&
+            ndiProbeRead(probe, serial_port, init_reply, 16, &errorCode) > 0 && strncmp(init_reply, "OKAYA896\r", 9) == 0);
   }
-  // flush the buffers (which are unlikely to contain anything)
-  ndiSerialFlush(serial_port, NDI_IOFLUSH);
 
-  // try to initialize ndicapi
-  int errorCode;
-  if (ndiSerialWrite(serial_port, "INIT:E3A5\r", 10) < 10 || ndiSerialSleep(serial_port, 100) < 0 ||
-      ndiSerialRead(serial_port, init_reply, 16, false, &errorCode) <= 0 || strncmp(init_reply, "OKAYA896\r", 9) != 0)
+  //----------------------------------------------------------------------------
+  // Probe a serial port that is open, see ndiSerialProbe()
+  int ndiProbeOpenPort(ndiProbe& probe, NDIFileHandle serial_port)
   {
-    // increase timeout to 7 seconds for reset
-    ndiSerialTimeout(serial_port, 7000);
+    char reply[1024];
+    char init_reply[16];
+    int errorCode;
+    int n;
 
-    // init failed: flush, reset, and try again
-    ndiSerialFlush(serial_port, NDI_IOFLUSH);
-    if (ndiSerialFlush(serial_port, NDI_IOFLUSH) < 0 ||
-        ndiSerialBreak(serial_port))
+    // check DSR line to see whether any device is connected
+    if (probe.CheckDSR && !ndiSerialCheckDSR(serial_port))
     {
-      ndiSerialClose(serial_port);
-      return NDI_BAD_COMM;
+      return NDI_DSR_FAILURE;
     }
 
-    n = ndiSerialRead(serial_port, init_reply, 16, false, &errorCode);
-    if (n < 0)
+    // a device that was left at another baud rate answers there, without a reset
+    if (probe.CachedBaud != 0 && probe.CachedBaud != 9600 &&
+        ndiSerialComm(serial_port, probe.CachedBaud, "8N1", 0) == 0 && ndiSerialTimeout(serial_port, probe.InitTimeout) == 0 &&
+        ndiProbeFlush(probe, serial_port) == 0 && ndiProbeInit(probe, serial_port))
     {
-      ndiSerialClose(serial_port);
-      return errorCode;
+      probe.Baud = probe.CachedBaud;
     }
-    else if (n == 0)
+    else
     {
-      ndiSerialClose(serial_port);
-      return NDI_TIMEOUT;
+      // set comm parameters to default, but decrease the timeout
+      if (ndiSerialComm(serial_port, 9600, "8N1", 0) < 0 || ndiSerialTimeout(serial_port, probe.InitTimeout) < 0)
+      {
+        return NDI_BAD_COMM;
+      }
+      probe.Baud = 9600;
+      // flush the buffers (which are unlikely to contain anything)
+      ndiProbeFlush(probe, serial_port);
+
+      // try to initialize ndicapi
+      if (!ndiProbeInit(probe, serial_port))
+      {
+        // increase timeout for reset
+        ndiSerialTimeout(serial_port, probe.ResetTimeout);
+
+        // init failed: flush, reset, and try again
+        ndiProbeFlush(probe, serial_port);
+        if (ndiProbeFlush(probe, serial_port) < 0 ||
+            ndiSerialBreak(serial_port))
+        {
+          return NDI_BAD_COMM;
+        }
+
+        n = ndiProbeRead(probe, serial_port, init_reply, 16, &errorCode);
+        if (n < 0)
+        {
+          return errorCode;
+        }
+        else if (n == 0)
+        {
+          return NDI_TIMEOUT;
+        }
+
+        // check reply from reset
+        if (strncmp(init_reply, "RESETBE6F\r", 10) != 0)
+        {
+          return NDI_BAD_REPLY;
+        }
+        // try to initialize a second time
+        ndiSerialSleep(serial_port, probe.Pause);
+        n = ndiSerialWrite(serial_port, "INIT:E3A5\r", 10);
+        if (n < 0)
+        {
+          return NDI_WRITE_ERROR;
+        }
+        else if (n < 10)
+        {
+          return NDI_TIMEOUT;
+        }
+
+        ndiSerialSleep(serial_port, probe.Pause);
+        n = ndiProbeRead(probe, serial_port, init_reply, 16, &errorCode);
+        if (n < 0)
+        {
+          return NDI_READ_ERROR;
+        }
+        else if (n == 0)
+        {
+          return NDI_TIMEOUT;
+        }
+
+        if (strncmp(init_reply, "OKAYA896\r", 9) != 0)
+        {
+          return NDI_PROBE_FAIL;
+        }
+      }
     }
 
-    // check reply from reset
-    if (strncmp(init_reply, "RESETBE6F\r", 10) != 0)
+    ndiSerialSleep(serial_port, probe.Pause);
+    if (ndiSerialWrite(serial_port, "GETINFO:Features.Firmware.Version0492\r", strlen("GETINFO:Features.Firmware.Version0492\r")) != strlen("GETINFO:Features.Firmware.Version0492\r"))
     {
-      ndiSerialClose(serial_port);
-      return NDI_BAD_REPLY;
+      return NDI_NO_FEATURES_FIRMWARE;
     }
-    // try to initialize a second time
-    ndiSerialSleep(serial_port, 100);
-    n = ndiSerialWrite(serial_port, "INIT:E3A5\r", 10);
-    if (n < 0)
+
+    n = ndiProbeRead(probe, serial_port, reply, 1023, &errorCode);
+    if (n == 0)
     {
-      ndiSerialClose(serial_port);
-      return NDI_WRITE_ERROR;
+      return NDI_TIMEOUT;
     }
-    else if (n < 10)
+    else if (n < 0)
     {
-      ndiSerialClose(serial_port);
-      return NDI_TIMEOUT;
+      return errorCode;
+    }
+    else
+    {
+      if (strncmp(reply, "ERROR", 5) == 0)
+      {
+        if (ndiSerialWrite(serial_port, "VER:065EE\r", 10) < 10 ||
+            (n = ndiProbeRead(probe, serial_port, reply, 1023, &errorCode)) < 7)
+        {
+          return NDI_COMMAND_VER_FAILED;
+        }
+      }
+      else if (strncmp(reply, "Features", strlen("Features")) != 0)
+      {
+        return NDI_BAD_REPLY;
+      }
     }
+    ndiProbeFirmware(probe, reply, n);
 
-    ndiSerialSleep(serial_port, 100);
-    n = ndiSerialRead(serial_port, init_reply, 16, false, &errorCode);
-    if (n < 0)
+    return NDI_OKAY;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiProbePort(ndiProbe& probe)
+  {
+    // the serial port code keeps a table of the open ports
+    if (probe.OpenMutex != NULL)
     {
-      ndiSerialClose(serial_port);
-      return NDI_READ_ERROR;
+      ndiMutexLock(probe.OpenMutex);
     }
-    else if (n == 0)
+    NDIFileHandle serial_port = ndiSerialOpen(probe.Device);
+    if (probe.OpenMutex != NULL)
     {
-      ndiSerialClose(serial_port);
-      return NDI_TIMEOUT;
+      ndiMutexUnlock(probe.OpenMutex);
     }
 
-    if (strncmp(init_reply, "OKAYA896\r", 9) != 0)
+    if (serial_port == NDI_INVALID_HANDLE)
     {
-      ndiSerialClose(serial_port);
-      return NDI_PROBE_FAIL;
+      probe.ErrorCode = NDI_OPEN_ERROR;
+      return;
     }
-  }
 
-  ndiSerialSleep(serial_port, 100);
-  if (ndiSerialWrite(serial_port, "GETINFO:Features.Firmware.Version0492\r", strlen("GETINFO:Features.Firmware.Version0492\r")) != strlen("GETINFO:Features.Firmware.Version0492\r"))
-  {
-    ndiSerialClose(serial_port);
-    return NDI_NO_FEATURES_FIRMWARE;
-  }
+    probe.ReceivedLength = 0;
+    probe.ErrorCode = ndiProbeOpenPort(probe, serial_port);
 
-  n = ndiSerialRead(serial_port, reply, 1023, false, &errorCode);
-  if (n == 0)
-  {
-    ndiSerialClose(serial_port);
-    return NDI_TIMEOUT;
-  }
-  else if (n < 0)
-  {
-    ndiSerialClose(serial_port);
-    return errorCode;
-  }
-  else
-  {
-    if (strncmp(reply, "ERROR", 5) == 0)
+    // restore things back to the way they were
+    if (probe.OpenMutex != NULL)
     {
-      if (ndiSerialWrite(serial_port, "VER:065EE\r", 10) < 10 ||
-          (n = ndiSerialRead(serial_port, reply, 1023, false, &errorCode)) < 7)
-      {
-        ndiSerialClose(serial_port);
-        return NDI_COMMAND_VER_FAILED;
-      }
+      ndiMutexLock(probe.OpenMutex);
     }
-    else if (strncmp(reply, "Features", strlen("Features")) != 0)
+    ndiSerialClose(serial_port);
+    if (probe.OpenMutex != NULL)
     {
-      ndiSerialClose(serial_port);
-      return NDI_BAD_REPLY;
+      ndiMutexUnlock(probe.OpenMutex);
     }
   }
 
-  // restore things back to the way they were
-  ndiSerialClose(serial_port);
-
-  return NDI_OKAY;
-}
-
-//----------------------------------------------------------------------------
-ndicapiExport ndicapi* ndiOpenSerial(const char* device)
-{
-  NDIFileHandle serial_port;
-  ndicapi* pol;
-
-  serial_port = ndiSerialOpen(device);
-
-  if (serial_port == NDI_INVALID_HANDLE)
+  //----------------------------------------------------------------------------
+  void* ndiProbeThread(void* userdata)
   {
+    ndiProbePort(*(ndiProbe*)userdata);
     return NULL;
   }
 
-  if (ndiSerialComm(serial_port, 9600, "8N1", 0) < 0)
+  // The file of ndiSerialProbeAll(), see ndiSetSerialProbeCache().  It
+  // can be set while another thread probes or sends COMM, so it is only
+  // used through a copy that is taken under the mutex.
+  std::mutex ndiProbeCacheMutex;
+  char ndiProbeCacheName[1024];
+  bool ndiIsProbeCacheSet = false;
+
+  //----------------------------------------------------------------------------
+  // Copy the name of the cache file, or return false if there is none.  The
+  // default file is only used if 'isDefaultAllowed' is true.
+  bool ndiProbeCacheFile(char* filename, int size, bool isDefaultAllowed)
   {
-    ndiSerialClose(serial_port);
-    return NULL;
+    int n;
+
+    std::lock_guard<std::mutex> lock(ndiProbeCacheMutex);
+    if (ndiIsProbeCacheSet)
+    {
+      n = snprintf(filename, size, "%s", ndiProbeCacheName);
+    }
+    else if (!isDefaultAllowed)
+    {
+      return false;
+    }
+    else
+    {
+#if defined(_WIN32)
+      const char* dir = getenv("LOCALAPPDATA");
+      if (dir == NULL || dir[0] == '\0')
+      {
+        return false;
+      }
+      n = snprintf(filename, size, "%s\\ndicapi-serial-probe", dir);
+#else
+      const char* dir = getenv("XDG_CACHE_HOME");
+      if (dir != NULL && dir[0] != '\0')
+      {
+        n = snprintf(filename, size, "%s/ndicapi-serial-probe", dir);
+      }
+      else
+      {
+        dir = getenv("HOME");
+        if (dir == NULL || dir[0] == '\0')
+        {
+          return false;
+        }
+        n = snprintf(filename, size, "%s/.cache/ndicapi-serial-probe", dir);
+      }
+#endif
+    }
+
+    return (n > 0 && n < size);
   }
 
-  if (ndiSerialFlush(serial_port, NDI_IOFLUSH) < 0)
+  //----------------------------------------------------------------------------
+  // Read the port and baud rate of the last device that was found
+  bool ndiProbeCacheRead(const char* filename, char* device, int size, int& baud)
   {
-    ndiSerialClose(serial_port);
-    return NULL;
+    char line[1024];
+
+    FILE* file = fopen(filename, "r");
+    if (file == NULL)
+    {
+      return false;
+    }
+    bool isRead = (fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+
+    // the line is the device name and the baud rate, separated by a tab
+    char* tab = (isRead ? strrchr(line, '\t') : NULL);
+    if (tab == NULL || tab == line || tab - line >= size)
+    {
+      return false;
+    }
+    *tab = '\0';
+    strcpy(device, line);
+    baud = atoi(tab + 1);
+    return true;
   }
 
-  pol = (ndicapi*)malloc(sizeof(ndicapi));
+  //----------------------------------------------------------------------------
+  // Remember where a device is, for the next ndiSerialProbeAll()
+  void ndiProbeCacheWrite(const char* filename, const char* device, int baud)
+  {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+      return;
+    }
+    fprintf(file, "%s\t%d\n", device, baud);
+    fclose(file);
+  }
 
-  if (pol == 0)
+  //----------------------------------------------------------------------------
+  // Add a port to the list, unless it is there already
+  void ndiProbeAddPort(char (*ports)[256], int& count, const char* name)
   {
-    ndiSerialClose(serial_port);
-    return NULL;
+    if (count >= NDI_PROBE_MAX_PORTS || strlen(name) >= 256)
+    {
+      return;
+    }
+    for (int i = 0; i < count; i++)
+    {
+      if (strcmp(ports[i], name) == 0)
+      {
+        return;
+      }
+    }
+    strcpy(ports[count++], name);
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiProbeComparePorts(const void* a, const void* b)
+  {
+    return strcmp((const char*)a, (const char*)b);
+  }
+
+  //----------------------------------------------------------------------------
+  // Add the serial ports that there are to the list, in order of their names
+  void ndiProbeFindPorts(char (*ports)[256], int& count)
+  {
+    int first = count;
+
+#if defined(__linux__)
+    char path[PATH_MAX];
+    char name[PATH_MAX];
+    struct dirent* ep;
+
+    // USB adapters, by their serial numbers
+    DIR* dirp = opendir("/dev/serial/by-id");
+    if (dirp != NULL)
+    {
+      while ((ep = readdir(dirp)) != NULL)
+      {
+        if (ep->d_name[0] == '.')
+        {
+          continue;
+        }
+        snprintf(path, sizeof(path), "/dev/serial/by-id/%s", ep->d_name);
+        if (realpath(path, name) != NULL)
+        {
+          ndiProbeAddPort(ports, count, name);
+        }
+      }
+      closedir(dirp);
+    }
+
+    // the ports that the kernel has, apart from 8250 ports without a UART
+    dirp = opendir("/sys/class/tty");
+    if (dirp != NULL)
+    {
+      while ((ep = readdir(dirp)) != NULL)
+      {
+        if (strncmp(ep->d_name, "ttyUSB", 6) != 0 && strncmp(ep->d_name, "ttyACM", 6) != 0 &&
+            strncmp(ep->d_name, "ttyS", 4) != 0)
+        {
+          continue;
+        }
+        if (strncmp(ep->d_name, "ttyS", 4) == 0)
+        {
+          int type = 0;
+          snprintf(path, sizeof(path), "/sys/class/tty/%s/type", ep->d_name);
+          FILE* file = fopen(path, "r");
+          if (file != NULL)
+          {
+            if (fscanf(file, "%d", &type) != 1)
+            {
+              type = 0;
+            }
+            fclose(file);
+          }
+          if (type == 0)
+          {
+            continue;
+          }
+        }
+        snprintf(name, sizeof(name), "/dev/%s", ep->d_name);
+        ndiProbeAddPort(ports, count, name);
+      }
+      closedir(dirp);
+    }
+#else
+    for (int i = 0; i < NDI_PROBE_MAX_PORTS; i++)
+    {
+      const char* name = ndiSerialDeviceName(i);
+      if (name == NULL)
+      {
+        break;
+      }
+      ndiProbeAddPort(ports, count, name);
+    }
+#endif
+
+    qsort(ports + first, count - first, sizeof(ports[0]), &ndiProbeComparePorts);
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialProbe(const char* device, bool checkDSR)
+{
+  ndiProbe probe;
+  memset(&probe, 0, sizeof(probe));
+  probe.Device = device;
+  probe.CheckDSR = checkDSR;
+  probe.InitTimeout = 100;
+  probe.ResetTimeout = 7000;
+  probe.Pause = 100;
+
+  ndiProbePort(probe);
+
+  return probe.ErrorCode;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialProbeAll(ndiSerialProbeResult* results, int maxResults, bool checkDSR, int milliseconds)
+{
+  char (*ports)[256] = (char (*)[256])malloc(NDI_PROBE_MAX_PORTS * sizeof(ports[0]));
+  ndiProbe* probes = (ndiProbe*)calloc(NDI_PROBE_MAX_PORTS, sizeof(ndiProbe));
+  NDIMutex openMutex = ndiMutexCreate();
+  char cacheFile[1024];
+  char cachedDevice[256];
+  int cachedBaud = 0;
+  int count = 0;
+  int found = 0;
+
+  if (ports == NULL || probes == NULL || openMutex == NULL)
+  {
+    free(ports);
+    free(probes);
+    if (openMutex != NULL)
+    {
+      ndiMutexDestroy(openMutex);
+    }
+    return 0;
+  }
+
+  // the port in the cache goes first, even if it was not found by name,
+  // and the same file is written after the probe
+  bool isCacheFile = ndiProbeCacheFile(cacheFile, sizeof(cacheFile), true);
+  bool isCached = (isCacheFile && ndiProbeCacheRead(cacheFile, cachedDevice, sizeof(cachedDevice), cachedBaud));
+  if (isCached)
+  {
+    ndiProbeAddPort(ports, count, cachedDevice);
   }
+  ndiProbeFindPorts(ports, count);
 
-  memset(pol, 0, sizeof(ndicapi));
-  pol->SerialDevice = serial_port;
+  for (int i = 0; i < count; i++)
+  {
+    probes[i].Device = ports[i];
+    probes[i].CheckDSR = checkDSR;
+    probes[i].CachedBaud = (isCached && i == 0 ? cachedBaud : 0);
+    probes[i].InitTimeout = NDI_PROBE_INIT_TIMEOUT;
+    probes[i].ResetTimeout = milliseconds;
+    probes[i].Pause = 0;
+    probes[i].OpenMutex = openMutex;
+    probes[i].ErrorCode = NDI_PROBE_FAIL;
+  }
 
-  // allocate the buffers
-  pol->SerialDeviceName = (char*)malloc(strlen(device) + 1);
-  pol->Command = (char*)malloc(2048);
-  pol->Reply = (char*)malloc(2048);
-  pol->ReplyNoCRC = (char*)malloc(2048);
-  pol->Hostname = NULL;
-  pol->Port = -1;
-  pol->Socket = -1;
+  // if one device is wanted and it is where it was the last time, that is all
+  int first = 0;
+  if (isCached && maxResults == 1 && count > 0)
+  {
+    ndiProbePort(probes[0]);
+    first = (probes[0].ErrorCode == NDI_OKAY ? count : 1);
+  }
 
-  if (pol->SerialDeviceName == 0 || pol->Command == 0 || pol->Reply == 0 || pol->ReplyNoCRC == 0)
+  // the other ports are probed at the same time, so their timeouts overlap
+  for (int i = first; i < count; i++)
   {
-    if (pol->SerialDeviceName)
+    probes[i].Thread = ndiThreadSplit(&ndiProbeThread, &probes[i]);
+    probes[i].IsThreaded = (probes[i].Thread != 0);
+    if (!probes[i].IsThreaded)
     {
-      free(pol->SerialDeviceName);
+      ndiProbePort(probes[i]);
     }
-    if (pol->Command)
+  }
+  for (int i = first; i < count; i++)
+  {
+    if (probes[i].IsThreaded)
     {
-      free(pol->Command);
+      ndiThreadJoin(probes[i].Thread);
     }
-    if (pol->Reply)
+  }
+
+  for (int i = 0; i < count && found < maxResults; i++)
+  {
+    if (probes[i].ErrorCode == NDI_OKAY)
     {
-      free(pol->Reply);
+      ndiSerialProbeResult& result = results[found++];
+      strcpy(result.Device, probes[i].Device);
+      result.Baud = probes[i].Baud;
+      strcpy(result.Firmware, probes[i].Firmware);
+    }
+  }
+
+  if (found > 0 && isCacheFile)
+  {
+    ndiProbeCacheWrite(cacheFile, results[0].Device, results[0].Baud);
+  }
+
+  ndiMutexDestroy(openMutex);
+  free(probes);
+  free(ports);
+
+  return found;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetSerialProbeCache(const char* filename)
+{
+  std::lock_guard<std::mutex> lock(ndiProbeCacheMutex);
+  ndiIsProbeCacheSet = true;
+  if (filename == NULL || strlen(filename) >= sizeof(ndiProbeCacheName))
+  {
+    ndiProbeCacheName[0] = '\0';
+  }
+  else
+  {
+    strcpy(ndiProbeCacheName, filename);
+  }
+}
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Allocate a device handle and its buffers for a transport that has not
+  // been opened yet.  Returns NULL if there is not enough memory.
+  ndicapi* ndiCreate(const ndiTransport* transport, const char* address, void* userdata)
+  {
+    ndicapi* pol = (ndicapi*)malloc(sizeof(ndicapi));
+
+    if (pol == 0)
+    {
+      return NULL;
     }
-    if (pol->ReplyNoCRC)
+
+    memset(pol, 0, sizeof(ndicapi));
+    pol->SerialDevice = NDI_INVALID_HANDLE;
+    pol->Socket = -1;
+    pol->Port = -1;
+    pol->Transport = transport;
+    pol->TransportData = userdata;
+    pol->Bx2DecodeMask = NDI_BX2_DECODE_ALL;
+
+    // allocate the buffers
+    pol->TransportAddress = (char*)malloc(strlen(address) + 1);
+    pol->Command = (char*)malloc(2048);
+    pol->Reply = (char*)malloc(2048);
+    pol->ReplyNoCRC = (char*)malloc(2048);
+    pol->Receive = (char*)malloc(2 * NDI_RECEIVE_CHUNK);
+
+    if (pol->TransportAddress == 0 || pol->Command == 0 || pol->Reply == 0 || pol->ReplyNoCRC == 0 || pol->Receive == 0 ||
+        !ndiBX2StreamsCreate(pol))
     {
+      free(pol->TransportAddress);
+      free(pol->Command);
+      free(pol->Reply);
       free(pol->ReplyNoCRC);
+      free(pol->Receive);
+      ndiBX2StreamsDestroy(pol);
+      free(pol);
+      return NULL;
     }
 
-    ndiSerialClose(serial_port);
-    return NULL;
+    // initialize the allocated memory
+    strcpy(pol->TransportAddress, address);
+    memset(pol->Command, 0, 2048);
+    memset(pol->Reply, 0, 2048);
+    memset(pol->ReplyNoCRC, 0, 2048);
+    pol->ReplySize = 2048;
+    pol->ReplyNoCRCSize = 2048;
+    pol->ReceiveSize = 2 * NDI_RECEIVE_CHUNK;
+
+    return pol;
   }
 
-  // initialize the allocated memory
-  strcpy(pol->SerialDeviceName, device);
-  memset(pol->Command, 0, 2048);
-  memset(pol->Reply, 0, 2048);
-  memset(pol->ReplyNoCRC, 0, 2048);
+  //----------------------------------------------------------------------------
+  // Create a device handle and open its transport
+  ndicapi* ndiOpenWith(const ndiTransport* transport, const char* address, void* userdata)
+  {
+    ndicapi* pol = ndiCreate(transport, address, userdata);
+
+    if (pol == NULL)
+    {
+      return NULL;
+    }
+
+    if (!transport->Open(pol, address))
+    {
+      ndiCloseTransport(pol);
+      return NULL;
+    }
+    pol->IsTransportOpen = true;
+
+    return pol;
+  }
+}
 
-  return pol;
+//----------------------------------------------------------------------------
+ndicapiExport ndicapi* ndiOpenSerial(const char* device)
+{
+  return ndiOpenWith(ndiGetSerialTransport(), device, NULL);
 }
 
 //----------------------------------------------------------------------------
 ndicapiExport ndicapi* ndiOpenNetwork(const char* hostname, int port)
+{
+  return ndiOpenNetworkTimeout(hostname, port, NDI_CONNECT_TIMEOUT_MS);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport ndicapi* ndiOpenNetworkTimeout(const char* hostname, int port, int timeoutMs)
 {
   NDISocketHandle socket;
   ndicapi* device;
 
-  int connected = ndiSocketOpen(hostname, port, socket);
-
-  if (socket == -1 || connected == -1)
+  if (!ndiSocketOpenTimeout(hostname, port, timeoutMs, socket))
   {
     return NULL;
   }
 
-  device = (ndicapi*)malloc(sizeof(ndicapi));
+  // the address that the transport is opened at again after a reconnect
+  char address[300];
+  snprintf(address, sizeof(address), (strchr(hostname, ':') != NULL ? "[%s]:%d" : "%s:%d"), hostname, port);
+
+  device = ndiCreate(ndiGetSocketTransport(), address, NULL);
 
   if (device == 0)
   {
@@ -989,25 +1888,26 @@ ndicapiExport ndicapi* ndiOpenNetwork(const char* hostname, int port)
     return NULL;
   }
 
-  memset(device, 0, sizeof(ndicapi));
-  device->Hostname = new char[strlen(hostname) + 1];
-  device->Hostname = strncpy(device->Hostname, hostname, strlen(hostname));
+  device->Hostname = (char*)malloc(strlen(hostname) + 1);
+  strcpy(device->Hostname, hostname);
   device->Port = port;
   device->Socket = socket;
-  device->SerialDevice = NDI_INVALID_HANDLE;
-  device->SerialDeviceName = NULL;
+  device->IsTransportOpen = true;
 
-  // allocate the buffers
-  device->Command = (char*)malloc(2048);
-  device->Reply = (char*)malloc(2048);
-  device->ReplyNoCRC = (char*)malloc(2048);
+  return device;
+}
 
-  // initialize the allocated memory
-  memset(device->Command, 0, 2048);
-  memset(device->Reply, 0, 2048);
-  memset(device->ReplyNoCRC, 0, 2048);
+//----------------------------------------------------------------------------
+ndicapiExport ndicapi* ndiOpenTransport(const char* name, const char* address, void* userdata)
+{
+  const ndiTransport* transport = ndiFindTransport(name);
 
-  return device;
+  if (transport == NULL)
+  {
+    return NULL;
+  }
+
+  return ndiOpenWith(transport, address, userdata);
 }
 
 //----------------------------------------------------------------------------
@@ -1041,42 +1941,57 @@ ndicapiExport NDIFileHandle ndiGetDeviceHandle(ndicapi* pol)
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport void ndiCloseSerial(ndicapi* device)
+ndicapiExport int ndiSetSerialLowLatency(ndicapi* pol, bool enable)
 {
-  // end the tracking thread if it is running
-  ndiSetThreadMode(device, 0);
-
-  // close the serial port
-  ndiSerialClose(device->SerialDevice);
-
-  // free the buffers
-  free(device->SerialDeviceName);
-  free(device->Command);
-  free(device->Reply);
-  free(device->ReplyNoCRC);
-  device->SerialDeviceName = NULL;
-  device->SerialDevice = NDI_INVALID_HANDLE;
+  if (pol->Transport == NULL || !pol->IsTransportOpen || pol->Transport->LowLatency == NULL)
+  {
+    return -1;
+  }
+  return (pol->Transport->LowLatency(pol, enable) ? 0 : -1);
+}
 
-  free(device);
+//----------------------------------------------------------------------------
+ndicapiExport void ndiCloseSerial(ndicapi* device)
+{
+  ndiCloseTransport(device);
 }
 
 //----------------------------------------------------------------------------
 ndicapiExport void ndiCloseNetwork(ndicapi* device)
+{
+  ndiCloseTransport(device);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiCloseTransport(ndicapi* device)
 {
   // end the tracking thread if it is running
   ndiSetThreadMode(device, 0);
 
-  // close the serial port
-  ndiSocketClose(device->Socket);
+  // close the serial port, the socket or the other transport
+  if (device->IsTransportOpen)
+  {
+    device->Transport->Close(device);
+    device->IsTransportOpen = false;
+  }
 
   // free the buffers
+  free(device->SerialDeviceName);
   free(device->Hostname);
+  free(device->TransportAddress);
   free(device->Command);
   free(device->Reply);
   free(device->ReplyNoCRC);
-  device->Hostname = NULL;
-  device->Port = -1;
-  device->Socket = -1;
+  free(device->Receive);
+  free(device->SessionLog);
+  free(device->Streaming);
+  ndiArenaDestroy(device->BxArena);
+  ndiArenaDestroy(device->Bx2Arena);
+  ndiArenaDestroy(device->FrameArena);
+  ndiBX2StreamsDestroy(device);
+  ndiBX2AlertsDestroy(device);
+  ndiBX2ButtonsDestroy(device);
+  ndiBX2ImageRingDestroy(device);
 
   free(device);
 }
@@ -1128,6 +2043,8 @@ static const int oddparity[16] = { 0, 1, 1, 0, 1, 0, 0, 1,
 //
 //   cp  -> the command string that was sent to the NDICAPI
 //   crp -> the reply from the Measurement System, but with the CRC hacked off
+//   replyLength -> the number of bytes in crp, which the binary replies are
+//                  checked against; text replies are also null-terminated
 
 namespace
 {
@@ -1140,7 +2057,7 @@ namespace
   //
   // This information can be later extracted through one of the ndiGetPHINFxx()
   // functions.
-  void ndiPHINFHelper(ndicapi* pol, const char* cp, const char* crp)
+  void ndiPHINFHelper(ndicapi* pol, const char* cp, const char* crp, int replyLength)
   {
     unsigned long mode = 0x0001; // the default reply mode
     char* dp;
@@ -1314,7 +2231,7 @@ namespace
   //
   //This information can be later extracted through one of the ndiGetPHRQHandle()
   //functions.
-  void ndiPHRQHelper(ndicapi* pol, const char* cp, const char* crp)
+  void ndiPHRQHelper(ndicapi* pol, const char* cp, const char* crp, int replyLength)
   {
     char* dp;
     int j;
@@ -1334,7 +2251,7 @@ namespace
   //
   // This information can be later extracted through one of the ndiGetPHSRxx()
   // functions.
-  void ndiPHSRHelper(ndicapi* pol, const char* command, const char* commandReply)
+  void ndiPHSRHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
     char* writePointer;
     int j;
@@ -1356,7 +2273,7 @@ namespace
   //
   // This information can be later extracted through one of the ndiGetTXxx()
   // functions.
-  void ndiTXHelper(ndicapi* pol, const char* command, const char* commandReply)
+  void ndiTXHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
     unsigned long mode = NDI_XFORMS_AND_STATUS; // the default reply mode
     char* writePointer;
@@ -1369,6 +2286,9 @@ namespace
       mode = ndiHexToUnsignedLong(&command[3], 4);
     }
 
+    pol->FrameSource = NDI_FRAME_TX;
+    pol->FrameIsBuilt = false;
+
     // get the number of handles
     handleCount = (int)ndiHexToUnsignedLong(commandReply, 2);
     for (j = 0; j < 2 && *commandReply >= ' '; j++)
@@ -1549,11 +2469,18 @@ namespace
   }
 
   //----------------------------------------------------------------------------
-  // Parse the GBF format and return the number of bytes to skip
-  void parseComponents(ndicapi* api, const char* data)
+  // Parse the GBF format.  Every header is checked against the bytes that
+  // remain before 'end' before it is used, so a corrupt reply is rejected
+  // as soon as the first inconsistent size or count is seen.
+  bool parseComponents(ndicapi* api, const char* data, const char* end, int depth)
   {
     const char* componentIndex = data;
 
+    if (end - componentIndex < 4)
+    {
+      return false;
+    }
+
     // GBF version
     api->Bx2GBFVersion = (unsigned char)componentIndex[1] << 8 | (unsigned char)componentIndex[0];
     componentIndex += 2;
@@ -1561,10 +2488,14 @@ namespace
     unsigned short componentCount = (unsigned char)componentIndex[1] << 8 | (unsigned char)componentIndex[0];
     componentIndex += 2;
 
-    unsigned int totalSkipLength(0);
     for (unsigned short i = 0; i < componentCount; ++i)
     {
-      // Component
+      // Component header, 12 bytes
+      if (end - componentIndex < 12)
+      {
+        return false;
+      }
+      const char* componentStart = componentIndex;
       unsigned short componentType = (unsigned char)componentIndex[1] << 8 | (unsigned char)componentIndex[0];
       componentIndex += 2;
       unsigned int componentSize = (unsigned char)componentIndex[3] << 24 | (unsigned char)componentIndex[2] << 16 | (unsigned char)componentIndex[1] << 8 | (unsigned char)componentIndex[0];
@@ -1574,52 +2505,68 @@ namespace
       unsigned int itemCount = (unsigned char)componentIndex[3] << 24 | (unsigned char)componentIndex[2] << 16 | (unsigned char)componentIndex[1] << 8 | (unsigned char)componentIndex[0];
       componentIndex += 4;
 
-      switch (componentType)
+      // the size includes the header and must not run past the reply
+      if (componentSize < 12 || componentSize > (unsigned int)(end - componentStart))
+      {
+        return false;
+      }
+      const char* componentEnd = componentStart + componentSize;
+
+      bool valid = true;
+      int slot = ndiBX2ComponentSlot(componentType);
+      if (slot >= 0)
+      {
+        api->Bx2PresentComponents |= 1u << slot;
+      }
+      if (componentType == NDI_COMPONENTID_FRAME)
+      {
+        // frames hold data components, they are never nested
+        valid = (depth == 0 && parseFrameComponent(api, componentIndex, componentEnd, itemOption, itemCount));
+      }
+      else if (slot < 0)
       {
-      case NDI_COMPONENTID_FRAME:
-        parseFrameComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_6D:
-        parse6DComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_3D:
-        parse3DComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_1D:
-        parse1DComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_2D:
-        parse2DComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_LINE_SEP:
-        parseLineSepComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_3D_ERROR:
-        parse3DErrorComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_IMAGE:
-        parse1DImageComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_UV:
-        parseUVComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      case NDI_COMPONENTID_SYS_ALERT:
-        parseSystemAlertComponent(api, componentIndex, itemOption, itemCount);
-        break;
-      default:
         // Unknown component type, do nothing
-        break;
+      }
+      else if ((api->Bx2DecodeMask & (1u << slot)) == 0)
+      {
+        // Not wanted by the application, only the header is read
+      }
+      else if (api->Bx2LazyDecoding)
+      {
+        // remember where the component is, it is decoded on first access
+        ndiBX2Component& component = api->Bx2Components[slot];
+        component.Data = componentIndex;
+        component.End = componentEnd;
+        component.ItemOption = itemOption;
+        component.ItemCount = itemCount;
+        api->Bx2PendingComponents |= 1u << slot;
+      }
+      else
+      {
+        valid = ndiBX2ComponentParsers[slot](api, componentIndex, componentEnd, itemOption, itemCount);
+      }
+      if (!valid)
+      {
+        return false;
       }
 
-      componentIndex += componentSize - 12; // skip component size - header size
+      componentIndex = componentEnd;
     }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
-void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  bool parseFrameComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
     const char* componentIndex = data;
 
+    // frame header is 16 bytes, followed by a GBF
+    if (end - componentIndex < 16)
+    {
+      return false;
+    }
+
     // Frame Type
     api->Bx2FrameType = (unsigned char)componentIndex[0];
     componentIndex += 1;
@@ -1639,20 +2586,85 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       componentIndex++;
     }
 
-    parseComponents(api, componentIndex);
-  }
-
-  //----------------------------------------------------------------------------
-  void parse6DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
-  {
-    const char* dataIndex = data;
-
-    // Limitation of the API (for now, can go c++ and remove it)
-    api->Bx2HandleCount = itemCount < NDI_MAX_HANDLES ? itemCount : NDI_MAX_HANDLES;
-
-    // Go through the information for each handle
-    for (unsigned int i = 0; i < api->Bx2HandleCount; i++)
+    // each frame starts out empty, the previous frame is kept in its record
+    ndiBX2Frame* frame = (ndiBX2Frame*)ndiArenaAlloc(api->Bx2Arena, sizeof(ndiBX2Frame));
+    if (frame == NULL)
     {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
+    api->Bx2HandleCount = 0;
+    api->Bx2SystemAlertsCount = 0;
+    api->Bx2_3DCount = 0;
+    api->Bx2_1DCount = 0;
+    api->Bx2ImageCount = 0;
+    api->Bx2UVCount = 0;
+    api->Bx2PendingComponents = 0;
+    api->Bx2PresentComponents = 0;
+    if (api->Bx2LazyDecoding)
+    {
+      api->Bx2Components = (ndiBX2Component*)ndiArenaAlloc(api->Bx2Arena, NDI_BX2_SLOT_COUNT * sizeof(ndiBX2Component));
+      if (api->Bx2Components == NULL)
+      {
+        ndiSetError(api, NDI_BAD_ALLOC);
+        return false;
+      }
+    }
+
+    if (!parseComponents(api, componentIndex, end, 1))
+    {
+      return false;
+    }
+
+    // append the frame to the list for ndiSelectBX2Frame()
+    ndiBX2SaveFrame(api, frame);
+    if (api->Bx2SelectedFrame == NULL)
+    {
+      api->Bx2Frames = frame;
+    }
+    else
+    {
+      api->Bx2SelectedFrame->Next = frame;
+    }
+    api->Bx2SelectedFrame = frame;
+    api->Bx2FrameCount++;
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  bool parse6DComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
+  {
+    const char* dataIndex = data;
+    ndiArena* arena = api->Bx2Arena;
+
+    api->Bx2HandleCount = 0;
+    // each item has at least a handle and a status
+    if (itemCount > (unsigned int)(end - dataIndex) / 4)
+    {
+      return false;
+    }
+    api->Bx2Handles = (unsigned short*)ndiArenaAlloc(arena, itemCount * sizeof(unsigned short));
+    api->Bx2HandlesStatus = (unsigned short*)ndiArenaAlloc(arena, itemCount * sizeof(unsigned short));
+    api->Bx2HandleAveragingEnabled = (bool*)ndiArenaAlloc(arena, itemCount * sizeof(bool));
+    api->Bx2Transforms = (float(*)[8])ndiArenaAlloc(arena, itemCount * sizeof(float[8]));
+    if (api->Bx2Handles == NULL || api->Bx2HandlesStatus == NULL ||
+        api->Bx2HandleAveragingEnabled == NULL || api->Bx2Transforms == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
+    api->Bx2HandleCount = itemCount;
+
+    // Go through the information for each handle
+    for (unsigned int i = 0; i < api->Bx2HandleCount; i++)
+    {
+      if (end - dataIndex < 4)
+      {
+        api->Bx2HandleCount = 0;
+        return false;
+      }
+
       // get the handle itself
       api->Bx2Handles[i] = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
       dataIndex += 2;
@@ -1660,10 +2672,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       api->Bx2HandlesStatus[i] = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
       dataIndex += 2;
 
-      if (api->Bx2HandlesStatus[i] & NDI_BX2_AVG_BIT)
-      {
-        api->Bx2HandleAveragingEnabled[i] = true;
-      }
+      api->Bx2HandleAveragingEnabled[i] = (api->Bx2HandlesStatus[i] & NDI_BX2_AVG_BIT) != 0;
 
       // Disabled handles have no reply data
       if (api->Bx2HandlesStatus[i] & NDI_BX2_MISSING_BIT)
@@ -1671,6 +2680,12 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
         continue;
       }
 
+      if (end - dataIndex < 32)
+      {
+        api->Bx2HandleCount = 0;
+        return false;
+      }
+
       // 4 float, Q0, Qx, Qy, Qz
       api->Bx2Transforms[i][0] = *(float*)dataIndex;
       dataIndex += 4;
@@ -1693,19 +2708,49 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       api->Bx2Transforms[i][7] = *(float*)dataIndex;
       dataIndex += 4;
     }
+
+    // the tools must make up the whole component, as its header says
+    if (dataIndex != end)
+    {
+      api->Bx2HandleCount = 0;
+      return false;
+    }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
-  void parse3DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  bool parse3DComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
     const char* dataIndex = data;
+    ndiArena* arena = api->Bx2Arena;
 
-    // Limitation of the API (for now, can go c++ and remove it)
-    unsigned int handleCount = itemCount < NDI_MAX_HANDLES ? itemCount : NDI_MAX_HANDLES;
+    api->Bx2_3DCount = 0;
+    // each item has at least a handle and a marker count
+    if (itemCount > (unsigned int)(end - dataIndex) / 4)
+    {
+      return false;
+    }
+    api->Bx2_3DHandles = (unsigned short*)ndiArenaAlloc(arena, itemCount * sizeof(unsigned short));
+    api->Bx2_3DMarkerCount = (unsigned short*)ndiArenaAlloc(arena, itemCount * sizeof(unsigned short));
+    api->Bx2_3DMarkerStatus = (char**)ndiArenaAlloc(arena, itemCount * sizeof(char*));
+    api->Bx2_3DMarkerPosition = (float(**)[3])ndiArenaAlloc(arena, itemCount * sizeof(float(*)[3]));
+    if (api->Bx2_3DHandles == NULL || api->Bx2_3DMarkerCount == NULL ||
+        api->Bx2_3DMarkerStatus == NULL || api->Bx2_3DMarkerPosition == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
 
     // Go through the information for each handle
-    for (unsigned int i = 0; i < handleCount; i++)
+    for (unsigned int i = 0; i < itemCount; i++)
     {
+      if (end - dataIndex < 4)
+      {
+        api->Bx2_3DCount = 0;
+        return false;
+      }
+
       // get the handle itself
       unsigned short handle = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
       dataIndex += 2;
@@ -1713,9 +2758,31 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       unsigned short numberOf3Ds = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
       dataIndex += 2;
 
+      // each marker is 16 bytes
+      if (numberOf3Ds > (end - dataIndex) / 16)
+      {
+        api->Bx2_3DCount = 0;
+        return false;
+      }
+
+      char* status = (char*)ndiArenaAlloc(arena, numberOf3Ds * sizeof(char));
+      float(*position)[3] = (float(*)[3])ndiArenaAlloc(arena, numberOf3Ds * sizeof(float[3]));
+      if (status == NULL || position == NULL)
+      {
+        api->Bx2_3DCount = 0;
+        ndiSetError(api, NDI_BAD_ALLOC);
+        return false;
+      }
+
+      api->Bx2_3DHandles[i] = handle;
+      api->Bx2_3DMarkerCount[i] = numberOf3Ds;
+      api->Bx2_3DMarkerStatus[i] = status;
+      api->Bx2_3DMarkerPosition[i] = position;
+      api->Bx2_3DCount = i + 1;
+
       for (unsigned short j = 0; j < numberOf3Ds; ++j)
       {
-        api->Bx2_3DMarkerStatus[i][j] = (char)dataIndex[0];
+        status[j] = (char)dataIndex[0];
         dataIndex++;
 
         unsigned char reserved = (unsigned char)dataIndex[0];
@@ -1726,58 +2793,249 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
         dataIndex += 2;
 
         // 3 float, Tx, Ty, Tz
-        api->Bx2_3DMarkerPosition[i][j][0] = *(float*)dataIndex;
+        position[j][0] = *(float*)dataIndex;
         dataIndex += 4;
-        api->Bx2_3DMarkerPosition[i][j][1] = *(float*)dataIndex;
+        position[j][1] = *(float*)dataIndex;
         dataIndex += 4;
-        api->Bx2_3DMarkerPosition[i][j][2] = *(float*)dataIndex;
+        position[j][2] = *(float*)dataIndex;
         dataIndex += 4;
       }
     }
-  }
 
-  //----------------------------------------------------------------------------
-  void parse1DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
-  {
+    // the markers must make up the whole component, as its header says
+    if (dataIndex != end)
+    {
+      api->Bx2_3DCount = 0;
+      return false;
+    }
 
+    return true;
   }
 
   //----------------------------------------------------------------------------
-  void parse2DComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  bool parse1DComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
+    const char* dataIndex = data;
+    ndiArena* arena = api->Bx2Arena;
 
-  }
+    api->Bx2_1DCount = 0;
+    // each item has a handle and a 1D count, followed by one byte per 1D
+    if (itemCount > (unsigned int)(end - dataIndex) / 4)
+    {
+      return false;
+    }
+    api->Bx2_1DHandles = (unsigned short*)ndiArenaAlloc(arena, itemCount * sizeof(unsigned short));
+    api->Bx2_1DButtonCount = (unsigned short*)ndiArenaAlloc(arena, itemCount * sizeof(unsigned short));
+    api->Bx2_1DButtons = (unsigned char**)ndiArenaAlloc(arena, itemCount * sizeof(unsigned char*));
+    if (api->Bx2_1DHandles == NULL || api->Bx2_1DButtonCount == NULL || api->Bx2_1DButtons == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
 
-  //----------------------------------------------------------------------------
-  void parseLineSepComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
-  {
+    for (unsigned int i = 0; i < itemCount; i++)
+    {
+      if (end - dataIndex < 4)
+      {
+        api->Bx2_1DCount = 0;
+        return false;
+      }
+
+      unsigned short handle = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 2;
+
+      unsigned short numberOf1Ds = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 2;
+
+      // the button states, zero when the button is released
+      if (numberOf1Ds > end - dataIndex)
+      {
+        api->Bx2_1DCount = 0;
+        return false;
+      }
+
+      unsigned char* buttons = (unsigned char*)ndiArenaAlloc(arena, numberOf1Ds);
+      if (buttons == NULL)
+      {
+        api->Bx2_1DCount = 0;
+        ndiSetError(api, NDI_BAD_ALLOC);
+        return false;
+      }
+      memcpy(buttons, dataIndex, numberOf1Ds);
+      dataIndex += numberOf1Ds;
+
+      api->Bx2_1DHandles[i] = handle;
+      api->Bx2_1DButtonCount[i] = numberOf1Ds;
+      api->Bx2_1DButtons[i] = buttons;
+      api->Bx2_1DCount = i + 1;
+    }
 
+    // the items must make up the whole component, as its header says
+    if (dataIndex != end)
+    {
+      api->Bx2_1DCount = 0;
+      return false;
+    }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
-  void parse3DErrorComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  // The 2D, line separation and 3D error components have no getters, so
+  // their items are not decoded.  Each item starts with at least a 2 byte
+  // handle and a 2 byte count, which bounds the item count by the size.
+  bool parseUndecodedComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
-
+    if (itemCount == 0)
+    {
+      return (data == end);
+    }
+    return (itemCount <= (unsigned int)(end - data) / 4);
   }
 
   //----------------------------------------------------------------------------
-  void parse1DImageComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  // The pixels are not copied, each image points into the reply
+  bool parse1DImageComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
-    
+    const char* dataIndex = data;
+
+    api->Bx2ImageCount = 0;
+    // each item has a sensor, the bytes per pixel, a width and a height,
+    // followed by the pixels
+    if (itemCount > (unsigned int)(end - dataIndex) / 12)
+    {
+      return false;
+    }
+    api->Bx2Images = (ndiBX2Image*)ndiArenaAlloc(api->Bx2Arena, itemCount * sizeof(ndiBX2Image));
+    if (api->Bx2Images == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
+
+    for (unsigned int i = 0; i < itemCount; i++)
+    {
+      if (end - dataIndex < 12)
+      {
+        api->Bx2ImageCount = 0;
+        return false;
+      }
+
+      ndiBX2Image& image = api->Bx2Images[i];
+      image.Sensor = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 2;
+
+      image.BytesPerPixel = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 2;
+
+      image.Width = (unsigned char)dataIndex[3] << 24 | (unsigned char)dataIndex[2] << 16 | (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 4;
+
+      image.Height = (unsigned char)dataIndex[3] << 24 | (unsigned char)dataIndex[2] << 16 | (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 4;
+
+      // the pixels are little-endian integers of up to 4 bytes
+      unsigned long long size = (unsigned long long)image.Width * image.Height * image.BytesPerPixel;
+      if (image.BytesPerPixel == 0 || image.BytesPerPixel > 4 || size > (unsigned long long)(end - dataIndex))
+      {
+        api->Bx2ImageCount = 0;
+        return false;
+      }
+      image.FrameNumber = api->Bx2FrameNumber;
+      image.Size = (unsigned int)size;
+      image.Pixels = (const unsigned char*)dataIndex;
+      dataIndex += size;
+
+      api->Bx2ImageCount = i + 1;
+    }
+
+    // the images must make up the whole component, as its header says
+    if (dataIndex != end)
+    {
+      api->Bx2ImageCount = 0;
+      return false;
+    }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
-  void parseUVComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  // The spots are not copied, each item points into the reply
+  bool parseUVComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
-    
+    const char* dataIndex = data;
+
+    api->Bx2UVCount = 0;
+    // each item has a sensor and a spot count, followed by the spots
+    if (itemCount > (unsigned int)(end - dataIndex) / 4)
+    {
+      return false;
+    }
+    api->Bx2UVs = (ndiBX2UV*)ndiArenaAlloc(api->Bx2Arena, itemCount * sizeof(ndiBX2UV));
+    if (api->Bx2UVs == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
+
+    for (unsigned int i = 0; i < itemCount; i++)
+    {
+      if (end - dataIndex < 4)
+      {
+        api->Bx2UVCount = 0;
+        return false;
+      }
+
+      ndiBX2UV& uv = api->Bx2UVs[i];
+      uv.Sensor = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 2;
+
+      uv.SpotCount = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
+      dataIndex += 2;
+
+      // each spot is 3 floats, U, V and brightness
+      if (uv.SpotCount > (end - dataIndex) / 12)
+      {
+        api->Bx2UVCount = 0;
+        return false;
+      }
+      uv.Spots = (const unsigned char*)dataIndex;
+      dataIndex += uv.SpotCount * 12;
+
+      api->Bx2UVCount = i + 1;
+    }
+
+    // the spots must make up the whole component, as its header says
+    if (dataIndex != end)
+    {
+      api->Bx2UVCount = 0;
+      return false;
+    }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
-  void parseSystemAlertComponent(ndicapi* api, const char* data, unsigned short itemOption, unsigned int itemCount)
+  bool parseSystemAlertComponent(ndicapi* api, const char* data, const char* end, unsigned short itemOption, unsigned int itemCount)
   {
     const char* dataIndex = data;
+
+    api->Bx2SystemAlertsCount = 0;
+    // each alert is a 2 byte condition type and a 2 byte condition code,
+    // and the alerts make up the whole component
+    if (itemCount != (unsigned int)(end - dataIndex) / 4 || (end - dataIndex) % 4 != 0)
+    {
+      return false;
+    }
+    api->Bx2SystemAlerts = (unsigned short(*)[2])ndiArenaAlloc(api->Bx2Arena, itemCount * sizeof(unsigned short[2]));
+    if (api->Bx2SystemAlerts == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return false;
+    }
     api->Bx2SystemAlertsCount = itemCount;
-    for (unsigned short i = 0; i < itemCount; ++i)
+
+    for (unsigned int i = 0; i < itemCount; ++i)
     {
       api->Bx2SystemAlerts[i][0] = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
       dataIndex += 2;
@@ -1785,6 +3043,8 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       api->Bx2SystemAlerts[i][1] = (unsigned char)dataIndex[1] << 8 | (unsigned char)dataIndex[0];
       dataIndex += 2;
     }
+
+    return true;
   }
 
   //----------------------------------------------------------------------------
@@ -1794,7 +3054,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
   // This function is called every time a BX2 command is sent to the Measurement System.
   //
   // This information can be later extracted through one of the ndiGetBXxx() functions.
-  void ndiBX2Helper(ndicapi* api, const char* command, const char* commandReply)
+  void ndiBX2Helper(ndicapi* api, const char* command, const char* commandReply, int replyLength)
   {
     // Reply options
     // --6d = tools | none Specifies whether 6D information for tools is returned.The default is tools.
@@ -1905,24 +3165,58 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
     */
 
     const char* replyIndex = &commandReply[0];
+    const char* replyEnd = &commandReply[replyLength];
     unsigned short headerCRC;
     bool extendedHeader = false;
 
+    api->FrameSource = NDI_FRAME_BX2;
+    api->FrameIsBuilt = false;
+
+    // Storage from the previous reply is reused for this one
+    ndiArenaRewind(api->Bx2Arena);
+    api->Bx2HandleCount = 0;
+    api->Bx2SystemAlertsCount = 0;
+    api->Bx2_3DCount = 0;
+    api->Bx2_1DCount = 0;
+    api->Bx2ImageCount = 0;
+    api->Bx2UVCount = 0;
+    api->Bx2PendingComponents = 0;
+    api->Bx2PresentComponents = 0;
+    api->Bx2FrameCount = 0;
+    api->Bx2Frames = NULL;
+    api->Bx2SelectedFrame = NULL;
+
     // Confirm start sequence
+    if (replyLength < 6)
+    {
+      ndiSetError(api, NDI_BAD_GBF);
+      return;
+    }
     if (replyIndex[0] != (char)0xc4 || replyIndex[1] != (char)0xa5)  // little endian
     {
       if (replyIndex[0] != (char)0xc8 || replyIndex[1] != (char)0xa5)  // little endian
       {
+        ndiSetError(api, NDI_BAD_GBF);
         return;
       }
       else
       {
         extendedHeader = true;
+        if (replyLength < 8)
+        {
+          ndiSetError(api, NDI_BAD_GBF);
+          return;
+        }
+        replyIndex += 2;
 
         // Get the reply length
         api->Bx2ReplyLength = 0;
-        api->Bx2ReplyLength = (unsigned char)replyIndex[3] << 24 | (unsigned char)replyIndex[2] << 16 | (unsigned char)replyIndex[1] << 8 | (unsigned char)replyIndex[0];
+        api->Bx2ReplyLength = (unsigned int)(unsigned char)replyIndex[3] << 24 | (unsigned char)replyIndex[2] << 16 | (unsigned char)replyIndex[1] << 8 | (unsigned char)replyIndex[0];
         replyIndex += 4;
+
+        // Get the CRC
+        headerCRC = (unsigned char)replyIndex[1] << 8 | (unsigned char)replyIndex[0];
+        replyIndex += 2;
       }
     }
     else
@@ -1939,7 +3233,68 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       replyIndex += 2;
     }
 
-    parseComponents(api, replyIndex);
+    // The components must fit in both the advertised length and the bytes
+    // that were actually received
+    if (api->Bx2ReplyLength < (unsigned int)(replyEnd - replyIndex))
+    {
+      replyEnd = replyIndex + api->Bx2ReplyLength;
+    }
+
+    if (api->Bx2LazyDecoding)
+    {
+      // the reply buffer is reused by the next command, so keep a copy of
+      // the components that will be decoded later
+      size_t length = replyEnd - replyIndex;
+      char* copy = (char*)ndiArenaAlloc(api->Bx2Arena, length);
+      api->Bx2Components = (ndiBX2Component*)ndiArenaAlloc(api->Bx2Arena, NDI_BX2_SLOT_COUNT * sizeof(ndiBX2Component));
+      if (copy == NULL || api->Bx2Components == NULL)
+      {
+        ndiSetError(api, NDI_BAD_ALLOC);
+        return;
+      }
+      memcpy(copy, replyIndex, length);
+      replyIndex = copy;
+      replyEnd = copy + length;
+    }
+
+    if (!parseComponents(api, replyIndex, replyEnd, 0))
+    {
+      // drop the partially decoded reply
+      api->Bx2HandleCount = 0;
+      api->Bx2SystemAlertsCount = 0;
+      api->Bx2_3DCount = 0;
+      api->Bx2_1DCount = 0;
+      api->Bx2ImageCount = 0;
+      api->Bx2UVCount = 0;
+      api->Bx2PendingComponents = 0;
+      api->Bx2FrameCount = 0;
+      api->Bx2Frames = NULL;
+      api->Bx2SelectedFrame = NULL;
+      if (api->ErrorCode != NDI_BAD_ALLOC)
+      {
+        ndiSetError(api, NDI_BAD_GBF);
+      }
+      return;
+    }
+
+    // components that follow the last frame were decoded into the Bx2
+    // members while it was selected, so they belong to its record too
+    if (api->Bx2SelectedFrame != NULL)
+    {
+      ndiBX2SaveFrame(api, api->Bx2SelectedFrame);
+    }
+
+    ndiBX2StreamsUpdate(api);
+  }
+
+  //----------------------------------------------------------------------------
+  // Drop a BX reply that does not start with a binary header, or that is
+  // shorter than its contents say
+  void ndiBXTruncated(ndicapi* api)
+  {
+    api->BxHandleCount = 0;
+    api->BxPassiveStrayCount = 0;
+    ndiSetError(api, NDI_BAD_GBF);
   }
 
   //----------------------------------------------------------------------------
@@ -1949,7 +3304,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
   // This function is called every time a BX command is sent to the Measurement System.
   //
   // This information can be later extracted through one of the ndiGetBXxx() functions.
-  void ndiBXHelper(ndicapi* api, const char* command, const char* commandReply)
+  void ndiBXHelper(ndicapi* api, const char* command, const char* commandReply, int replyLength)
   {
     // Reply options
     // NDI_XFORMS_AND_STATUS  0x0001  /* transforms and status */
@@ -1960,7 +3315,8 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
     // NDI_PASSIVE_EXTRA      0x2000  /* add 6 extra passive tools */
     // NDI_PASSIVE_STRAY      0x1000  /* stray passive marker reporting */
     unsigned long mode = NDI_XFORMS_AND_STATUS;
-    const char* replyIndex;
+    const char* replyIndex = &commandReply[0];
+    const char* replyEnd = &commandReply[replyLength];
     unsigned short headerCRC;
 
     // if the BX command had a reply option, read it
@@ -1969,12 +3325,18 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       mode = ndiHexToUnsignedLong(&command[3], 4);
     }
 
-    replyIndex = &commandReply[0];
+    api->FrameSource = NDI_FRAME_BX;
+    api->FrameIsBuilt = false;
+
+    // Storage from the previous reply is reused for this one
+    ndiArena* arena = ndiArenaRewind(api->BxArena);
+    api->BxHandleCount = 0;
+    api->BxPassiveStrayCount = 0;
 
     // Confirm start sequence
-    if (replyIndex[0] != (char)0xc4 || replyIndex[1] != (char)0xa5)  // little endian
+    if (replyLength < 7 || replyIndex[0] != (char)0xc4 || replyIndex[1] != (char)0xa5)  // little endian
     {
-      // Something isn't right, abort
+      ndiBXTruncated(api);
       return;
     }
     replyIndex += 2;
@@ -1987,13 +3349,52 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
     headerCRC = (unsigned char)replyIndex[1] << 8 | (unsigned char)replyIndex[0];
     replyIndex += 2;
 
+    // The data must fit in both the advertised length and the bytes
+    // that were actually received
+    if (api->BxReplyLength < replyEnd - replyIndex)
+    {
+      replyEnd = replyIndex + api->BxReplyLength;
+    }
+    if (replyEnd - replyIndex < 1)
+    {
+      ndiBXTruncated(api);
+      return;
+    }
+
     // Get the number of handles
-    api->BxHandleCount = (unsigned char)replyIndex[0];
+    unsigned char handleCount = (unsigned char)replyIndex[0];
     replyIndex += 1;
 
+    api->BxHandles = (char*)ndiArenaAlloc(arena, handleCount * sizeof(char));
+    api->BxHandlesStatus = (char*)ndiArenaAlloc(arena, handleCount * sizeof(char));
+    api->BxFrameNumber = (unsigned int*)ndiArenaAlloc(arena, handleCount * sizeof(unsigned int));
+    api->BxTransforms = (float(*)[8])ndiArenaAlloc(arena, handleCount * sizeof(float[8]));
+    api->BxPortStatus = (int*)ndiArenaAlloc(arena, handleCount * sizeof(int));
+    api->BxToolMarkerInformation = (char(*)[11])ndiArenaAlloc(arena, handleCount * sizeof(char[11]));
+    api->BxActiveSingleStrayMarkerStatus = (char*)ndiArenaAlloc(arena, handleCount * sizeof(char));
+    api->BxActiveSingleStrayMarkerPosition = (float(*)[3])ndiArenaAlloc(arena, handleCount * sizeof(float[3]));
+    api->Bx3DMarkerCount = (unsigned char*)ndiArenaAlloc(arena, handleCount * sizeof(unsigned char));
+    api->Bx3DMarkerOutOfVolume = (char**)ndiArenaAlloc(arena, handleCount * sizeof(char*));
+    api->Bx3DMarkerPosition = (float(**)[3])ndiArenaAlloc(arena, handleCount * sizeof(float(*)[3]));
+    if (api->BxHandles == NULL || api->BxHandlesStatus == NULL || api->BxFrameNumber == NULL ||
+        api->BxTransforms == NULL || api->BxPortStatus == NULL || api->BxToolMarkerInformation == NULL ||
+        api->BxActiveSingleStrayMarkerStatus == NULL || api->BxActiveSingleStrayMarkerPosition == NULL ||
+        api->Bx3DMarkerCount == NULL || api->Bx3DMarkerOutOfVolume == NULL || api->Bx3DMarkerPosition == NULL)
+    {
+      ndiSetError(api, NDI_BAD_ALLOC);
+      return;
+    }
+    api->BxHandleCount = handleCount;
+
     // Go through the information for each handle
     for (unsigned short i = 0; i < api->BxHandleCount; i++)
     {
+      if (replyEnd - replyIndex < 2)
+      {
+        ndiBXTruncated(api);
+        return;
+      }
+
       // get the handle itself
       api->BxHandles[i] = (char)replyIndex[0];
       replyIndex++;
@@ -2009,6 +3410,11 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
 
       if (mode & NDI_XFORMS_AND_STATUS)
       {
+        if (replyEnd - replyIndex < (api->BxHandlesStatus[i] != NDI_HANDLE_MISSING ? 40 : 8))
+        {
+          ndiBXTruncated(api);
+          return;
+        }
         if (api->BxHandlesStatus[i] != NDI_HANDLE_MISSING)
         {
           // 4 float, Q0, Qx, Qy, Qz
@@ -2044,6 +3450,11 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       // grab additional information
       if (mode & NDI_ADDITIONAL_INFO)
       {
+        if (replyEnd - replyIndex < 11)
+        {
+          ndiBXTruncated(api);
+          return;
+        }
         api->BxToolMarkerInformation[i][0] = (char)replyIndex[0];
         replyIndex++;
         for (int j = 0; j < 10; j++)
@@ -2056,12 +3467,22 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       // grab the single marker info
       if (mode & NDI_SINGLE_STRAY)
       {
+        if (replyEnd - replyIndex < 1)
+        {
+          ndiBXTruncated(api);
+          return;
+        }
         char activeStatus = (char)replyIndex[0];
         replyIndex++;
         api->BxActiveSingleStrayMarkerStatus[i] = activeStatus;
 
         if (activeStatus != 0x00 || (mode & NDI_NOT_NORMALLY_REPORTED && activeStatus & NDI_ACTIVE_STRAY_OUT_OF_VOLUME))
         {
+          if (replyEnd - replyIndex < 12)
+          {
+            ndiBXTruncated(api);
+            return;
+          }
           // Marker is not missing, or it is out-of-volume and not-normally-requested is requested
           // Either means we have data...
           // 3 float, Tx, Ty, Tz
@@ -2076,26 +3497,49 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
 
       if (mode & NDI_3D_MARKER_POSITIONS)
       {
+        if (replyEnd - replyIndex < 1)
+        {
+          ndiBXTruncated(api);
+          return;
+        }
+
         // Save marker count
-        api->Bx3DMarkerCount[i] = (char)replyIndex[0];
+        unsigned char markerCount = (unsigned char)replyIndex[0];
         replyIndex++;
 
+        int numBytes = (markerCount + 7) / 8;
+        if (replyEnd - replyIndex < numBytes + markerCount * 12)
+        {
+          ndiBXTruncated(api);
+          return;
+        }
+        char* outOfVolume = (char*)ndiArenaAlloc(arena, numBytes);
+        float(*position)[3] = (float(*)[3])ndiArenaAlloc(arena, markerCount * sizeof(float[3]));
+        if (outOfVolume == NULL || position == NULL)
+        {
+          api->BxHandleCount = 0;
+          ndiSetError(api, NDI_BAD_ALLOC);
+          return;
+        }
+        api->Bx3DMarkerCount[i] = markerCount;
+        api->Bx3DMarkerOutOfVolume[i] = outOfVolume;
+        api->Bx3DMarkerPosition[i] = position;
+
         // Save off out of volume status
-        int numBytes = static_cast<int>(ceilf(api->Bx3DMarkerCount[i] / 8.f));
         for (int j = 0; j < numBytes; ++j)
         {
-          api->Bx3DMarkerOutOfVolume[i][j] = (char)replyIndex[0];
+          outOfVolume[j] = (char)replyIndex[0];
           ++replyIndex;
         }
 
-        for (int j = 0; j < api->Bx3DMarkerCount[i]; ++j)
+        for (int j = 0; j < markerCount; ++j)
         {
           // 3 float, Tx, Ty, Tz
-          api->Bx3DMarkerPosition[i][j][0] = *(float*)replyIndex;
+          position[j][0] = *(float*)replyIndex;
           replyIndex += 4;
-          api->Bx3DMarkerPosition[i][j][1] = *(float*)replyIndex;
+          position[j][1] = *(float*)replyIndex;
           replyIndex += 4;
-          api->Bx3DMarkerPosition[i][j][2] = *(float*)replyIndex;
+          position[j][2] = *(float*)replyIndex;
           replyIndex += 4;
         }
       }
@@ -2103,18 +3547,33 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
 
     if (mode & NDI_PASSIVE_STRAY)
     {
+      if (replyEnd - replyIndex < 1)
+      {
+        ndiBXTruncated(api);
+        return;
+      }
+
       // Save marker count
-      api->BxPassiveStrayCount = (char)replyIndex[0];
+      unsigned char strayCount = (unsigned char)replyIndex[0];
       replyIndex++;
 
-      if (api->BxPassiveStrayCount > 240)
+      int numBytes = (strayCount + 7) / 8;
+      if (replyEnd - replyIndex < numBytes + strayCount * 12)
+      {
+        ndiBXTruncated(api);
+        return;
+      }
+      api->BxPassiveStrayOutOfVolume = (char*)ndiArenaAlloc(arena, numBytes);
+      api->BxPassiveStrayPosition = (float(*)[3])ndiArenaAlloc(arena, strayCount * sizeof(float[3]));
+      if (api->BxPassiveStrayOutOfVolume == NULL || api->BxPassiveStrayPosition == NULL)
       {
-        // This implementation cannot report on more than 240 stray passive markers
-        api->BxPassiveStrayCount = 240;
+        api->BxHandleCount = 0;
+        ndiSetError(api, NDI_BAD_ALLOC);
+        return;
       }
+      api->BxPassiveStrayCount = strayCount;
 
       // Save off out of volume status
-      int numBytes = static_cast<int>(ceilf(api->BxPassiveStrayCount / 8.f));
       for (int j = 0; j < numBytes; ++j)
       {
         api->BxPassiveStrayOutOfVolume[j] = (char)replyIndex[0];
@@ -2134,6 +3593,11 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
     }
 
     // Get the system status
+    if (replyEnd - replyIndex < 2)
+    {
+      ndiBXTruncated(api);
+      return;
+    }
     api->BxSystemStatus = (char)replyIndex[1] << 8 | (char)replyIndex[0];
     replyIndex += 2;
   }
@@ -2147,7 +3611,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
   //
   // This information can be later extracted through one of the ndiGetGXxx()
   // functions.
-  void ndiGXHelper(ndicapi* pol, const char* command, const char* commandReply)
+  void ndiGXHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
     unsigned long mode = NDI_XFORMS_AND_STATUS; // the default reply mode
     char* writePointer;
@@ -2160,6 +3624,9 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       mode = ndiHexToUnsignedLong(&command[3], 4);
     }
 
+    pol->FrameSource = NDI_FRAME_GX;
+    pol->FrameIsBuilt = false;
+
     // always three active ports
     activeCount = 3;
 
@@ -2357,7 +3824,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
 
   //----------------------------------------------------------------------------
   // Copy all the PSTAT reply information into the ndicapi structure.
-  void ndiPSTATHelper(ndicapi* pol, const char* command, const char* commandReply)
+  void ndiPSTATHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
     unsigned long mode = NDI_XFORMS_AND_STATUS; // the default reply mode
     char* writePointer;
@@ -2540,7 +4007,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
 
   //----------------------------------------------------------------------------
   // Copy all the SSTAT reply information into the ndicapi structure.
-  void ndiSSTATHelper(ndicapi* pol, const char* command, const char* commandReply)
+  void ndiSSTATHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
     unsigned long mode;
     char* writePointer;
@@ -2572,7 +4039,7 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
 
   //----------------------------------------------------------------------------
   // Copy all the IRCHK reply information into the ndicapi structure.
-  void ndiIRCHKHelper(ndicapi* pol, const char* command, const char* commandReply)
+  void ndiIRCHKHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
     unsigned long mode = NDI_XFORMS_AND_STATUS; // the default reply mode
     int j;
@@ -2601,8 +4068,9 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
   }
 
   //----------------------------------------------------------------------------
-  // Adjust the host to match a COMM command.
-  void ndiCOMMHelper(ndicapi* pol, const char* command, const char* commandReply)
+  // Adjust the host to match a COMM command.  The return value is false if
+  // the transport could not be changed.
+  bool ndiCOMMApply(ndicapi* pol, const char* command)
   {
     static int convert_baud[8] = { 9600, 14400, 19200, 38400, 57600, 115200, 921600, 1228739 };
     char newdps[4] = "8N1";
@@ -2641,575 +4109,2444 @@ void parseFrameComponent(ndicapi* api, const char* data, unsigned short itemOpti
       newhand = 1;
     }
 
-    ndiSerialSleep(pol->SerialDevice, 100);  // let the device adjust itself
-    if (ndiSerialComm(pol->SerialDevice, newspeed, newdps, newhand) != 0)
+    // a transport without a baud rate, such as the network, is left as it is
+    if (pol->Transport->Comm == NULL)
     {
-      ndiSetError(pol, NDI_BAD_COMM);
+      return true;
+    }
+
+    pol->Transport->Sleep(pol, 100);  // let the device adjust itself
+    if (!pol->Transport->Comm(pol, newspeed, newdps, newhand))
+    {
+      return false;
+    }
+    // remember where the device is, for ndiSerialProbeAll(), but only in a
+    // file that the application has asked for
+    char cacheFile[1024];
+    if (pol->SerialDeviceName != NULL && ndiProbeCacheFile(cacheFile, sizeof(cacheFile), false))
+    {
+      ndiProbeCacheWrite(cacheFile, pol->SerialDeviceName, newspeed);
     }
+    return true;
   }
 
   //----------------------------------------------------------------------------
-  // Sleep for 100 milliseconds after an INIT command.
-  void ndiINITHelper(ndicapi* pol, const char* command, const char* commandReply)
+  // Adjust the host to match a COMM command that the device accepted.
+  void ndiCOMMHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
   {
-    if (pol->SerialDevice != NDI_INVALID_HANDLE)
+    if (!ndiCOMMApply(pol, command))
     {
-      ndiSerialSleep(pol->SerialDevice, 100);
-    }
-    else
-    {
-      ndiSocketSleep(pol->Socket, 100);
+      ndiSetError(pol, NDI_BAD_COMM);
     }
   }
+
+  //----------------------------------------------------------------------------
+  // Sleep for 100 milliseconds after an INIT command.
+  void ndiINITHelper(ndicapi* pol, const char* command, const char* commandReply, int replyLength)
+  {
+    pol->Transport->Sleep(pol, 100);
+  }
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport char* ndiCommand(ndicapi* pol, const char* format, ...)
+// Properties of the commands that need special treatment by ndiCommandVA().
+// Commands that are not in the table are sent and received as plain text.
+#define NDI_COMMAND_BINARY           0x01  // the reply is binary
+#define NDI_COMMAND_TRACKING         0x02  // can be served by the tracking thread
+#define NDI_COMMAND_STOPS_TRACKING   0x04
+#define NDI_COMMAND_STARTS_TRACKING  0x08
+#define NDI_COMMAND_SESSION          0x10  // configures the device, replayed after a reconnect
+#define NDI_COMMAND_STARTS_SESSION   0x20  // the commands before it need not be replayed
+
+// The table is found through a hash of the command mnemonic, which
+// ndiCommandVA() computes in the same pass as the CRC.  The multiplier is
+// chosen so that no two entries share a slot, this is checked at compile time.
+#define NDI_COMMAND_HASH_MULTIPLIER  107
+#define NDI_COMMAND_HASH_SIZE        128
+
+// Size of the api->Command buffer, the reply buffers start at this size
+#define NDI_COMMAND_BUFFER_SIZE      2048
+
+// Largest binary reply that the reply buffers will grow to hold
+#define NDI_MAX_REPLY_SIZE           (64 * 1024 * 1024)
+
+// A lost link is reopened after a delay that doubles from the first to the
+// longest, until the link has been down for the limit
+#define NDI_RECONNECT_FIRST_DELAY_MS 10
+#define NDI_RECONNECT_MAX_DELAY_MS   1000
+#define NDI_RECONNECT_LIMIT_MS       30000
+
+#define NDI_COMMAND(name, flags, helper)  { name, sizeof(name) - 1, flags, helper }
+
+namespace
 {
-  char* reply;
-  va_list ap;            // see stdarg.h
-  va_start(ap, format);
+  typedef void (*ndiReplyHelper)(ndicapi* api, const char* command, const char* commandReply, int replyLength);
 
-  reply = ndiCommandVA(pol, format, ap);
+  struct ndiCommandInfo
+  {
+    const char* Name;
+    int Length;
+    int Flags;
+    ndiReplyHelper Helper;                // called after a successful reply, can be NULL
+  };
 
-  va_end(ap);
+  constexpr ndiCommandInfo ndiCommands[] =
+  {
+    NDI_COMMAND("BX", NDI_COMMAND_BINARY | NDI_COMMAND_TRACKING, ndiBXHelper),
+    NDI_COMMAND("BX2", NDI_COMMAND_BINARY | NDI_COMMAND_TRACKING, ndiBX2Helper),
+    NDI_COMMAND("GX", NDI_COMMAND_TRACKING, ndiGXHelper),
+    NDI_COMMAND("TX", NDI_COMMAND_TRACKING, ndiTXHelper),
+    NDI_COMMAND("GETLOG", NDI_COMMAND_BINARY, NULL),
+    NDI_COMMAND("VGET", NDI_COMMAND_BINARY, NULL),
+    NDI_COMMAND("TSTART", NDI_COMMAND_STARTS_TRACKING | NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("TSTOP", NDI_COMMAND_STOPS_TRACKING, NULL),
+    NDI_COMMAND("INIT", NDI_COMMAND_STOPS_TRACKING | NDI_COMMAND_SESSION | NDI_COMMAND_STARTS_SESSION, ndiINITHelper),
+    NDI_COMMAND("COMM", NDI_COMMAND_SESSION, ndiCOMMHelper),
+    NDI_COMMAND("IRCHK", 0, ndiIRCHKHelper),
+    NDI_COMMAND("PHINF", 0, ndiPHINFHelper),
+    NDI_COMMAND("PHRQ", NDI_COMMAND_SESSION, ndiPHRQHelper),
+    NDI_COMMAND("PHSR", 0, ndiPHSRHelper),
+    NDI_COMMAND("PSTAT", 0, ndiPSTATHelper),
+    NDI_COMMAND("SSTAT", 0, ndiSSTATHelper),
+    NDI_COMMAND("PHF", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("PVWR", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("PINIT", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("PENA", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("PDIS", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("PFSEL", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("PSOUT", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("TTCFG", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("IRATE", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("VSEL", NDI_COMMAND_SESSION, NULL),
+    NDI_COMMAND("SET", NDI_COMMAND_SESSION, NULL)
+  };
+  constexpr int ndiCommandCount = sizeof(ndiCommands) / sizeof(ndiCommands[0]);
 
-  return reply;
-}
+  //----------------------------------------------------------------------------
+  constexpr unsigned int ndiCommandHash(const char* name, int length, unsigned int hash)
+  {
+    return length == 0 ? hash : ndiCommandHash(name + 1, length - 1, hash * NDI_COMMAND_HASH_MULTIPLIER + (unsigned char)name[0]);
+  }
 
-//----------------------------------------------------------------------------
-ndicapiExport char* ndiCommandVA(ndicapi* api, const char* format, va_list ap)
-{
-  int i, bytes, commandLength;
-  bool useCrc = false;
-  bool inCommand = true;
-  char* command;
-  char* reply;
-  char* commandReply;
-  int errorCode = 0;
-
-  command = api->Command;       // text sent to ndicapi
-  reply = api->Reply;     // text received from ndicapi
-  commandReply = api->ReplyNoCRC;   // received text, with CRC hacked off
-  commandLength = 0;                  // length of 'command' part of command
+  //----------------------------------------------------------------------------
+  constexpr unsigned int ndiCommandSlot(int i)
+  {
+    return ndiCommandHash(ndiCommands[i].Name, ndiCommands[i].Length, 0) % NDI_COMMAND_HASH_SIZE;
+  }
 
-  api->ErrorCode = 0;                 // clear error
-  command[0] = '\0';
-  reply[0] = '\0';
-  commandReply[0] = '\0';
+  //----------------------------------------------------------------------------
+  // Index of the first entry that hashes to the slot, or -1
+  constexpr int ndiCommandFind(unsigned int slot, int i)
+  {
+    return i == ndiCommandCount ? -1 : (ndiCommandSlot(i) == slot ? i : ndiCommandFind(slot, i + 1));
+  }
 
-  // verify that the serial device was opened
-  if (api->SerialDevice == NDI_INVALID_HANDLE && api->Hostname == NULL && api->Port < 0)
+  //----------------------------------------------------------------------------
+  constexpr bool ndiCommandHashIsPerfect(int i)
   {
-    ndiSetError(api, NDI_OPEN_ERROR);
-    return commandReply;
+    return i == ndiCommandCount || (ndiCommandFind(ndiCommandSlot(i), 0) == i && ndiCommandHashIsPerfect(i + 1));
   }
 
-  // if the command is NULL, send a break to reset the Measurement System
-  if (format == NULL)
+  static_assert(ndiCommandHashIsPerfect(0), "two commands share a hash slot, change NDI_COMMAND_HASH_MULTIPLIER");
+
+#define NDI_COMMAND_SLOTS4(s)  ndiCommandFind(s, 0), ndiCommandFind(s + 1, 0), ndiCommandFind(s + 2, 0), ndiCommandFind(s + 3, 0)
+#define NDI_COMMAND_SLOTS16(s) NDI_COMMAND_SLOTS4(s), NDI_COMMAND_SLOTS4(s + 4), NDI_COMMAND_SLOTS4(s + 8), NDI_COMMAND_SLOTS4(s + 12)
+#define NDI_COMMAND_SLOTS64(s) NDI_COMMAND_SLOTS16(s), NDI_COMMAND_SLOTS16(s + 16), NDI_COMMAND_SLOTS16(s + 32), NDI_COMMAND_SLOTS16(s + 48)
+
+  // Entry in ndiCommands[] for each hash slot, or -1
+  const signed char ndiCommandSlots[NDI_COMMAND_HASH_SIZE] =
   {
-    if (api->IsThreadedMode && api->IsTracking)
+    NDI_COMMAND_SLOTS64(0), NDI_COMMAND_SLOTS64(64)
+  };
+
+#undef NDI_COMMAND_SLOTS64
+#undef NDI_COMMAND_SLOTS16
+#undef NDI_COMMAND_SLOTS4
+
+  //----------------------------------------------------------------------------
+  // Find the table entry for a command, given the hash of its mnemonic.
+  // Returns NULL if the command needs no special treatment.
+  const ndiCommandInfo* ndiLookupCommand(const char* command, int commandLength, unsigned int hash)
+  {
+    int i = ndiCommandSlots[hash % NDI_COMMAND_HASH_SIZE];
+    if (i >= 0 && ndiCommands[i].Length == commandLength &&
+        strncmp(ndiCommands[i].Name, command, commandLength) == 0)
     {
-      // block the tracking thread
-      ndiMutexLock(api->ThreadMutex);
+      return &ndiCommands[i];
     }
-    api->IsTracking = false;
+    return NULL;
+  }
+}
+
+//----------------------------------------------------------------------------
+// The commands of a device-pushed stream, see ndiStartStreaming()
+struct ndiStreaming
+{
+  ndiEncodedCommand Command;              // the command whose replies are pushed
+  ndiEncodedCommand Start;                // STREAM, sent again after a reconnect
+  ndiEncodedCommand Stop;                 // USTREAM
+  bool IsBinary;                          // whether the replies are binary
+};
 
-    if (api->SerialDevice != NDI_INVALID_HANDLE)
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Make a buffer at least 'size' bytes long, keeping its contents.  The
+  // buffer is doubled, so a run of long replies only reallocates it once.
+  bool ndiGrowBuffer(char*& buffer, int& bufferSize, int size)
+  {
+    if (size <= bufferSize)
     {
-      ndiSerialComm(api->SerialDevice, 9600, "8N1", 0);
-      ndiSerialFlush(api->SerialDevice, NDI_IOFLUSH);
-      ndiSerialBreak(api->SerialDevice);
-      bytes = ndiSerialRead(api->SerialDevice, reply, 2047, false, &errorCode);
+      return true;
     }
-    else
+
+    int newSize = (bufferSize > 0 ? bufferSize : size);
+    while (newSize < size)
     {
-      int errorCode;
-      bytes = ndiSocketRead(api->Socket, reply, 2047, false, &errorCode);
+      newSize = (newSize < NDI_MAX_REPLY_SIZE / 2 ? newSize * 2 : size);
     }
-
-    // check for correct reply
-    if (strncmp(reply, "RESETBE6F\r", 8) != 0)
+    char* newBuffer = (char*)realloc(buffer, newSize);
+    if (newBuffer == NULL)
     {
-      ndiSetError(api, NDI_RESET_FAIL);
-      return commandReply;
+      return false;
     }
+    buffer = newBuffer;
+    bufferSize = newSize;
 
-    // terminate the reply string
-    reply[bytes] = '\0';
-    bytes -= 5;
-    strncpy(commandReply, reply, bytes);
-    commandReply[bytes] = '\0';
+    return true;
+  }
 
-    // return the reply string, minus the CRC
-    return commandReply;
+  //----------------------------------------------------------------------------
+  // The time that a reply may take, as set for the transport
+  int ndiTransportTimeout(ndicapi* api)
+  {
+    return api->Transport->GetTimeout(api);
   }
 
-  vsprintf(command, format, ap);                    // format parameters
+  //----------------------------------------------------------------------------
+  // Flush the transport, and forget whatever is in the receive buffer
+  void ndiTransportFlush(ndicapi* api, int flushtype)
+  {
+    if (api->IsTransportOpen)
+    {
+      api->Transport->Flush(api, flushtype);
+    }
+    api->ReceiveStart = 0;
+    api->ReceiveLength = 0;
+  }
 
-  unsigned short CRC16 = 0;                         // calculate CRC
-  for (i = 0; command[i] != '\0'; i++)
+  //----------------------------------------------------------------------------
+  // Read whatever has arrived into the receive buffer, after waiting for at
+  // most 'milliseconds' for the first byte.  There is always room to read
+  // NDI_RECEIVE_CHUNK bytes, or the 'expected' bytes that are known to be on
+  // their way, so that most replies take a single read.  Bytes past the end
+  // of a reply stay in the buffer for the next one.  The return value is as
+  // for ndiSerialReadSome(), and a closed transport is a lost link.
+  int ndiReceive(ndicapi* api, int expected, int milliseconds)
   {
-    CalcCRC16(command[i], &CRC16);
-    if (inCommand && command[i] == ':')             // only use CRC if a ':'
+    if (!api->IsTransportOpen)
     {
-      useCrc = true;                                //  follows the command
+      return -1;
     }
-    if (inCommand && !((command[i] >= 'A' && command[i] <= 'Z') ||
-                       (command[i] >= '0' && command[i] <= '9')))
+
+    if (api->ReceiveLength == 0)
     {
-      inCommand = false;                            // 'command' part has ended
-      commandLength = i;                            // command length
+      api->ReceiveStart = 0;
+    }
+
+    int room = (expected > NDI_RECEIVE_CHUNK ? expected : NDI_RECEIVE_CHUNK);
+    if (api->ReceiveSize - api->ReceiveStart - api->ReceiveLength < room)
+    {
+      // move the unread bytes to the front before growing the buffer
+      memmove(api->Receive, api->Receive + api->ReceiveStart, api->ReceiveLength);
+      api->ReceiveStart = 0;
+      if (!ndiGrowBuffer(api->Receive, api->ReceiveSize, api->ReceiveLength + room))
+      {
+        return -1;
+      }
     }
+
+    char* end = api->Receive + api->ReceiveStart + api->ReceiveLength;
+    int n = api->ReceiveSize - api->ReceiveStart - api->ReceiveLength;
+    int m = api->Transport->ReadSome(api, end, n, expected, milliseconds);
+    if (m > 0)
+    {
+      api->ReceiveLength += m;
+    }
+    return m;
   }
-  if (inCommand)
+
+  //----------------------------------------------------------------------------
+  // Read a reply from the Measurement System through the receive buffer,
+  // framed by ndiReplyLength().  The reply buffer is grown to fit the reply.
+  // The return value is as for ndiSerialRead(), and there is always room for
+  // a terminating null after the reply.
+  int ndiReadReply(ndicapi* api, char*& reply, int& replySize, bool isBinary)
   {
-    // Command was sent with no ':'
-    // Example, ndiCommand("INIT");
-    commandLength = i;
+    // the whole reply must arrive within the timeout, however many reads it takes
+    std::chrono::steady_clock::time_point deadline = ndiDeadline(ndiTransportTimeout(api));
+
+    int length;
+    while ((length = ndiReplyLength(api->Receive + api->ReceiveStart, api->ReceiveLength, isBinary)) == 0)
+    {
+      int expected = 0;
+      if (isBinary)
+      {
+        int size = ndiBinaryReplySize(api->Receive + api->ReceiveStart, api->ReceiveLength);
+        if (size > NDI_MAX_REPLY_SIZE)
+        {
+          return -1;
+        }
+        if (size > 0)
+        {
+          expected = size - api->ReceiveLength;
+        }
+      }
+      if (api->ReceiveLength >= NDI_MAX_REPLY_SIZE)
+      {
+        return -1;
+      }
+
+      int m = ndiReceive(api, expected, ndiMillisecondsLeft(deadline));
+      if (m <= 0)
+      {
+        return m;
+      }
+    }
+
+    if (!ndiGrowBuffer(reply, replySize, length + 1))
+    {
+      return -1;
+    }
+    memcpy(reply, api->Receive + api->ReceiveStart, length);
+    api->ReceiveStart += length;
+    api->ReceiveLength -= length;
+
+    return length;
   }
 
-  if (useCrc)
+  //----------------------------------------------------------------------------
+  // Write a command to the transport.  The return value is an error code,
+  // or zero, and a closed transport is a lost link.
+  int ndiTransportWrite(ndicapi* api, const char* command, int length)
   {
-    sprintf(&command[i], "%04X", CRC16);            // tack on the CRC
-    i += 4;
+    int bytes = (api->IsTransportOpen ? api->Transport->Write(api, command, length) : -1);
+    if (bytes < 0)
+    {
+      return NDI_WRITE_ERROR;
+    }
+    else if (bytes < length)
+    {
+      return NDI_TIMEOUT;
+    }
+    return 0;
   }
 
-  command[i++] = '\r';                              // tack on carriage return
-  command[i] = '\0';                                // terminate for good luck
+  //----------------------------------------------------------------------------
+  // Read the next reply from the Measurement System into api->Reply, which
+  // is terminated unless the reply is binary.  The return value is an error
+  // code, or zero.
+  int ndiCommandReceive(ndicapi* api, bool isBinary, int& bytes)
+  {
+    int errorCode = 0;
 
-  bool isBinary = (strncmp(command, "BX", commandLength) == 0 && commandLength == strlen("BX")) ||
-                   (strncmp(command, "BX2", commandLength) == 0 && commandLength == strlen("BX2")) ||
-                   (strncmp(command, "GETLOG", commandLength) == 0 && commandLength == strlen("GETLOG")) ||
-                   (strncmp(command, "VGET", commandLength) == 0 && commandLength == strlen("VGET"));
+    bytes = ndiReadReply(api, api->Reply, api->ReplySize, isBinary);
+    if (bytes < 0)
+    {
+      errorCode = NDI_READ_ERROR;
+      bytes = 0;
+    }
+    else if (bytes == 0)
+    {
+      errorCode = NDI_TIMEOUT;
+    }
+    if (!isBinary)
+    {
+      api->Reply[bytes] = '\0';   // terminate string
+    }
 
+    return errorCode;
+  }
 
-  // if the command is GX, TX, or BX and thread_mode is on, we copy the reply from
-  //  the thread rather than getting it directly from the Measurement System
-  if (api->IsThreadedMode && api->IsTracking &&
-      (commandLength == 2 || commandLength == 3) && 
-        ((command[0] == 'G' && command[1] == 'X') ||
-        (command[0] == 'T' && command[1] == 'X') ||
-        (command[0] == 'B' && command[1] == 'X') || 
-        (command[0] == 'B' && command[1] == 'X' && command[2] == '2')))
+  //----------------------------------------------------------------------------
+  // Send a command straight to the Measurement System and read the reply
+  // into api->Reply, which is terminated unless the reply is binary.  The
+  // return value is an error code, or zero.
+  int ndiCommandExchange(ndicapi* api, const char* command, int length, bool isBinary, int& bytes)
   {
-    // check that the thread is sending the GX/BX/TX/BX2 command that we want
-    if (strcmp(command, api->ThreadCommand) != 0)
+    // flush the input buffer, because anything that we haven't read
+    //   yet is garbage left over by a previously failed command
+    ndiTransportFlush(api, NDI_IFLUSH);
+
+    // send the command to the Measurement System
+    int errorCode = ndiTransportWrite(api, command, length);
+
+    // read the reply from the Measurement System
+    bytes = 0;
+    if (errorCode == 0)
     {
-      // tell thread to start using the new GX/BX/TX/BX2 command
-      ndiMutexLock(api->ThreadMutex);
-      strcpy(api->ThreadCommand, command);
-      api->IsThreadedCommandBinary = (command[0] == 'B');
-      ndiMutexUnlock(api->ThreadMutex);
-      // wait for the next data record to arrive (we have to throw it away)
-      if (ndiEventWait(api->ThreadBufferEvent, 5000))
-      {
-        ndiSetError(api, NDI_TIMEOUT);
-        return commandReply;
-      }
+      errorCode = ndiCommandReceive(api, isBinary, bytes);
     }
-    // there is usually no wait, because usually new data is ready
-    if (ndiEventWait(api->ThreadBufferEvent, 5000))
+
+    return errorCode;
+  }
+
+  //----------------------------------------------------------------------------
+  // Check the CRC of the reply in api->Reply, copy the reply without its CRC
+  // to api->ReplyNoCRC and pass it to the helper for the command.  Errors are
+  // reported through ndiSetError().
+  char* ndiCommandFinish(ndicapi* api, const char* command, const ndiCommandInfo* commandInfo, bool isBinary, int bytes)
+  {
+    int i;
+    char* reply = api->Reply;
+    char* commandReply = api->ReplyNoCRC;
+
+    // back up to before the CRC
+    if (!isBinary)
     {
-      ndiSetError(api, NDI_TIMEOUT);
-      return commandReply;
+      bytes -= 5; // 4 ASCII chars
     }
-    // copy the thread's reply buffer into the main reply buffer
-    ndiMutexLock(api->ThreadBufferMutex);
-    for (bytes = 0; api->ThreadBuffer[bytes] != '\0'; bytes++)
+    else
     {
-      reply[bytes] = api->ThreadBuffer[bytes];
+      bytes -= 2; // 2 bytes (unsigned short)
     }
-    if (!isBinary)
+    if (bytes < 0)
     {
-      reply[bytes] = '\0';   // terminate string
+      ndiSetError(api, NDI_BAD_CRC);
+      return commandReply;
     }
-    errorCode = api->ThreadErrorCode;
-    ndiMutexUnlock(api->ThreadBufferMutex);
 
-    if (errorCode != 0)
+    // the reply without its CRC needs as much room as the reply
+    if (!ndiGrowBuffer(api->ReplyNoCRC, api->ReplyNoCRCSize, bytes + 1))
     {
-      ndiSetError(api, errorCode);
+      ndiSetError(api, NDI_READ_ERROR);
       return commandReply;
     }
-  }
-  // if the command is not a GX or thread_mode is not on, then
-  //   send the command directly to the Measurement System and get a reply
-  else
-  {
-    bool isThreadMode = api->IsThreadedMode;
+    commandReply = api->ReplyNoCRC;
 
-    if (isThreadMode && api->IsTracking)
+    // calculate the CRC and copy serial_reply to command_reply
+    unsigned short CRC16 = 0;
+    for (i = 0; i < bytes; i++)
     {
-      // block the tracking thread while we slip this command through
-      ndiMutexLock(api->ThreadMutex);
+      CalcCRC16(reply[i], &CRC16);
+      commandReply[i] = reply[i];
     }
 
-    // change pol->tracking if either TSTOP or TSTART is sent
-    if ((commandLength == 5 && strncmp(command, "TSTOP", commandLength) == 0) ||
-        (commandLength == 4 && strncmp(command, "INIT", commandLength) == 0))
+    if (!isBinary)
     {
-      api->IsTracking = false;
+      // terminate command_reply before the CRC
+      commandReply[i] = '\0';
     }
-    else if (commandLength == 6 && strncmp(command, "TSTART", commandLength) == 0)
+
+    if (!isBinary)
+    {
+      // read and check the CRC value of the reply
+      if (CRC16 != ndiHexToUnsignedLong(&reply[bytes], 4))
+      {
+        ndiSetError(api, NDI_BAD_CRC);
+        return commandReply;
+      }
+    }
+    else
     {
-      api->IsTracking = true;
-      if (isThreadMode)
+      unsigned short replyCrc = (unsigned char)reply[bytes + 1] << 8 | (unsigned char)reply[bytes];
+      if (replyCrc != CRC16)
       {
-        // this will force the thread to wait until the application sends the first GX command
-        api->ThreadCommand[0] = '\0';
+        ndiSetError(api, NDI_BAD_CRC);
+        return commandReply;
       }
     }
 
-    if (api->SerialDevice != NDI_INVALID_HANDLE)
+    // check for error code
+    if (commandReply[0] == 'E' && strncmp(commandReply, "ERROR", 5) == 0)
     {
-      // flush the input buffer, because anything that we haven't read
-      //   yet is garbage left over by a previously failed command
-      ndiSerialFlush(api->SerialDevice, NDI_IFLUSH);
+      ndiSetError(api, (int)ndiHexToUnsignedLong(&commandReply[5], 2));
+      return commandReply;
     }
-    else
+
+    // special behavior for specific commands
+    if (commandInfo != NULL && commandInfo->Helper != NULL)
     {
-      ndiSocketFlush(api->Socket, NDI_IFLUSH);
+      commandInfo->Helper(api, command, commandReply, bytes);
     }
 
-    // send the command to the Measurement System
-    if (api->SerialDevice != NDI_INVALID_HANDLE)
+    // return the Measurement System reply, but with the CRC hacked off
+    return commandReply;
+  }
+
+  //----------------------------------------------------------------------------
+  // Remember a configuration command that the device accepted, so that it
+  // can be replayed by ndiReconnect().  TSTART is kept apart, because it is
+  // only replayed if tracking was on when the link was lost.
+  void ndiSessionRecord(ndicapi* api, const char* command, int length, int commandFlags)
+  {
+    if (commandFlags & NDI_COMMAND_STARTS_TRACKING)
     {
-      bytes = ndiSerialWrite(api->SerialDevice, command, i);
+      if (length < (int)sizeof(api->SessionTrackingCommand))
+      {
+        memcpy(api->SessionTrackingCommand, command, length);
+        api->SessionTrackingCommand[length] = '\0';
+      }
+      return;
     }
-    else
+
+    if (commandFlags & NDI_COMMAND_STARTS_SESSION)
     {
-      bytes = ndiSocketWrite(api->Socket, command, i);
+      api->SessionLogLength = 0;
     }
-    if (bytes < 0)
+    if (ndiGrowBuffer(api->SessionLog, api->SessionLogSize, api->SessionLogLength + length))
     {
-      errorCode = NDI_WRITE_ERROR;
+      memcpy(api->SessionLog + api->SessionLogLength, command, length);
+      api->SessionLogLength += length;
     }
-    else if (bytes < i)
+  }
+
+  //----------------------------------------------------------------------------
+  // Add the CRC and carriage return to a command that has no parameters.
+  void ndiSessionEncode(char* buffer, const char* text)
+  {
+    unsigned short CRC16 = 0;
+    int i;
+    for (i = 0; text[i] != '\0'; i++)
     {
-      errorCode = NDI_TIMEOUT;
+      buffer[i] = text[i];
+      CalcCRC16(text[i], &CRC16);
+    }
+    sprintf(&buffer[i], "%04X\r", CRC16);
+  }
+
+  //----------------------------------------------------------------------------
+  // Send one command of a recorded session, as ndiCommandVA() would but
+  // without going through the tracking thread.  The tracking thread itself
+  // passes 'inThread', and then the reply is read into api->ThreadReply and
+  // is only checked for an ERROR, because api->Reply, the error code and
+  // the state that the helpers fill in belong to the application.  Only
+  // the change to the link that a COMM makes is carried out.
+  bool ndiSessionSend(ndicapi* api, const char* command, int length, bool inThread)
+  {
+    char text[NDI_COMMAND_BUFFER_SIZE];
+    if (length >= NDI_COMMAND_BUFFER_SIZE)
+    {
+      return false;
     }
+    memcpy(text, command, length);
+    text[length] = '\0';
 
-    // read the reply from the Measurement System
-    bytes = 0;
-    if (errorCode == 0)
+    unsigned int commandHash = 0;
+    int commandLength = 0;
+    while ((text[commandLength] >= 'A' && text[commandLength] <= 'Z') ||
+           (text[commandLength] >= '0' && text[commandLength] <= '9'))
     {
-      if (api->SerialDevice != NDI_INVALID_HANDLE)
-      {
-        bytes = ndiSerialRead(api->SerialDevice, reply, 2047, isBinary, &errorCode);
-      }
-      else
+      commandHash = commandHash * NDI_COMMAND_HASH_MULTIPLIER + (unsigned char)text[commandLength];
+      commandLength++;
+    }
+    const ndiCommandInfo* commandInfo = ndiLookupCommand(text, commandLength, commandHash);
+    bool isBinary = (commandInfo != NULL && (commandInfo->Flags & NDI_COMMAND_BINARY) != 0);
+
+    int bytes;
+    if (inThread)
+    {
+      ndiTransportFlush(api, NDI_IFLUSH);
+      if (ndiTransportWrite(api, text, length) != 0)
       {
-        bytes = ndiSocketRead(api->Socket, reply, 2047, isBinary, &errorCode);
+        return false;
       }
-      if (bytes < 0)
+      bytes = ndiReadReply(api, api->ThreadReply, api->ThreadReplySize, isBinary);
+      if (bytes <= 0 || ndiReplyErrorCode(api->ThreadReply, bytes) != 0)
       {
-        errorCode = NDI_READ_ERROR;
-        bytes = 0;
+        return false;
       }
-      else if (bytes == 0)
+      if (commandInfo != NULL && commandInfo->Helper == &ndiCOMMHelper)
       {
-        errorCode = NDI_TIMEOUT;
+        return ndiCOMMApply(api, text);
       }
-      if (!isBinary)
+      if (commandInfo != NULL && commandInfo->Helper == &ndiINITHelper)
       {
-        reply[bytes] = '\0';   // terminate string
+        api->Transport->Sleep(api, 100);
       }
+      return true;
     }
 
-    if (isThreadMode & api->IsTracking)
-    {
-      // unblock the tracking thread
-      ndiMutexUnlock(api->ThreadMutex);
-    }
-
-    if (errorCode != 0)
+    api->ErrorCode = 0;
+    if (ndiCommandExchange(api, text, length, isBinary, bytes) != 0)
     {
-      ndiSetError(api, errorCode);
-      return commandReply;
+      return false;
     }
+    ndiCommandFinish(api, text, commandInfo, isBinary, bytes);
+    return (api->ErrorCode == 0);
   }
 
-  // back up to before the CRC
-  if (!isBinary)
-  {
-    bytes -= 5; // 4 ASCII chars
-  }
-  else
-  {
-    bytes -= 2; // 2 bytes (unsigned short)
-  }
-  if (bytes < 0)
+  //----------------------------------------------------------------------------
+  // Close the transport after the link was lost
+  void ndiTransportClose(ndicapi* api)
   {
-    ndiSetError(api, NDI_BAD_CRC);
-    return commandReply;
+    if (api->IsTransportOpen)
+    {
+      api->Transport->Close(api);
+      api->IsTransportOpen = false;
+    }
   }
 
-  // calculate the CRC and copy serial_reply to command_reply
-  CRC16 = 0;
-  for (i = 0; i < bytes; i++)
+  //----------------------------------------------------------------------------
+  // Open the transport again, with the reply timeout that it had before.  A
+  // device that can take a break, i.e. a serial device, is reset with one,
+  // so that the session is replayed from a known state at 9600 baud.
+  bool ndiTransportReopen(ndicapi* api, int timeout, bool inThread)
   {
-    CalcCRC16(reply[i], &CRC16);
-    commandReply[i] = reply[i];
-  }
+    api->ReceiveStart = 0;
+    api->ReceiveLength = 0;
 
-  if (!isBinary)
-  {
-    // terminate command_reply before the CRC
-    commandReply[i] = '\0';
-  }
+    if (!api->Transport->Open(api, api->TransportAddress))
+    {
+      return false;
+    }
+    api->IsTransportOpen = true;
 
-  if (errorCode != 0)
-  {
-    // Any above errors are caught here and returned after the command has had its CRC stripped
-    return commandReply;
-  }
+    if (!api->Transport->SetTimeout(api, timeout))
+    {
+      ndiTransportClose(api);
+      return false;
+    }
 
-  if (!isBinary)
-  {
-    // read and check the CRC value of the reply
-    if (CRC16 != ndiHexToUnsignedLong(&reply[bytes], 4))
+    if (api->Transport->Break != NULL)
     {
-      ndiSetError(api, NDI_BAD_CRC);
+      ndiTransportFlush(api, NDI_IOFLUSH);
+      api->Transport->Break(api);
+      char*& reply = (inThread ? api->ThreadReply : api->Reply);
+      int& replySize = (inThread ? api->ThreadReplySize : api->ReplySize);
+      int bytes = ndiReadReply(api, reply, replySize, false);
+      if (bytes < 8 || strncmp(reply, "RESETBE6F\r", 8) != 0)
+      {
+        ndiTransportClose(api);
+        return false;
+      }
+      return true;
+    }
+
+    // the device is not reset by a new connection, and may still be tracking
+    char stop[16];
+    ndiSessionEncode(stop, "TSTOP:");
+    ndiSessionSend(api, stop, (int)strlen(stop), inThread);
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Send the recorded session to the device, and TSTART if it was tracking.
+  // The tracking thread only replays while the application has it tracking,
+  // and leaves api->IsTracking alone.
+  bool ndiSessionReplay(ndicapi* api, bool tracking, bool inThread)
+  {
+    if (!inThread)
+    {
+      api->IsTracking = false;
+    }
+
+    const char* command = api->SessionLog;
+    const char* end = api->SessionLog + api->SessionLogLength;
+    while (command < end)
+    {
+      const char* cr = (const char*)memchr(command, '\r', end - command);
+      int length = (int)(cr - command) + 1;
+      if (!ndiSessionSend(api, command, length, inThread))
+      {
+        return false;
+      }
+      command += length;
+    }
+
+    if (tracking)
+    {
+      if (api->SessionTrackingCommand[0] == '\0')
+      {
+        ndiSessionEncode(api->SessionTrackingCommand, "TSTART:");
+      }
+      if (!ndiSessionSend(api, api->SessionTrackingCommand, (int)strlen(api->SessionTrackingCommand), inThread))
+      {
+        return false;
+      }
+      if (!inThread)
+      {
+        api->IsTracking = true;
+      }
+
+      // the device forgets its stream along with the rest of the session
+      if (api->Streaming != NULL && !ndiSessionSend(api, api->Streaming->Start.Text, api->Streaming->Start.Length, inThread))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Restore the session after the link to the Measurement System was lost.
+  // The link is reopened and the recorded configuration commands are
+  // replayed, with a growing delay between attempts, until it succeeds or
+  // NDI_RECONNECT_LIMIT_MS have passed.  The tracking thread passes
+  // 'inThread' so that it gives up when the thread mode is turned off, and
+  // so that it only touches the transport and its own buffers.  It holds
+  // api->ThreadMutex throughout, which keeps the application off the link.
+  bool ndiReconnect(ndicapi* api, bool tracking, bool inThread)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::milliseconds(NDI_RECONNECT_LIMIT_MS);
+    int timeout = ndiTransportTimeout(api);
+    int delay = NDI_RECONNECT_FIRST_DELAY_MS;
+    bool reconnected = false;
+
+    if (!inThread)
+    {
+      api->IsReconnecting = true;
+    }
+    ndiTransportClose(api);
+    while (!(inThread && !api->IsThreadedMode))
+    {
+      if (ndiTransportReopen(api, timeout, inThread))
+      {
+        if (ndiSessionReplay(api, tracking, inThread))
+        {
+          reconnected = true;
+          break;
+        }
+        ndiTransportClose(api);
+      }
+
+      int left = ndiMillisecondsLeft(deadline);
+      if (left == 0)
+      {
+        break;
+      }
+      api->Transport->Sleep(api, (delay < left ? delay : left));
+      delay = (2 * delay < NDI_RECONNECT_MAX_DELAY_MS ? 2 * delay : NDI_RECONNECT_MAX_DELAY_MS);
+    }
+    if (!inThread)
+    {
+      api->IsReconnecting = false;
+    }
+
+    int outage = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    if (reconnected)
+    {
+      // the application reads these through the thread's buffer lock
+      if (inThread)
+      {
+        ndiMutexLock(api->ThreadBufferMutex);
+      }
+      api->ReconnectCount++;
+      api->ReconnectOutageMs = outage;
+      if (inThread)
+      {
+        ndiMutexUnlock(api->ThreadBufferMutex);
+      }
+    }
+    if (api->ReconnectCallback)
+    {
+      api->ReconnectCallback(api, reconnected, outage, api->ReconnectCallbackData);
+    }
+    return reconnected;
+  }
+
+  //----------------------------------------------------------------------------
+  // Send a command that already has its CRC and carriage return, read the
+  // reply and pass it to the helper for the command.  The mnemonic length and
+  // hash are as computed by ndiCommandVA() or by the ndiEncode functions.
+  char* ndiCommandSend(ndicapi* api, const char* command, int length, int commandLength, unsigned int commandHash)
+  {
+    int bytes;
+    int errorCode = 0;
+    char* reply = api->Reply;
+    char* commandReply = api->ReplyNoCRC;
+
+    const ndiCommandInfo* commandInfo = ndiLookupCommand(command, commandLength, commandHash);
+    int commandFlags = (commandInfo != NULL ? commandInfo->Flags : 0);
+    bool isBinary = (commandFlags & NDI_COMMAND_BINARY) != 0;
+
+    // while the device pushes a stream, the reply to any other command would
+    //  be mixed up with it, and the streamed command is only answered by the thread
+    if (api->Streaming != NULL &&
+        !(api->IsThreadedMode && api->IsTracking && strcmp(command, api->Streaming->Command.Text) == 0))
+    {
+      ndiSetError(api, NDI_STREAMING);
       return commandReply;
     }
+
+    // if the command is GX, TX, BX or BX2 and thread_mode is on, we copy the reply from
+    //  the thread rather than getting it directly from the Measurement System
+    if (api->IsThreadedMode && api->IsTracking && (commandFlags & NDI_COMMAND_TRACKING))
+    {
+      // check that the thread is sending the GX/BX/TX/BX2 command that we want
+      if (strcmp(command, api->ThreadCommand) != 0)
+      {
+        // tell thread to start using the new GX/BX/TX/BX2 command
+        ndiMutexLock(api->ThreadMutex);
+        strcpy(api->ThreadCommand, command);
+        api->IsThreadedCommandBinary = isBinary;
+        ndiMutexUnlock(api->ThreadMutex);
+        // wait for the next data record to arrive (we have to throw it away)
+        if (ndiEventWait(api->ThreadBufferEvent, 5000))
+        {
+          ndiSetError(api, NDI_TIMEOUT);
+          return commandReply;
+        }
+      }
+      // there is usually no wait, because usually new data is ready
+      if (ndiEventWait(api->ThreadBufferEvent, 5000))
+      {
+        ndiSetError(api, NDI_TIMEOUT);
+        return commandReply;
+      }
+      // copy the thread's reply buffer into the main reply buffer
+      ndiMutexLock(api->ThreadBufferMutex);
+      bytes = api->ThreadBufferLength;
+      errorCode = api->ThreadErrorCode;
+      if (!ndiGrowBuffer(api->Reply, api->ReplySize, bytes + 1))
+      {
+        bytes = 0;
+        errorCode = NDI_READ_ERROR;
+      }
+      reply = api->Reply;
+      memcpy(reply, api->ThreadBuffer, bytes);
+      if (!isBinary)
+      {
+        reply[bytes] = '\0';   // terminate string
+      }
+      ndiMutexUnlock(api->ThreadBufferMutex);
+
+      if (errorCode != 0)
+      {
+        ndiSetError(api, errorCode);
+        return commandReply;
+      }
+    }
+    // if the command is not a GX or thread_mode is not on, then
+    //   send the command directly to the Measurement System and get a reply
+    else
+    {
+      bool isThreadMode = api->IsThreadedMode;
+      bool wasTracking = api->IsTracking;
+
+      if (isThreadMode && api->IsTracking)
+      {
+        // block the tracking thread while we slip this command through
+        ndiMutexLock(api->ThreadMutex);
+      }
+
+      // change pol->tracking if either TSTOP or TSTART is sent
+      if (commandFlags & NDI_COMMAND_STOPS_TRACKING)
+      {
+        api->IsTracking = false;
+      }
+      else if (commandFlags & NDI_COMMAND_STARTS_TRACKING)
+      {
+        api->IsTracking = true;
+        if (isThreadMode)
+        {
+          // this will force the thread to wait until the application sends the first GX command
+          api->ThreadCommand[0] = '\0';
+        }
+      }
+
+      errorCode = ndiCommandExchange(api, command, length, isBinary, bytes);
+
+      if ((errorCode == NDI_WRITE_ERROR || errorCode == NDI_READ_ERROR) &&
+          api->IsReconnectMode && !api->IsReconnecting)
+      {
+        // restore the session as it was before this command, then retry it
+        bool isTracking = api->IsTracking;
+        if (ndiReconnect(api, wasTracking, false))
+        {
+          api->IsTracking = isTracking;
+          errorCode = ndiCommandExchange(api, command, length, isBinary, bytes);
+        }
+      }
+
+      if (isThreadMode & api->IsTracking)
+      {
+        // unblock the tracking thread
+        ndiMutexUnlock(api->ThreadMutex);
+      }
+
+      if (errorCode != 0)
+      {
+        ndiSetError(api, errorCode);
+        return commandReply;
+      }
+    }
+
+    commandReply = ndiCommandFinish(api, command, commandInfo, isBinary, bytes);
+
+    if ((commandFlags & NDI_COMMAND_SESSION) && api->ErrorCode == 0 && !api->IsReconnecting)
+    {
+      // the tracking thread reads the session when it reconnects, and it is
+      // only running, i.e. not blocked by us, while the device is tracking
+      bool blockThread = api->IsThreadedMode && api->IsTracking;
+      if (blockThread)
+      {
+        ndiMutexLock(api->ThreadMutex);
+      }
+      ndiSessionRecord(api, command, length, commandFlags);
+      if (blockThread)
+      {
+        ndiMutexUnlock(api->ThreadMutex);
+      }
+    }
+
+    return commandReply;
   }
-  else
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport char* ndiCommand(ndicapi* pol, const char* format, ...)
+{
+  char* reply;
+  va_list ap;            // see stdarg.h
+  va_start(ap, format);
+
+  reply = ndiCommandVA(pol, format, ap);
+
+  va_end(ap);
+
+  return reply;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport char* ndiCommandVA(ndicapi* api, const char* format, va_list ap)
+{
+  int i, bytes, commandLength;
+  unsigned int commandHash = 0;
+  bool useCrc = false;
+  bool inCommand = true;
+  char* command;
+  char* reply;
+  char* commandReply;
+
+  command = api->Command;       // text sent to ndicapi
+  reply = api->Reply;     // text received from ndicapi
+  commandReply = api->ReplyNoCRC;   // received text, with CRC hacked off
+  commandLength = 0;                  // length of 'command' part of command
+
+  api->ErrorCode = 0;                 // clear error
+  command[0] = '\0';
+  reply[0] = '\0';
+  commandReply[0] = '\0';
+
+  // verify that the serial device was opened
+  if (api->Transport == NULL)
+  {
+    ndiSetError(api, NDI_OPEN_ERROR);
+    return commandReply;
+  }
+
+  // if the command is NULL, send a break to reset the Measurement System
+  if (format == NULL)
   {
-    unsigned short replyCrc = (unsigned char)reply[bytes + 1] << 8 | (unsigned char)reply[bytes];
-    if (replyCrc != CRC16)
+    if (api->IsThreadedMode && api->IsTracking)
     {
-      ndiSetError(api, NDI_BAD_CRC);
+      // block the tracking thread
+      ndiMutexLock(api->ThreadMutex);
+    }
+    api->IsTracking = false;
+
+    // the device forgets its stream when it is reset, and the thread must
+    // not go on reading it
+    free(api->Streaming);
+    api->Streaming = NULL;
+    if (api->IsThreadedMode)
+    {
+      api->ThreadCommand[0] = '\0';
+    }
+
+    if (api->Transport->Break != NULL)
+    {
+      if (api->Transport->Comm != NULL)
+      {
+        api->Transport->Comm(api, 9600, "8N1", 0);
+      }
+      ndiTransportFlush(api, NDI_IOFLUSH);
+      api->Transport->Break(api);
+    }
+    bytes = ndiReadReply(api, api->Reply, api->ReplySize, false);
+    reply = api->Reply;
+
+    // check for correct reply
+    if (strncmp(reply, "RESETBE6F\r", 8) != 0)
+    {
+      ndiSetError(api, NDI_RESET_FAIL);
       return commandReply;
     }
+
+    // terminate the reply string
+    reply[bytes] = '\0';
+    bytes -= 5;
+    strncpy(commandReply, reply, bytes);
+    commandReply[bytes] = '\0';
+
+    // return the reply string, minus the CRC
+    return commandReply;
   }
 
-  // check for error code
-  if (commandReply[0] == 'E' && strncmp(commandReply, "ERROR", 5) == 0)
+  // format parameters, leaving room for the CRC and carriage return
+  i = vsnprintf(command, NDI_COMMAND_BUFFER_SIZE - 5, format, ap);
+  if (i < 0 || i >= NDI_COMMAND_BUFFER_SIZE - 5)
   {
-    ndiSetError(api, (int)ndiHexToUnsignedLong(&commandReply[5], 2));
+    command[0] = '\0';
+    ndiSetError(api, NDI_COMMAND_TOO_LONG);
     return commandReply;
   }
 
-  // special behavior for specific commands
-  if (command[0] == 'T' && command[1] == 'X' && commandLength == 2)   // the TX command
+  unsigned short CRC16 = 0;                         // calculate CRC
+  for (i = 0; command[i] != '\0'; i++)
+  {
+    CalcCRC16(command[i], &CRC16);
+    if (inCommand && command[i] == ':')             // only use CRC if a ':'
+    {
+      useCrc = true;                                //  follows the command
+    }
+    if (inCommand && !((command[i] >= 'A' && command[i] <= 'Z') ||
+                       (command[i] >= '0' && command[i] <= '9')))
+    {
+      inCommand = false;                            // 'command' part has ended
+      commandLength = i;                            // command length
+    }
+    else if (inCommand)
+    {
+      commandHash = commandHash * NDI_COMMAND_HASH_MULTIPLIER + (unsigned char)command[i];
+    }
+  }
+  if (inCommand)
+  {
+    // Command was sent with no ':'
+    // Example, ndiCommand("INIT");
+    commandLength = i;
+  }
+
+  if (useCrc)
   {
-    ndiTXHelper(api, command, commandReply);
+    sprintf(&command[i], "%04X", CRC16);            // tack on the CRC
+    i += 4;
   }
-  else if (command[0] == 'B' && command[1] == 'X' && commandLength == 2)   // the BX command
+
+  command[i++] = '\r';                              // tack on carriage return
+  command[i] = '\0';                                // terminate for good luck
+
+  return ndiCommandSend(api, command, i, commandLength, commandHash);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport char* ndiCommandEncoded(ndicapi* api, const ndiEncodedCommand* command)
+{
+  api->ErrorCode = 0;                 // clear error
+  api->Reply[0] = '\0';
+  api->ReplyNoCRC[0] = '\0';
+
+  // verify that the serial device was opened
+  if (api->Transport == NULL)
   {
-    ndiBXHelper(api, command, commandReply);
+    ndiSetError(api, NDI_OPEN_ERROR);
+    return api->ReplyNoCRC;
   }
-  else if (command[0] == 'B' && command[1] == 'X' && command[2] == '2' && commandLength == 3)   // the BX2 command
+
+  if (command->Length <= 0)
   {
-    ndiBX2Helper(api, command, commandReply);
+    ndiSetError(api, NDI_COMMAND_TOO_LONG);
+    return api->ReplyNoCRC;
   }
-  else if (command[0] == 'G' && command[1] == 'X' && commandLength == 2)   // the GX command
+
+  return ndiCommandSend(api, command->Text, command->Length, command->MnemonicLength, command->MnemonicHash);
+}
+
+namespace
+{
+  // Progress through a binary reply that is passed on as it arrives
+  struct ndiStreamState
+  {
+    NDIStreamCallback Callback;
+    void* UserData;
+    int Size;                             // the whole reply, from its header
+    int HeaderSize;
+    int Position;                         // bytes of the reply received so far
+    unsigned short CRC;                   // CRC of the reply so far
+    unsigned char ReplyCRC[2];            // the CRC at the end of the reply
+    bool Stopped;                         // the callback asked to stop
+  };
+
+  //----------------------------------------------------------------------------
+  // Take in the next 'n' bytes of the reply, and hand the part of them that
+  // lies between the header and the CRC to the callback
+  void ndiStreamChunk(ndiStreamState& state, const char* chunk, int n)
   {
-    ndiGXHelper(api, command, commandReply);
+    int start = state.Position;
+    int end = start + n;
+    int dataEnd = state.Size - 2;
+
+    for (int i = start; i < end; i++)
+    {
+      if (i < dataEnd)
+      {
+        CalcCRC16(chunk[i - start], &state.CRC);
+      }
+      else
+      {
+        state.ReplyCRC[i - dataEnd] = (unsigned char)chunk[i - start];
+      }
+    }
+
+    int first = (start > state.HeaderSize ? start : state.HeaderSize);
+    int last = (end < dataEnd ? end : dataEnd);
+    if (first < last && !state.Stopped)
+    {
+      if (state.Callback(chunk + (first - start), last - first, last - state.HeaderSize, dataEnd - state.HeaderSize, state.UserData) != 0)
+      {
+        state.Stopped = true;
+      }
+    }
+    state.Position = end;
   }
-  else if (command[0] == 'C' && commandLength == 4 && strncmp(command, "COMM", commandLength) == 0)
+
+  //----------------------------------------------------------------------------
+  // Send a command and stream its binary reply from the receive buffer, which
+  // is never grown to hold all of it.  Returns an error code, or zero.
+  int ndiStreamReply(ndicapi* api, const ndiEncodedCommand* command, NDIStreamCallback callback, void* userdata)
+  {
+    int bytes;
+
+    // flush the input buffer, because anything that we haven't read
+    //   yet is garbage left over by a previously failed command
+    ndiTransportFlush(api, NDI_IFLUSH);
+    int errorCode = ndiTransportWrite(api, command->Text, command->Length);
+    if (errorCode != 0)
+    {
+      return errorCode;
+    }
+
+    // the 8 bytes that hold either header, or the start of an ERROR reply,
+    // must arrive within the timeout, and after that each part of the reply
+    int timeout = ndiTransportTimeout(api);
+    std::chrono::steady_clock::time_point deadline = ndiDeadline(timeout);
+    while (api->ReceiveLength < 8)
+    {
+      bytes = ndiReceive(api, 8 - api->ReceiveLength, ndiMillisecondsLeft(deadline));
+      if (bytes < 0)
+      {
+        return NDI_READ_ERROR;
+      }
+      else if (bytes == 0)
+      {
+        return NDI_TIMEOUT;
+      }
+    }
+    const char* data = api->Receive + api->ReceiveStart;
+    if (strncmp(data, "ERROR", 5) == 0)
+    {
+      errorCode = (int)ndiHexToUnsignedLong(&data[5], 2);
+      ndiReadReply(api, api->Reply, api->ReplySize, false);
+      return errorCode;
+    }
+
+    ndiStreamState state;
+    state.Callback = callback;
+    state.UserData = userdata;
+    state.Size = ndiBinaryReplySize(data, api->ReceiveLength);
+    state.HeaderSize = (data[0] == (char)0xc8 ? 8 : 6);
+    state.Position = 0;
+    state.CRC = 0;
+    state.Stopped = false;
+    if (state.Size < state.HeaderSize + 2)
+    {
+      return NDI_BAD_GBF;
+    }
+
+    // a stopped reply is still read to its end, so that the next command
+    // does not see the rest of it
+    while (state.Position < state.Size)
+    {
+      int n = state.Size - state.Position;
+      if (api->ReceiveLength == 0)
+      {
+        bytes = ndiReceive(api, (n < NDI_RECEIVE_CHUNK ? n : NDI_RECEIVE_CHUNK), timeout);
+        if (bytes < 0)
+        {
+          return NDI_READ_ERROR;
+        }
+        else if (bytes == 0)
+        {
+          return NDI_TIMEOUT;
+        }
+      }
+      if (n > api->ReceiveLength)
+      {
+        n = api->ReceiveLength;
+      }
+      ndiStreamChunk(state, api->Receive + api->ReceiveStart, n);
+      api->ReceiveStart += n;
+      api->ReceiveLength -= n;
+    }
+
+    if (state.Stopped)
+    {
+      return NDI_STREAM_STOPPED;
+    }
+    if ((state.ReplyCRC[1] << 8 | state.ReplyCRC[0]) != state.CRC)
+    {
+      return NDI_BAD_CRC;
+    }
+
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiCommandStream(ndicapi* api, const ndiEncodedCommand* command, NDIStreamCallback callback, void* userdata)
+{
+  api->ErrorCode = 0;                 // clear error
+  api->Reply[0] = '\0';
+  api->ReplyNoCRC[0] = '\0';
+
+  // verify that the serial device was opened
+  if (api->Transport == NULL)
+  {
+    ndiSetError(api, NDI_OPEN_ERROR);
+    return NDI_OPEN_ERROR;
+  }
+
+  if (command->Length <= 0)
+  {
+    ndiSetError(api, NDI_COMMAND_TOO_LONG);
+    return NDI_COMMAND_TOO_LONG;
+  }
+
+  if (api->Streaming != NULL)
+  {
+    ndiSetError(api, NDI_STREAMING);
+    return NDI_STREAMING;
+  }
+
+  // the tracking thread waits for this one reply only, not for the
+  // callbacks of the commands that come before or after it
+  bool blockThread = api->IsThreadedMode && api->IsTracking;
+  if (blockThread)
+  {
+    ndiMutexLock(api->ThreadMutex);
+  }
+  int errorCode = ndiStreamReply(api, command, callback, userdata);
+  if (blockThread)
+  {
+    ndiMutexUnlock(api->ThreadMutex);
+  }
+
+  if (errorCode != 0)
+  {
+    ndiSetError(api, errorCode);
+  }
+  return errorCode;
+}
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Write a piece of a streamed reply to either a file or a buffer, and
+  // return nonzero to stop the transfer if it could not all be written
+  int ndiStreamWrite(FILE* file, ndiStreamBuffer* buffer, const char* data, int length)
+  {
+    if (file != NULL)
+    {
+      return (fwrite(data, 1, length, file) == (size_t)length ? 0 : 1);
+    }
+
+    if ((unsigned int)length > buffer->Size - buffer->Length)
+    {
+      return 1;
+    }
+    memcpy(buffer->Data + buffer->Length, data, length);
+    buffer->Length += length;
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiStreamToFile(const char* data, int length, unsigned int received, unsigned int total, void* userdata)
+{
+  return ndiStreamWrite((FILE*)userdata, NULL, data, length);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiStreamToBuffer(const char* data, int length, unsigned int received, unsigned int total, void* userdata)
+{
+  return ndiStreamWrite(NULL, (ndiStreamBuffer*)userdata, data, length);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiStartStreaming(ndicapi* api, const ndiEncodedCommand* command, const char* streamId)
+{
+  api->ErrorCode = 0;                 // clear error
+  api->Reply[0] = '\0';
+  api->ReplyNoCRC[0] = '\0';
+
+  // verify that the serial device was opened
+  if (api->Transport == NULL)
+  {
+    ndiSetError(api, NDI_OPEN_ERROR);
+    return NDI_OPEN_ERROR;
+  }
+
+  if (api->Streaming != NULL)
+  {
+    ndiSetError(api, NDI_STREAMING);
+    return NDI_STREAMING;
+  }
+
+  // the streamed command is quoted without its CRC and carriage return
+  int quotedLength = command->Length - (command->UseCRC ? 5 : 1);
+  if (quotedLength <= 0)
+  {
+    ndiSetError(api, NDI_COMMAND_TOO_LONG);
+    return NDI_COMMAND_TOO_LONG;
+  }
+
+  ndiStreaming* streaming = (ndiStreaming*)malloc(sizeof(ndiStreaming));
+  if (streaming == NULL)
+  {
+    ndiSetError(api, NDI_BAD_ALLOC);
+    return NDI_BAD_ALLOC;
+  }
+  streaming->Command = *command;
+  const ndiCommandInfo* commandInfo = ndiLookupCommand(command->Text, command->MnemonicLength, command->MnemonicHash);
+  streaming->IsBinary = (commandInfo != NULL && (commandInfo->Flags & NDI_COMMAND_BINARY) != 0);
+
+  ndiEncodeBegin(&streaming->Start, "STREAM", ' ');
+  ndiEncodeString(&streaming->Start, "--id=", 0);
+  ndiEncodeString(&streaming->Start, streamId, 0);
+  ndiEncodeString(&streaming->Start, " --cmd=\"", 0);
+  ndiEncodeString(&streaming->Start, command->Text, quotedLength);
+  ndiEncodeChar(&streaming->Start, '"');
+  ndiEncodeEnd(&streaming->Start);
+
+  ndiEncodeBegin(&streaming->Stop, "USTREAM", ' ');
+  ndiEncodeString(&streaming->Stop, "--id=", 0);
+  ndiEncodeString(&streaming->Stop, streamId, 0);
+  ndiEncodeEnd(&streaming->Stop);
+
+  if (streaming->Start.Length <= 0 || streaming->Stop.Length <= 0)
+  {
+    free(streaming);
+    ndiSetError(api, NDI_COMMAND_TOO_LONG);
+    return NDI_COMMAND_TOO_LONG;
+  }
+
+  bool blockThread = api->IsThreadedMode && api->IsTracking;
+  if (blockThread)
+  {
+    ndiMutexLock(api->ThreadMutex);
+  }
+
+  // pushed replies that arrive along with the OKAY stay in the receive
+  // buffer for the first read
+  int bytes;
+  int errorCode = ndiCommandExchange(api, streaming->Start.Text, streaming->Start.Length, false, bytes);
+  if (errorCode != 0)
+  {
+    ndiSetError(api, errorCode);
+  }
+  else
+  {
+    ndiCommandFinish(api, streaming->Start.Text, NULL, false, bytes);
+  }
+
+  if (api->ErrorCode == 0)
+  {
+    api->Streaming = streaming;
+    if (api->IsThreadedMode)
+    {
+      // the thread reads the stream from now on
+      strcpy(api->ThreadCommand, command->Text);
+      api->IsThreadedCommandBinary = streaming->IsBinary;
+    }
+  }
+  else
+  {
+    free(streaming);
+  }
+
+  if (blockThread)
+  {
+    ndiMutexUnlock(api->ThreadMutex);
+  }
+
+  return api->ErrorCode;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport char* ndiReadStreamedReply(ndicapi* api)
+{
+  api->ErrorCode = 0;                 // clear error
+  api->Reply[0] = '\0';
+  api->ReplyNoCRC[0] = '\0';
+
+  ndiStreaming* streaming = api->Streaming;
+  if (streaming == NULL || api->IsThreadedMode)
+  {
+    ndiSetError(api, NDI_STREAMING);
+    return api->ReplyNoCRC;
+  }
+
+  int bytes;
+  int errorCode = ndiCommandReceive(api, streaming->IsBinary, bytes);
+
+  if ((errorCode == NDI_WRITE_ERROR || errorCode == NDI_READ_ERROR) &&
+      api->IsReconnectMode && !api->IsReconnecting)
+  {
+    // the stream is started again along with the session
+    if (ndiReconnect(api, api->IsTracking, false))
+    {
+      errorCode = ndiCommandReceive(api, streaming->IsBinary, bytes);
+    }
+  }
+
+  if (errorCode != 0)
+  {
+    ndiSetError(api, errorCode);
+    return api->ReplyNoCRC;
+  }
+
+  const ndiCommandInfo* commandInfo = ndiLookupCommand(streaming->Command.Text, streaming->Command.MnemonicLength, streaming->Command.MnemonicHash);
+  return ndiCommandFinish(api, streaming->Command.Text, commandInfo, streaming->IsBinary, bytes);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiStopStreaming(ndicapi* api)
+{
+  api->ErrorCode = 0;                 // clear error
+  api->Reply[0] = '\0';
+  api->ReplyNoCRC[0] = '\0';
+
+  ndiStreaming* streaming = api->Streaming;
+  if (streaming == NULL)
+  {
+    return NDI_OKAY;
+  }
+
+  bool blockThread = api->IsThreadedMode && api->IsTracking;
+  if (blockThread)
+  {
+    ndiMutexLock(api->ThreadMutex);
+  }
+
+  // the replies that were pushed before the device saw USTREAM are read
+  // rather than flushed, so that the reply to USTREAM is not cut in two.
+  // Either kind of reply is framed correctly with the streamed command's
+  // framing, because an ASCII reply is never taken for a binary one.
+  int errorCode = ndiTransportWrite(api, streaming->Stop.Text, streaming->Stop.Length);
+  std::chrono::steady_clock::time_point deadline = ndiDeadline(ndiTransportTimeout(api));
+  int bytes = 0;
+  while (errorCode == 0)
+  {
+    errorCode = ndiCommandReceive(api, streaming->IsBinary, bytes);
+    if (errorCode == 0 && (strncmp(api->Reply, "OKAY", 4) == 0 || strncmp(api->Reply, "ERROR", 5) == 0))
+    {
+      api->Reply[bytes] = '\0';
+      break;
+    }
+    if (errorCode == 0 && ndiMillisecondsLeft(deadline) == 0)
+    {
+      errorCode = NDI_TIMEOUT;
+    }
+  }
+
+  if (errorCode != 0)
+  {
+    ndiSetError(api, errorCode);
+  }
+  else
+  {
+    ndiCommandFinish(api, streaming->Stop.Text, NULL, false, bytes);
+  }
+
+  // the stream is forgotten even if the device did not agree, and the next
+  // command flushes whatever it still sends
+  free(streaming);
+  api->Streaming = NULL;
+  if (api->IsThreadedMode)
+  {
+    // the thread waits for the application to send the next command
+    api->ThreadCommand[0] = '\0';
+  }
+
+  if (blockThread)
+  {
+    ndiMutexUnlock(api->ThreadMutex);
+  }
+
+  return api->ErrorCode;
+}
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Append one character, keeping the CRC and the mnemonic hash up to date.
+  // The last byte of Text is kept for the terminating null.
+  void ndiEncodePut(ndiEncodedCommand* command, char c)
+  {
+    if (command->Length < 0)
+    {
+      return;
+    }
+    if (command->Length >= NDI_ENCODED_COMMAND_SIZE - 1)
+    {
+      command->Length = -1;
+      command->Text[0] = '\0';
+      return;
+    }
+    CalcCRC16(c, &command->CRC);
+    command->Text[command->Length++] = c;
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiEncodeBegin(ndiEncodedCommand* command, const char* mnemonic, char separator)
+{
+  command->Length = 0;
+  command->MnemonicHash = 0;
+  command->CRC = 0;
+
+  for (; *mnemonic != '\0'; mnemonic++)
+  {
+    command->MnemonicHash = command->MnemonicHash * NDI_COMMAND_HASH_MULTIPLIER + (unsigned char)*mnemonic;
+    ndiEncodePut(command, *mnemonic);
+  }
+  command->MnemonicLength = command->Length;
+  command->UseCRC = (separator == ':');
+  if (separator != '\0')
+  {
+    ndiEncodePut(command, separator);
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiEncodeHex(ndiEncodedCommand* command, unsigned long value, int digits)
+{
+  static const char hexChars[] = "0123456789ABCDEF";
+
+  for (int i = digits - 1; i >= 0; i--)
+  {
+    ndiEncodePut(command, hexChars[(value >> (4 * i)) & 0x0f]);
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiEncodeDecimal(ndiEncodedCommand* command, unsigned long value, int digits)
+{
+  char text[24];
+  int n = 0;
+
+  do
+  {
+    text[n++] = (char)('0' + value % 10);
+    value /= 10;
+  }
+  while (value != 0 && n < (int)sizeof(text));
+
+  for (int i = n; i < digits; i++)
+  {
+    ndiEncodePut(command, '0');
+  }
+  while (n > 0)
+  {
+    ndiEncodePut(command, text[--n]);
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiEncodeChar(ndiEncodedCommand* command, char c)
+{
+  ndiEncodePut(command, c);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiEncodeString(ndiEncodedCommand* command, const char* text, int width)
+{
+  int i;
+
+  for (i = 0; text[i] != '\0' && (width <= 0 || i < width); i++)
+  {
+    ndiEncodePut(command, text[i]);
+  }
+  for (; i < width; i++)
+  {
+    ndiEncodePut(command, ' ');
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiEncodeEnd(ndiEncodedCommand* command)
+{
+  if (command->UseCRC)
+  {
+    // the CRC itself must not be added to the CRC
+    unsigned short CRC16 = command->CRC;
+    ndiEncodeHex(command, CRC16, 4);
+  }
+  ndiEncodePut(command, '\r');
+
+  if (command->Length >= 0)
+  {
+    command->Text[command->Length] = '\0';
+  }
+  return command->Length;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiEncodeGX(ndiEncodedCommand* command, int mode)
+{
+  ndiEncodeBegin(command, "GX", ':');
+  ndiEncodeHex(command, mode, 4);
+  return ndiEncodeEnd(command);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiEncodeTX(ndiEncodedCommand* command, int mode)
+{
+  ndiEncodeBegin(command, "TX", ':');
+  ndiEncodeHex(command, mode, 4);
+  return ndiEncodeEnd(command);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiEncodeBX(ndiEncodedCommand* command, int mode)
+{
+  ndiEncodeBegin(command, "BX", ':');
+  ndiEncodeHex(command, mode, 4);
+  return ndiEncodeEnd(command);
+}
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Append " --name=value" for a BX2 option, unless it is left at the
+  // device default.  'allowed' is a bit mask of the values that are valid.
+  bool ndiEncodeBX2Option(ndiEncodedCommand* command, const char* name, int value, int allowed)
+  {
+    static const char* valueNames[] = { "", "none", "tools", "strays", "all", "buttons" };
+
+    if (value == NDI_BX2_REPLY_DEFAULT)
+    {
+      return true;
+    }
+    if (value < 0 || value > NDI_BX2_REPLY_BUTTONS || (allowed & (1 << value)) == 0)
+    {
+      return false;
+    }
+    ndiEncodeString(command, " --", 0);
+    ndiEncodeString(command, name, 0);
+    ndiEncodeChar(command, '=');
+    ndiEncodeString(command, valueNames[value], 0);
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiEncodeBX2(ndiEncodedCommand* command, const ndiBX2Options* options)
+{
+  const int onOff = (1 << NDI_BX2_REPLY_NONE) | (1 << NDI_BX2_REPLY_TOOLS);
+  const int buttons = (1 << NDI_BX2_REPLY_NONE) | (1 << NDI_BX2_REPLY_BUTTONS);
+  const int markers = onOff | (1 << NDI_BX2_REPLY_STRAYS) | (1 << NDI_BX2_REPLY_ALL);
+
+  // each option brings its own leading space
+  ndiEncodeBegin(command, "BX2", '\0');
+
+  if (options != NULL &&
+      !(ndiEncodeBX2Option(command, "6d", options->Reply6D, onOff) &&
+        ndiEncodeBX2Option(command, "3d", options->Reply3D, markers) &&
+        ndiEncodeBX2Option(command, "2d", options->Reply2D, markers) &&
+        ndiEncodeBX2Option(command, "sensor", options->ReplySensor, markers) &&
+        ndiEncodeBX2Option(command, "1d", options->Reply1D, buttons)))
+  {
+    command->Length = -1;
+    command->Text[0] = '\0';
+    return -1;
+  }
+
+  return ndiEncodeEnd(command);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFPortStatus(ndicapi* pol)
+{
+  char* dp;
+
+  dp = &pol->PhinfBasic[31];
+
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFToolInfo(ndicapi* pol, char information[31])
+{
+  char* dp;
+  int i;
+
+  dp = pol->PhinfBasic;
+
+  for (i = 0; i < 31; i++)
+  {
+    information[i] = *dp++;
+  }
+
+  return pol->PhinfUnoccupied;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport unsigned long ndiGetPHINFCurrentTest(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->PhinfTesting;
+
+  return (int)ndiHexToUnsignedLong(dp, 8);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFPartNumber(ndicapi* pol, char part[20])
+{
+  char* dp;
+  int i;
+
+  dp = pol->PhinfPartNumber;
+
+  for (i = 0; i < 20; i++)
+  {
+    part[i] = *dp++;
+  }
+
+  return pol->PhinfUnoccupied;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFAccessories(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->PhinfAccessories;
+
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFMarkerType(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->PhinfMarkerType;
+
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFPortLocation(ndicapi* pol, char location[14])
+{
+  char* dp;
+  int i;
+
+  dp = pol->PhinfPortLocation;
+
+  for (i = 0; i < 14; i++)
+  {
+    location[i] = *dp++;
+  }
+
+  return pol->PhinfUnoccupied;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHINFGPIOStatus(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->PhinfGpioStatus;
+
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHRQHandle(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->PhrqReply;
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHSRNumberOfHandles(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->PhsrReply;
+
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHSRHandle(ndicapi* pol, int i)
+{
+  char* dp;
+  int n;
+
+  dp = pol->PhsrReply;
+  n = (int)ndiHexToUnsignedLong(dp, 2);
+  dp += 2;
+
+  if (i < 0 || i > n)
+  {
+    return 0;
+  }
+  dp += 5 * i;
+
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetPHSRInformation(ndicapi* pol, int i)
+{
+  char* dp;
+  int n;
+
+  dp = pol->PhsrReply;
+  n = (int)ndiHexToUnsignedLong(dp, 2);
+  dp += 2;
+
+  if (i < 0 || i > n)
+  {
+    return 0;
+  }
+  dp += 5 * i + 2;
+
+  return (int)ndiHexToUnsignedLong(dp, 3);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXTransformf(ndicapi* pol, int portHandle, float transform[8])
+{
+  char* readPointer;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == portHandle)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return NDI_DISABLED;
+  }
+
+  readPointer = pol->TxTransforms[i];
+  if (*readPointer == 'D' || *readPointer == '\0')
+  {
+    return NDI_DISABLED;
+  }
+  else if (*readPointer == 'M')
+  {
+    return NDI_MISSING;
+  }
+
+  transform[0] = ndiSignedToLong(&readPointer[0],  6) * 0.0001f;
+  transform[1] = ndiSignedToLong(&readPointer[6],  6) * 0.0001f;
+  transform[2] = ndiSignedToLong(&readPointer[12], 6) * 0.0001f;
+  transform[3] = ndiSignedToLong(&readPointer[18], 6) * 0.0001f;
+  transform[4] = ndiSignedToLong(&readPointer[24], 7) * 0.01f;
+  transform[5] = ndiSignedToLong(&readPointer[31], 7) * 0.01f;
+  transform[6] = ndiSignedToLong(&readPointer[38], 7) * 0.01f;
+  transform[7] = ndiSignedToLong(&readPointer[45], 6) * 0.0001f;
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXTransform(ndicapi* pol, int portHandle, double transform[8])
+{
+  char* readPointer;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == portHandle)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return NDI_DISABLED;
+  }
+
+  readPointer = pol->TxTransforms[i];
+  if (*readPointer == 'D' || *readPointer == '\0')
+  {
+    return NDI_DISABLED;
+  }
+  else if (*readPointer == 'M')
+  {
+    return NDI_MISSING;
+  }
+
+  transform[0] = ndiSignedToLong(&readPointer[0], 6) * 0.0001;
+  transform[1] = ndiSignedToLong(&readPointer[6], 6) * 0.0001;
+  transform[2] = ndiSignedToLong(&readPointer[12], 6) * 0.0001;
+  transform[3] = ndiSignedToLong(&readPointer[18], 6) * 0.0001;
+  transform[4] = ndiSignedToLong(&readPointer[24], 7) * 0.01;
+  transform[5] = ndiSignedToLong(&readPointer[31], 7) * 0.01;
+  transform[6] = ndiSignedToLong(&readPointer[38], 7) * 0.01;
+  transform[7] = ndiSignedToLong(&readPointer[45], 6) * 0.0001;
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXPortStatus(ndicapi* pol, int ph)
+{
+  char* dp;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == ph)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return 0;
+  }
+
+  dp = pol->TxStatus[i];
+
+  return (int)ndiHexToUnsignedLong(dp, 8);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport unsigned long ndiGetTXFrame(ndicapi* pol, int ph)
+{
+  char* dp;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == ph)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return 0;
+  }
+
+  dp = pol->TxFrame[i];
+
+  return (unsigned long)ndiHexToUnsignedLong(dp, 8);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXToolInfo(ndicapi* pol, int ph)
+{
+  char* dp;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == ph)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return 0;
+  }
+
+  dp = pol->TxInformation[i];
+  return (int)ndiHexToUnsignedLong(dp, 2);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXMarkerInfo(ndicapi* pol, int ph, int marker)
+{
+  char* dp;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == ph)
+    {
+      break;
+    }
+  }
+  if (i == n || marker < 0 || marker >= 20)
+  {
+    return NDI_DISABLED;
+  }
+
+  dp = pol->TxInformation[2 + marker];
+  return (int)ndiHexToUnsignedLong(dp, 1);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXSingleStray(ndicapi* pol, int ph, double coord[3])
+{
+  char* dp;
+  int i, n;
+
+  n = pol->TxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->TxHandles[i] == ph)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return NDI_DISABLED;
+  }
+
+  dp = pol->TxSingleStray[i];
+  if (*dp == 'D' || *dp == '\0')
+  {
+    return NDI_DISABLED;
+  }
+  else if (*dp == 'M')
+  {
+    return NDI_MISSING;
+  }
+
+  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
+  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
+  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXNumberOfPassiveStrays(ndicapi* pol)
+{
+  return pol->TxPassiveStrayCount;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXPassiveStray(ndicapi* pol, int i, double coord[3])
+{
+  const char* dp;
+  int n;
+
+  dp = pol->TxPassiveStray;
+
+  if (*dp == '\0')
+  {
+    return NDI_DISABLED;
+  }
+
+  n = pol->TxPassiveStrayCount;
+  if (n < 0)
+  {
+    return NDI_MISSING;
+  }
+  if (n > 50)
+  {
+    n = 50;
+  }
+
+  if (i < 0 || i >= n)
+  {
+    return NDI_MISSING;
+  }
+
+  dp += 7 * 3 * i;
+  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
+  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
+  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetTXSystemStatus(ndicapi* pol)
+{
+  char* dp;
+
+  dp = pol->TxSystemStatus;
+
+  return (int)ndiHexToUnsignedLong(dp, 4);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetGXTransform(ndicapi* pol, int port, double transform[8])
+{
+  char* dp;
+
+  if (port >= '1' && port <= '3')
+  {
+    dp = pol->GxTransforms[port - '1'];
+  }
+  else if (port >= 'A' && port <= 'I')
+  {
+    dp = pol->GxPassiveTransforms[port - 'A'];
+  }
+  else
   {
-    ndiCOMMHelper(api, command, commandReply);
+    return NDI_DISABLED;
   }
-  else if (command[0] == 'I' && commandLength == 4 && strncmp(command, "INIT", commandLength) == 0)
+
+  if (*dp == 'D' || *dp == '\0')
   {
-    ndiINITHelper(api, command, commandReply);
+    return NDI_DISABLED;
   }
-  else if (command[0] == 'I' && commandLength == 5 && strncmp(command, "IRCHK", commandLength) == 0)
+  else if (*dp == 'M')
   {
-    ndiIRCHKHelper(api, command, commandReply);
+    return NDI_MISSING;
   }
-  else if (command[0] == 'P' && commandLength == 5 && strncmp(command, "PHINF", commandLength) == 0)
+
+  transform[0] = ndiSignedToLong(&dp[0],  6) * 0.0001;
+  transform[1] = ndiSignedToLong(&dp[6],  6) * 0.0001;
+  transform[2] = ndiSignedToLong(&dp[12], 6) * 0.0001;
+  transform[3] = ndiSignedToLong(&dp[18], 6) * 0.0001;
+  transform[4] = ndiSignedToLong(&dp[24], 7) * 0.01;
+  transform[5] = ndiSignedToLong(&dp[31], 7) * 0.01;
+  transform[6] = ndiSignedToLong(&dp[38], 7) * 0.01;
+  transform[7] = ndiSignedToLong(&dp[45], 6) * 0.0001;
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetGXPortStatus(ndicapi* pol, int port)
+{
+  char* dp;
+
+  if (port >= '1' && port <= '3')
   {
-    ndiPHINFHelper(api, command, commandReply);
+    dp = &pol->GxStatus[6 - 2 * (port - '1')];
   }
-  else if (command[0] == 'P' && commandLength == 4 && strncmp(command, "PHRQ", commandLength) == 0)
+  else if (port >= 'A' && port <= 'C')
   {
-    ndiPHRQHelper(api, command, commandReply);
+    dp = &pol->GxPassiveStatus[6 - 2 * (port - 'A')];
   }
-  else if (command[0] == 'P' && commandLength == 4 && strncmp(command, "PHSR", commandLength) == 0)
+  else if (port >= 'D' && port <= 'F')
   {
-    ndiPHSRHelper(api, command, commandReply);
+    dp = &pol->GxPassiveStatus[14 - 2 * (port - 'D')];
   }
-  else if (command[0] == 'P' && commandLength == 5 && strncmp(command, "PSTAT", commandLength) == 0)
+  else if (port >= 'G' && port <= 'I')
   {
-    ndiPSTATHelper(api, command, commandReply);
+    dp = &pol->GxPassiveStatus[22 - 2 * (port - 'G')];
   }
-  else if (command[0] == 'S' && commandLength == 5 && strncmp(command, "SSTAT", commandLength) == 0)
+  else
   {
-    ndiSSTATHelper(api, command, commandReply);
+    return 0;
   }
 
-  // return the Measurement System reply, but with the CRC hacked off
-  return commandReply;
+  return (int)ndiHexToUnsignedLong(dp, 2);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFPortStatus(ndicapi* pol)
+ndicapiExport int ndiGetGXSystemStatus(ndicapi* pol)
 {
   char* dp;
 
-  dp = &pol->PhinfBasic[31];
+  dp = pol->GxStatus;
+
+  if (*dp == '\0')
+  {
+    dp = pol->GxPassiveStatus;
+  }
 
   return (int)ndiHexToUnsignedLong(dp, 2);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFToolInfo(ndicapi* pol, char information[31])
+ndicapiExport int ndiGetGXToolInfo(ndicapi* pol, int port)
 {
   char* dp;
-  int i;
-
-  dp = pol->PhinfBasic;
 
-  for (i = 0; i < 31; i++)
+  if (port >= '1' && port <= '3')
   {
-    information[i] = *dp++;
+    dp = pol->GxInformation[port - '1'];
+  }
+  else if (port >= 'A' && port <= 'I')
+  {
+    dp = pol->GxPassiveInformation[port - 'A'];
+  }
+  else
+  {
+    return 0;
   }
 
-  return pol->PhinfUnoccupied;
+  return (int)ndiHexToUnsignedLong(dp, 2);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned long ndiGetPHINFCurrentTest(ndicapi* pol)
+ndicapiExport int ndiGetGXMarkerInfo(ndicapi* pol, int port, int marker)
 {
   char* dp;
 
-  dp = pol->PhinfTesting;
+  if (marker < 'A' || marker > 'T')
+  {
+    return 0;
+  }
 
-  return (int)ndiHexToUnsignedLong(dp, 8);
+  if (port >= '1' && port <= '3')
+  {
+    dp = pol->GxInformation[port - '1'];
+  }
+  else if (port >= 'A' && port <= 'I')
+  {
+    dp = pol->GxPassiveInformation[port - 'A'];
+  }
+  else
+  {
+    return 0;
+  }
+  dp += 11 - (marker - 'A');
+
+  return (int)ndiHexToUnsignedLong(dp, 1);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFPartNumber(ndicapi* pol, char part[20])
+ndicapiExport int ndiGetGXSingleStray(ndicapi* pol, int port, double coord[3])
 {
   char* dp;
-  int i;
 
-  dp = pol->PhinfPartNumber;
+  if (port >= '1' && port <= '3')
+  {
+    dp = pol->GxSingleStray[port - '1'];
+  }
+  else
+  {
+    return NDI_DISABLED;
+  }
 
-  for (i = 0; i < 20; i++)
+  if (*dp == 'D' || *dp == '\0')
   {
-    part[i] = *dp++;
+    return NDI_DISABLED;
+  }
+  else if (*dp == 'M')
+  {
+    return NDI_MISSING;
   }
 
-  return pol->PhinfUnoccupied;
+  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
+  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
+  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
+
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFAccessories(ndicapi* pol)
+ndicapiExport unsigned long ndiGetGXFrame(ndicapi* pol, int port)
 {
   char* dp;
 
-  dp = pol->PhinfAccessories;
+  if (port >= '1' && port <= '3')
+  {
+    dp = pol->GxFrame[port - '1'];
+  }
+  else if (port >= 'A' && port <= 'I')
+  {
+    dp = pol->GxPassiveFrame[port - 'A'];
+  }
+  else
+  {
+    return 0;
+  }
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  return (unsigned long)ndiHexToUnsignedLong(dp, 8);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFMarkerType(ndicapi* pol)
+ndicapiExport int ndiGetGXNumberOfPassiveStrays(ndicapi* pol)
 {
-  char* dp;
+  const char* dp;
+  int n;
 
-  dp = pol->PhinfMarkerType;
+  dp = pol->GxPassiveStray;
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  if (*dp == '\0')
+  {
+    return 0;
+  }
+
+  n = (int)ndiSignedToLong(dp, 3);
+  if (n < 0)
+  {
+    return 0;
+  }
+  if (n > 20)
+  {
+    return 20;
+  }
+
+  return n;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFPortLocation(ndicapi* pol, char location[14])
+ndicapiExport int ndiGetGXPassiveStray(ndicapi* pol, int i, double coord[3])
 {
-  char* dp;
-  int i;
+  const char* dp;
+  int n;
 
-  dp = pol->PhinfPortLocation;
+  dp = pol->GxPassiveStray;
 
-  for (i = 0; i < 14; i++)
+  if (*dp == '\0')
   {
-    location[i] = *dp++;
+    return NDI_DISABLED;
   }
 
-  return pol->PhinfUnoccupied;
+  n = (int)ndiSignedToLong(dp, 3);
+  dp += 3;
+  if (n < 0)
+  {
+    return NDI_MISSING;
+  }
+  if (n > 20)
+  {
+    n = 20;
+  }
+
+  if (i < 0 || i >= n)
+  {
+    return NDI_MISSING;
+  }
+
+  dp += 7 * 3 * i;
+  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
+  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
+  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
+
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHINFGPIOStatus(ndicapi* pol)
+ndicapiExport unsigned short ndiGetBXReplyLength(ndicapi* pol)
 {
-  char* dp;
-
-  dp = pol->PhinfGpioStatus;
-
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  return pol->BxReplyLength;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHRQHandle(ndicapi* pol)
+ndicapiExport int ndiGetBXTransform(ndicapi* pol, int portHandle, float transform[8])
 {
-  char* dp;
+  int i, n;
 
-  dp = pol->PhrqReply;
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  n = pol->BxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->BxHandles[i] == portHandle)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return NDI_DISABLED;
+  }
+
+  memcpy(&transform[0], &pol->BxTransforms[i][0], sizeof(float) * 8);
+  if (pol->BxHandlesStatus[i] & NDI_HANDLE_DISABLED)
+  {
+    return NDI_DISABLED;
+  }
+  else if (pol->BxHandlesStatus[i] & NDI_HANDLE_MISSING)
+  {
+    return NDI_MISSING;
+  }
+
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHSRNumberOfHandles(ndicapi* pol)
+ndicapiExport int ndiGetBXPortStatus(ndicapi* pol, int portHandle)
 {
-  char* dp;
+  int i, n;
 
-  dp = pol->PhsrReply;
+  n = pol->BxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->BxHandles[i] == portHandle)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return 0;
+  }
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  return pol->BxPortStatus[i];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHSRHandle(ndicapi* pol, int i)
+ndicapiExport unsigned long ndiGetBXFrame(ndicapi* pol, int portHandle)
 {
-  char* dp;
-  int n;
-
-  dp = pol->PhsrReply;
-  n = (int)ndiHexToUnsignedLong(dp, 2);
-  dp += 2;
+  int i, n;
 
-  if (i < 0 || i > n)
+  n = pol->BxHandleCount;
+  for (i = 0; i < n; i++)
+  {
+    if (pol->BxHandles[i] == portHandle)
+    {
+      break;
+    }
+  }
+  if (i == n)
   {
     return 0;
   }
-  dp += 5 * i;
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  return pol->BxFrameNumber[i];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetPHSRInformation(ndicapi* pol, int i)
+ndicapiExport int ndiGetBXToolInfo(ndicapi* pol, int portHandle, char& outToolInfo)
 {
-  char* dp;
-  int n;
-
-  dp = pol->PhsrReply;
-  n = (int)ndiHexToUnsignedLong(dp, 2);
-  dp += 2;
+  int i, n;
 
-  if (i < 0 || i > n)
+  n = pol->BxHandleCount;
+  for (i = 0; i < n; i++)
   {
-    return 0;
+    if (pol->BxHandles[i] == portHandle)
+    {
+      break;
+    }
+  }
+  if (i == n)
+  {
+    return NDI_DISABLED;
   }
-  dp += 5 * i + 2;
 
-  return (int)ndiHexToUnsignedLong(dp, 3);
+  outToolInfo = pol->BxToolMarkerInformation[i][0];
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXTransformf(ndicapi* pol, int portHandle, float transform[8])
+ndicapiExport int ndiGetBXMarkerInfo(ndicapi* pol, int portHandle, int marker, char& outMarkerInfo)
 {
-  char* readPointer;
   int i, n;
 
-  n = pol->TxHandleCount;
+  if (marker >= 20)
+  {
+    return false;
+  }
+
+  n = pol->BxHandleCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == portHandle)
+    if (pol->BxHandles[i] == portHandle)
     {
       break;
     }
@@ -3219,38 +6556,29 @@ ndicapiExport int ndiGetTXTransformf(ndicapi* pol, int portHandle, float transfo
     return NDI_DISABLED;
   }
 
-  readPointer = pol->TxTransforms[i];
-  if (*readPointer == 'D' || *readPointer == '\0')
+  int byteIndex = marker / 2;
+  if (marker % 2 == 0)
   {
-    return NDI_DISABLED;
+    // low 4 bits, little endian format, so index backwards from the rear
+    outMarkerInfo = pol->BxToolMarkerInformation[i][1 + (10 - byteIndex)] & 0x00FF;
   }
-  else if (*readPointer == 'M')
+  else
   {
-    return NDI_MISSING;
+    // high 4 bits, little endian format, so index backwards from the rear
+    outMarkerInfo = pol->BxToolMarkerInformation[i][1 + (10 - byteIndex)] & 0xFF00 >> 4;
   }
-
-  transform[0] = ndiSignedToLong(&readPointer[0],  6) * 0.0001f;
-  transform[1] = ndiSignedToLong(&readPointer[6],  6) * 0.0001f;
-  transform[2] = ndiSignedToLong(&readPointer[12], 6) * 0.0001f;
-  transform[3] = ndiSignedToLong(&readPointer[18], 6) * 0.0001f;
-  transform[4] = ndiSignedToLong(&readPointer[24], 7) * 0.01f;
-  transform[5] = ndiSignedToLong(&readPointer[31], 7) * 0.01f;
-  transform[6] = ndiSignedToLong(&readPointer[38], 7) * 0.01f;
-  transform[7] = ndiSignedToLong(&readPointer[45], 6) * 0.0001f;
-
   return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXTransform(ndicapi* pol, int portHandle, double transform[8])
+ndicapiExport int ndiGetBXSingleStray(ndicapi* pol, int portHandle, float outCoord[3])
 {
-  char* readPointer;
   int i, n;
 
-  n = pol->TxHandleCount;
+  n = pol->BxHandleCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == portHandle)
+    if (pol->BxHandles[i] == portHandle)
     {
       break;
     }
@@ -3260,62 +6588,73 @@ ndicapiExport int ndiGetTXTransform(ndicapi* pol, int portHandle, double transfo
     return NDI_DISABLED;
   }
 
-  readPointer = pol->TxTransforms[i];
-  if (*readPointer == 'D' || *readPointer == '\0')
+  memcpy(outCoord, pol->BxActiveSingleStrayMarkerPosition[i], sizeof(float) * 3);
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBXNumberOfPassiveStrays(ndicapi* pol)
+{
+  return pol->BxPassiveStrayCount;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBXPassiveStray(ndicapi* pol, int i, float outCoord[3])
+{
+  if (i < 0 || i >= pol->BxPassiveStrayCount)
   {
     return NDI_DISABLED;
   }
-  else if (*readPointer == 'M')
-  {
-    return NDI_MISSING;
-  }
-
-  transform[0] = ndiSignedToLong(&readPointer[0], 6) * 0.0001;
-  transform[1] = ndiSignedToLong(&readPointer[6], 6) * 0.0001;
-  transform[2] = ndiSignedToLong(&readPointer[12], 6) * 0.0001;
-  transform[3] = ndiSignedToLong(&readPointer[18], 6) * 0.0001;
-  transform[4] = ndiSignedToLong(&readPointer[24], 7) * 0.01;
-  transform[5] = ndiSignedToLong(&readPointer[31], 7) * 0.01;
-  transform[6] = ndiSignedToLong(&readPointer[38], 7) * 0.01;
-  transform[7] = ndiSignedToLong(&readPointer[45], 6) * 0.0001;
-
+  memcpy(outCoord, pol->BxPassiveStrayPosition[i], sizeof(float) * 3);
   return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXPortStatus(ndicapi* pol, int ph)
+ndicapiExport int ndiGetBXSystemStatus(ndicapi* pol)
+{
+  return pol->BxSystemStatus;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBX2Transform(ndicapi* pol, int portHandle, float transform[8])
 {
-  char* dp;
   int i, n;
 
-  n = pol->TxHandleCount;
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_6D);
+  n = pol->Bx2HandleCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == ph)
+    if (pol->Bx2Handles[i] == portHandle)
     {
       break;
     }
   }
   if (i == n)
   {
-    return 0;
+    return NDI_DISABLED;
   }
 
-  dp = pol->TxStatus[i];
+  memcpy(&transform[0], &pol->Bx2Transforms[i][0], sizeof(float) * 8);
 
-  return (int)ndiHexToUnsignedLong(dp, 8);
+  return ndiBX2HandleState(pol->Bx2HandlesStatus[i]);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned long ndiGetTXFrame(ndicapi* pol, int ph)
+ndicapiExport unsigned int ndiGetBX2ReplyLength(ndicapi* pol)
+{
+  return pol->Bx2ReplyLength;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport unsigned short ndiGetBX2PortStatus(ndicapi* pol, int portHandle)
 {
-  char* dp;
   int i, n;
 
-  n = pol->TxHandleCount;
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_6D);
+  n = pol->Bx2HandleCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == ph)
+    if (pol->Bx2Handles[i] == portHandle)
     {
       break;
     }
@@ -3325,21 +6664,101 @@ ndicapiExport unsigned long ndiGetTXFrame(ndicapi* pol, int ph)
     return 0;
   }
 
-  dp = pol->TxFrame[i];
+  return pol->Bx2HandlesStatus[i];
+}
 
-  return (unsigned long)ndiHexToUnsignedLong(dp, 8);
+//----------------------------------------------------------------------------
+ndicapiExport unsigned short* ndiGetBX2SystemAlert(ndicapi* pol, int index)
+{
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_SYS_ALERT);
+  if (index >= 0 && (unsigned int)index < pol->Bx2SystemAlertsCount)
+  {
+    return pol->Bx2SystemAlerts[index];
+  }
+
+  return nullptr;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXToolInfo(ndicapi* pol, int ph)
+ndicapiExport int ndiGetBX2SystemAlertsCount(ndicapi* pol)
+{
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_SYS_ALERT);
+  return pol->Bx2SystemAlertsCount;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport unsigned int ndiGetBX2Frame(ndicapi* pol)
+{
+  return pol->Bx2FrameNumber;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBX2FrameCount(ndicapi* pol)
+{
+  return pol->Bx2FrameCount;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSelectBX2Frame(ndicapi* pol, int index)
+{
+  ndiBX2Frame* frame;
+  int i;
+
+  if (index < 0 || (unsigned int)index >= pol->Bx2FrameCount)
+  {
+    return NDI_DISABLED;
+  }
+
+  frame = pol->Bx2Frames;
+  for (i = 0; i < index; i++)
+  {
+    frame = frame->Next;
+  }
+
+  if (frame != pol->Bx2SelectedFrame)
+  {
+    // keep anything that was decoded lazily for the previous frame
+    ndiBX2SaveFrame(pol, pol->Bx2SelectedFrame);
+    ndiBX2LoadFrame(pol, frame);
+    pol->Bx2SelectedFrame = frame;
+    pol->FrameIsBuilt = false;
+  }
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBX2FrameType(ndicapi* pol)
+{
+  return pol->Bx2FrameType;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBX2FrameSequenceIndex(ndicapi* pol)
+{
+  return pol->Bx2FrameSequenceIndex;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiGetBX2Timestamp(ndicapi* pol, unsigned int* seconds, unsigned int* nanoseconds)
+{
+  // the timestamp is stored with its bytes reversed
+  const unsigned char* timestamp = pol->Bx2Timestamp;
+
+  *seconds = timestamp[4] << 24 | timestamp[5] << 16 | timestamp[6] << 8 | timestamp[7];
+  *nanoseconds = timestamp[0] << 24 | timestamp[1] << 16 | timestamp[2] << 8 | timestamp[3];
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport bool ndiGetBX2HandleAveragingEnabled(ndicapi* pol, int portHandle)
 {
-  char* dp;
   int i, n;
 
-  n = pol->TxHandleCount;
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_6D);
+  n = pol->Bx2HandleCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == ph)
+    if (pol->Bx2Handles[i] == portHandle)
     {
       break;
     }
@@ -3349,649 +6768,1267 @@ ndicapiExport int ndiGetTXToolInfo(ndicapi* pol, int ph)
     return 0;
   }
 
-  dp = pol->TxInformation[i];
-  return (int)ndiHexToUnsignedLong(dp, 2);
+  return pol->Bx2HandleAveragingEnabled[i];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXMarkerInfo(ndicapi* pol, int ph, int marker)
+ndicapiExport int ndiGetBX2NumberOf3Ds(ndicapi* pol, int portHandle)
 {
-  char* dp;
-  int i, n;
+  unsigned int i, n;
 
-  n = pol->TxHandleCount;
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_3D);
+  n = pol->Bx2_3DCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == ph)
+    if (pol->Bx2_3DHandles[i] == portHandle)
     {
-      break;
+      return pol->Bx2_3DMarkerCount[i];
     }
   }
-  if (i == n || marker < 0 || marker >= 20)
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBX2NumberOfButtons(ndicapi* pol, int portHandle)
+{
+  unsigned int i, n;
+
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_1D);
+  n = pol->Bx2_1DCount;
+  for (i = 0; i < n; i++)
   {
-    return NDI_DISABLED;
+    if (pol->Bx2_1DHandles[i] == portHandle)
+    {
+      return pol->Bx2_1DButtonCount[i];
+    }
   }
 
-  dp = pol->TxInformation[2 + marker];
-  return (int)ndiHexToUnsignedLong(dp, 1);
+  return 0;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXSingleStray(ndicapi* pol, int ph, double coord[3])
+ndicapiExport int ndiGetBX2Button(ndicapi* pol, int portHandle, int button)
 {
-  char* dp;
-  int i, n;
+  unsigned int i, n;
 
-  n = pol->TxHandleCount;
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_1D);
+  n = pol->Bx2_1DCount;
   for (i = 0; i < n; i++)
   {
-    if (pol->TxHandles[i] == ph)
+    if (pol->Bx2_1DHandles[i] == portHandle)
     {
       break;
     }
   }
-  if (i == n)
+  if (i == n || button < 0 || button >= pol->Bx2_1DButtonCount[i])
   {
-    return NDI_DISABLED;
+    return 0;
   }
 
-  dp = pol->TxSingleStray[i];
-  if (*dp == 'D' || *dp == '\0')
-  {
-    return NDI_DISABLED;
-  }
-  else if (*dp == 'M')
+  return (pol->Bx2_1DButtons[i][button] != 0);
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetBX2NumberOfImages(ndicapi* pol)
+{
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_IMAGE);
+  return pol->Bx2ImageCount;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport const ndiBX2Image* ndiGetBX2Image(ndicapi* pol, int i)
+{
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_IMAGE);
+  if (i < 0 || (unsigned int)i >= pol->Bx2ImageCount)
   {
-    return NDI_MISSING;
+    return NULL;
   }
 
-  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
-  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
-  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
-
-  return NDI_OKAY;
+  return &pol->Bx2Images[i];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXNumberOfPassiveStrays(ndicapi* pol)
+ndicapiExport int ndiGetBX2NumberOfUVs(ndicapi* pol)
 {
-  return pol->TxPassiveStrayCount;
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_UV);
+  return pol->Bx2UVCount;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXPassiveStray(ndicapi* pol, int i, double coord[3])
+ndicapiExport const ndiBX2UV* ndiGetBX2UV(ndicapi* pol, int i)
 {
-  const char* dp;
-  int n;
-
-  dp = pol->TxPassiveStray;
-
-  if (*dp == '\0')
-  {
-    return NDI_DISABLED;
-  }
-
-  n = pol->TxPassiveStrayCount;
-  if (n < 0)
-  {
-    return NDI_MISSING;
-  }
-  if (n > 50)
-  {
-    n = 50;
-  }
-
-  if (i < 0 || i >= n)
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_UV);
+  if (i < 0 || (unsigned int)i >= pol->Bx2UVCount)
   {
-    return NDI_MISSING;
+    return NULL;
   }
 
-  dp += 7 * 3 * i;
-  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
-  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
-  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
-
-  return NDI_OKAY;
+  return &pol->Bx2UVs[i];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetTXSystemStatus(ndicapi* pol)
+ndicapiExport int ndiGetBX2UVSpot(const ndiBX2UV* uv, int spot, float values[3])
 {
-  char* dp;
-
-  dp = pol->TxSystemStatus;
+  if (uv == NULL || spot < 0 || spot >= uv->SpotCount)
+  {
+    return NDI_DISABLED;
+  }
 
-  return (int)ndiHexToUnsignedLong(dp, 4);
+  // the spots are not aligned within the reply
+  memcpy(values, uv->Spots + spot * 12, 12);
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXTransform(ndicapi* pol, int port, double transform[8])
+ndicapiExport int ndiGetBX23D(ndicapi* pol, int portHandle, int marker, float outCoord[3])
 {
-  char* dp;
+  unsigned int i, n;
 
-  if (port >= '1' && port <= '3')
-  {
-    dp = pol->GxTransforms[port - '1'];
-  }
-  else if (port >= 'A' && port <= 'I')
+  ndiBX2DecodePending(pol, NDI_BX2_SLOT_3D);
+  n = pol->Bx2_3DCount;
+  for (i = 0; i < n; i++)
   {
-    dp = pol->GxPassiveTransforms[port - 'A'];
+    if (pol->Bx2_3DHandles[i] == portHandle)
+    {
+      break;
+    }
   }
-  else
+  if (i == n || marker < 0 || marker >= pol->Bx2_3DMarkerCount[i])
   {
     return NDI_DISABLED;
   }
 
-  if (*dp == 'D' || *dp == '\0')
-  {
-    return NDI_DISABLED;
-  }
-  else if (*dp == 'M')
+  memcpy(outCoord, pol->Bx2_3DMarkerPosition[i][marker], sizeof(float) * 3);
+  if (pol->Bx2_3DMarkerStatus[i][marker] == NDI_BX2_3D_MISSING)
   {
     return NDI_MISSING;
   }
 
-  transform[0] = ndiSignedToLong(&dp[0],  6) * 0.0001;
-  transform[1] = ndiSignedToLong(&dp[6],  6) * 0.0001;
-  transform[2] = ndiSignedToLong(&dp[12], 6) * 0.0001;
-  transform[3] = ndiSignedToLong(&dp[18], 6) * 0.0001;
-  transform[4] = ndiSignedToLong(&dp[24], 7) * 0.01;
-  transform[5] = ndiSignedToLong(&dp[31], 7) * 0.01;
-  transform[6] = ndiSignedToLong(&dp[38], 7) * 0.01;
-  transform[7] = ndiSignedToLong(&dp[45], 6) * 0.0001;
-
   return NDI_OKAY;
 }
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXPortStatus(ndicapi* pol, int port)
+namespace
 {
-  char* dp;
-
-  if (port >= '1' && port <= '3')
+  //----------------------------------------------------------------------------
+  // Convert a GX or TX transform from text, with the same scaling as
+  // ndiGetTXTransformf()
+  int ndiFrameTransformFromText(const char* dp, float transform[8])
   {
-    dp = &pol->GxStatus[6 - 2 * (port - '1')];
+    if (*dp == 'D' || *dp == '\0')
+    {
+      return NDI_DISABLED;
+    }
+    else if (*dp == 'M')
+    {
+      return NDI_MISSING;
+    }
+
+    transform[0] = ndiSignedToLong(&dp[0],  6) * 0.0001f;
+    transform[1] = ndiSignedToLong(&dp[6],  6) * 0.0001f;
+    transform[2] = ndiSignedToLong(&dp[12], 6) * 0.0001f;
+    transform[3] = ndiSignedToLong(&dp[18], 6) * 0.0001f;
+    transform[4] = ndiSignedToLong(&dp[24], 7) * 0.01f;
+    transform[5] = ndiSignedToLong(&dp[31], 7) * 0.01f;
+    transform[6] = ndiSignedToLong(&dp[38], 7) * 0.01f;
+    transform[7] = ndiSignedToLong(&dp[45], 6) * 0.0001f;
+
+    return NDI_OKAY;
   }
-  else if (port >= 'A' && port <= 'C')
+
+  //----------------------------------------------------------------------------
+  // Every ndiFrame array starts on and fills whole NDI_FRAME_ALIGNMENT units
+  void* ndiFrameAllocArray(ndiArena* arena, size_t bytes)
   {
-    dp = &pol->GxPassiveStatus[6 - 2 * (port - 'A')];
+    return ndiArenaAllocAligned(arena, bytes, NDI_FRAME_ALIGNMENT);
   }
-  else if (port >= 'D' && port <= 'F')
+
+  //----------------------------------------------------------------------------
+  // Allocate one array per element
+  bool ndiFrameAllocElements(ndiArena* arena, float** elements, int elementCount, int count)
   {
-    dp = &pol->GxPassiveStatus[14 - 2 * (port - 'D')];
+    for (int k = 0; k < elementCount; k++)
+    {
+      elements[k] = (float*)ndiFrameAllocArray(arena, count * sizeof(float));
+      if (elements[k] == NULL)
+      {
+        return false;
+      }
+    }
+    return true;
   }
-  else if (port >= 'G' && port <= 'I')
+
+  //----------------------------------------------------------------------------
+  // The counts are only set once all of the arrays have been allocated, so
+  // they stay at zero if the arena runs out of memory
+  bool ndiFrameAllocTools(ndiArena* arena, ndiFrame& frame, int toolCount)
   {
-    dp = &pol->GxPassiveStatus[22 - 2 * (port - 'G')];
+    frame.Handles = (int*)ndiFrameAllocArray(arena, toolCount * sizeof(int));
+    frame.ToolStatus = (int*)ndiFrameAllocArray(arena, toolCount * sizeof(int));
+    frame.PortStatus = (unsigned int*)ndiFrameAllocArray(arena, toolCount * sizeof(unsigned int));
+    frame.ToolFrameNumbers = (unsigned int*)ndiFrameAllocArray(arena, toolCount * sizeof(unsigned int));
+    if (frame.Handles == NULL || frame.ToolStatus == NULL || frame.PortStatus == NULL || frame.ToolFrameNumbers == NULL ||
+        !ndiFrameAllocElements(arena, frame.Transforms, 8, toolCount))
+    {
+      return false;
+    }
+
+    frame.ToolCount = toolCount;
+    return true;
   }
-  else
+
+  //----------------------------------------------------------------------------
+  bool ndiFrameAllocMarkers(ndiArena* arena, ndiFrame& frame, int markerCount)
   {
-    return 0;
-  }
+    frame.MarkerHandles = (int*)ndiFrameAllocArray(arena, markerCount * sizeof(int));
+    frame.MarkerStatus = (int*)ndiFrameAllocArray(arena, markerCount * sizeof(int));
+    if (frame.MarkerHandles == NULL || frame.MarkerStatus == NULL ||
+        !ndiFrameAllocElements(arena, frame.Markers, 3, markerCount))
+    {
+      return false;
+    }
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
-}
+    frame.MarkerCount = markerCount;
+    return true;
+  }
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXSystemStatus(ndicapi* pol)
-{
-  char* dp;
+  //----------------------------------------------------------------------------
+  bool ndiFrameAllocStrays(ndiArena* arena, ndiFrame& frame, int strayCount)
+  {
+    if (!ndiFrameAllocElements(arena, frame.Strays, 3, strayCount))
+    {
+      return false;
+    }
 
-  dp = pol->GxStatus;
+    frame.StrayCount = strayCount;
+    return true;
+  }
 
-  if (*dp == '\0')
+  //----------------------------------------------------------------------------
+  // Scatter one tool transform or one point into the per-element arrays
+  void ndiFrameSetElements(float** elements, int elementCount, int i, const float* values)
   {
-    dp = pol->GxPassiveStatus;
+    for (int k = 0; k < elementCount; k++)
+    {
+      elements[k][i] = values[k];
+    }
   }
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
-}
-
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXToolInfo(ndicapi* pol, int port)
-{
-  char* dp;
-
-  if (port >= '1' && port <= '3')
+  //----------------------------------------------------------------------------
+  // Passive strays from GX or TX, three 7-character coordinates per stray
+  void ndiFrameStraysFromText(ndiArena* arena, ndiFrame& frame, const char* dp, int strayCount)
   {
-    dp = pol->GxInformation[port - '1'];
+    if (!ndiFrameAllocStrays(arena, frame, strayCount))
+    {
+      return;
+    }
+
+    for (int i = 0; i < strayCount; i++)
+    {
+      frame.Strays[0][i] = ndiSignedToLong(&dp[0],  7) * 0.01f;
+      frame.Strays[1][i] = ndiSignedToLong(&dp[7],  7) * 0.01f;
+      frame.Strays[2][i] = ndiSignedToLong(&dp[14], 7) * 0.01f;
+      dp += 7 * 3;
+    }
   }
-  else if (port >= 'A' && port <= 'I')
+
+  //----------------------------------------------------------------------------
+  const char* ndiFrameGXTransformText(ndicapi* pol, int port)
   {
-    dp = pol->GxPassiveInformation[port - 'A'];
+    if (port >= '1' && port <= '3')
+    {
+      return pol->GxTransforms[port - '1'];
+    }
+    return pol->GxPassiveTransforms[port - 'A'];
   }
-  else
+
+  //----------------------------------------------------------------------------
+  void ndiFrameFromGX(ndicapi* pol, ndiArena* arena, ndiFrame& frame)
   {
-    return 0;
-  }
+    static const char ports[] = "123ABCDEFGHI";
+    int i, n;
 
-  return (int)ndiHexToUnsignedLong(dp, 2);
-}
+    frame.SystemStatus = ndiGetGXSystemStatus(pol);
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXMarkerInfo(ndicapi* pol, int port, int marker)
-{
-  char* dp;
+    // only the ports that were included in the reply
+    n = 0;
+    for (i = 0; ports[i] != '\0'; i++)
+    {
+      if (*ndiFrameGXTransformText(pol, ports[i]) != '\0')
+      {
+        n++;
+      }
+    }
+    if (!ndiFrameAllocTools(arena, frame, n))
+    {
+      return;
+    }
 
-  if (marker < 'A' || marker > 'T')
-  {
-    return 0;
+    n = 0;
+    for (i = 0; ports[i] != '\0'; i++)
+    {
+      const char* dp = ndiFrameGXTransformText(pol, ports[i]);
+      if (*dp == '\0')
+      {
+        continue;
+      }
+      float transform[8] = { 0 };
+      frame.Handles[n] = ports[i];
+      frame.ToolStatus[n] = ndiFrameTransformFromText(dp, transform);
+      ndiFrameSetElements(frame.Transforms, 8, n, transform);
+      frame.PortStatus[n] = ndiGetGXPortStatus(pol, ports[i]);
+      frame.ToolFrameNumbers[n] = (unsigned int)ndiGetGXFrame(pol, ports[i]);
+      n++;
+    }
+    if (n > 0)
+    {
+      frame.FrameNumber = frame.ToolFrameNumbers[0];
+    }
+
+    ndiFrameStraysFromText(arena, frame, pol->GxPassiveStray + 3, ndiGetGXNumberOfPassiveStrays(pol));
   }
 
-  if (port >= '1' && port <= '3')
+  //----------------------------------------------------------------------------
+  void ndiFrameFromTX(ndicapi* pol, ndiArena* arena, ndiFrame& frame)
   {
-    dp = pol->GxInformation[port - '1'];
+    int i, n;
+
+    frame.SystemStatus = ndiGetTXSystemStatus(pol);
+
+    n = pol->TxHandleCount;
+    if (!ndiFrameAllocTools(arena, frame, n))
+    {
+      return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      float transform[8] = { 0 };
+      frame.Handles[i] = pol->TxHandles[i];
+      frame.ToolStatus[i] = ndiFrameTransformFromText(pol->TxTransforms[i], transform);
+      ndiFrameSetElements(frame.Transforms, 8, i, transform);
+      frame.PortStatus[i] = (unsigned int)ndiHexToUnsignedLong(pol->TxStatus[i], 8);
+      frame.ToolFrameNumbers[i] = (unsigned int)ndiHexToUnsignedLong(pol->TxFrame[i], 8);
+    }
+    if (n > 0)
+    {
+      frame.FrameNumber = frame.ToolFrameNumbers[0];
+    }
+
+    n = 0;
+    if (pol->TxPassiveStray[0] != '\0' && pol->TxPassiveStrayCount > 0)
+    {
+      n = (pol->TxPassiveStrayCount > 50 ? 50 : pol->TxPassiveStrayCount);
+    }
+    ndiFrameStraysFromText(arena, frame, pol->TxPassiveStray, n);
   }
-  else if (port >= 'A' && port <= 'I')
+
+  //----------------------------------------------------------------------------
+  void ndiFrameFromBX(ndicapi* pol, ndiArena* arena, ndiFrame& frame)
   {
-    dp = pol->GxPassiveInformation[port - 'A'];
+    int i, j, k, n;
+
+    frame.SystemStatus = pol->BxSystemStatus;
+
+    n = pol->BxHandleCount;
+    if (!ndiFrameAllocTools(arena, frame, n))
+    {
+      return;
+    }
+
+    k = 0;
+    for (i = 0; i < n; i++)
+    {
+      frame.Handles[i] = (unsigned char)pol->BxHandles[i];
+      if (pol->BxHandlesStatus[i] & NDI_HANDLE_DISABLED)
+      {
+        frame.ToolStatus[i] = NDI_DISABLED;
+      }
+      else if (pol->BxHandlesStatus[i] & NDI_HANDLE_MISSING)
+      {
+        frame.ToolStatus[i] = NDI_MISSING;
+      }
+      frame.PortStatus[i] = (unsigned int)pol->BxPortStatus[i];
+      frame.ToolFrameNumbers[i] = pol->BxFrameNumber[i];
+      ndiFrameSetElements(frame.Transforms, 8, i, pol->BxTransforms[i]);
+      k += pol->Bx3DMarkerCount[i];
+    }
+    if (n > 0)
+    {
+      frame.FrameNumber = frame.ToolFrameNumbers[0];
+    }
+
+    if (ndiFrameAllocMarkers(arena, frame, k))
+    {
+      k = 0;
+      for (i = 0; i < n; i++)
+      {
+        for (j = 0; j < pol->Bx3DMarkerCount[i]; j++)
+        {
+          frame.MarkerHandles[k] = frame.Handles[i];
+          ndiFrameSetElements(frame.Markers, 3, k, pol->Bx3DMarkerPosition[i][j]);
+          k++;
+        }
+      }
+    }
+
+    if (ndiFrameAllocStrays(arena, frame, pol->BxPassiveStrayCount))
+    {
+      for (i = 0; i < frame.StrayCount; i++)
+      {
+        ndiFrameSetElements(frame.Strays, 3, i, pol->BxPassiveStrayPosition[i]);
+      }
+    }
   }
-  else
+
+  //----------------------------------------------------------------------------
+  void ndiFrameFromBX2(ndicapi* pol, ndiArena* arena, ndiFrame& frame)
   {
-    return 0;
-  }
-  dp += 11 - (marker - 'A');
+    unsigned int i, j, n;
+    int markerCount, strayCount;
 
-  return (int)ndiHexToUnsignedLong(dp, 1);
-}
+    // the frame needs the 6D and 3D components even if decoding is lazy
+    ndiBX2DecodePending(pol, NDI_BX2_SLOT_6D);
+    ndiBX2DecodePending(pol, NDI_BX2_SLOT_3D);
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXSingleStray(ndicapi* pol, int port, double coord[3])
-{
-  char* dp;
+    frame.FrameNumber = pol->Bx2FrameNumber;
+    ndiGetBX2Timestamp(pol, &frame.TimestampSeconds, &frame.TimestampNanoseconds);
+
+    n = pol->Bx2HandleCount;
+    if (!ndiFrameAllocTools(arena, frame, (int)n))
+    {
+      return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+      frame.Handles[i] = pol->Bx2Handles[i];
+      frame.ToolStatus[i] = ndiBX2HandleState(pol->Bx2HandlesStatus[i]);
+      frame.PortStatus[i] = pol->Bx2HandlesStatus[i];
+      frame.ToolFrameNumbers[i] = pol->Bx2FrameNumber;
+      ndiFrameSetElements(frame.Transforms, 8, i, pol->Bx2Transforms[i]);
+    }
+
+    // 3D items with the stray handle hold the strays, missing strays are dropped
+    markerCount = 0;
+    strayCount = 0;
+    for (i = 0; i < pol->Bx2_3DCount; i++)
+    {
+      for (j = 0; j < pol->Bx2_3DMarkerCount[i]; j++)
+      {
+        if (pol->Bx2_3DHandles[i] != 0xFFFF)
+        {
+          markerCount++;
+        }
+        else if (pol->Bx2_3DMarkerStatus[i][j] != NDI_BX2_3D_MISSING)
+        {
+          strayCount++;
+        }
+      }
+    }
+    if (!ndiFrameAllocMarkers(arena, frame, markerCount) || !ndiFrameAllocStrays(arena, frame, strayCount))
+    {
+      frame.MarkerCount = 0;
+      return;
+    }
 
-  if (port >= '1' && port <= '3')
-  {
-    dp = pol->GxSingleStray[port - '1'];
-  }
-  else
-  {
-    return NDI_DISABLED;
+    markerCount = 0;
+    strayCount = 0;
+    for (i = 0; i < pol->Bx2_3DCount; i++)
+    {
+      for (j = 0; j < pol->Bx2_3DMarkerCount[i]; j++)
+      {
+        if (pol->Bx2_3DHandles[i] != 0xFFFF)
+        {
+          frame.MarkerHandles[markerCount] = pol->Bx2_3DHandles[i];
+          frame.MarkerStatus[markerCount] = (pol->Bx2_3DMarkerStatus[i][j] == NDI_BX2_3D_MISSING ? NDI_MISSING : NDI_OKAY);
+          ndiFrameSetElements(frame.Markers, 3, markerCount, pol->Bx2_3DMarkerPosition[i][j]);
+          markerCount++;
+        }
+        else if (pol->Bx2_3DMarkerStatus[i][j] != NDI_BX2_3D_MISSING)
+        {
+          ndiFrameSetElements(frame.Strays, 3, strayCount, pol->Bx2_3DMarkerPosition[i][j]);
+          strayCount++;
+        }
+      }
+    }
   }
 
-  if (*dp == 'D' || *dp == '\0')
-  {
-    return NDI_DISABLED;
-  }
-  else if (*dp == 'M')
+  //----------------------------------------------------------------------------
+  // The frame and its arrays share one arena, so a consumer that walks the
+  // frame touches no other part of the ndicapi structure
+  ndiFrame* ndiBuildFrame(ndicapi* pol, int source, ndiArena*& arena)
   {
-    return NDI_MISSING;
-  }
+    ndiArenaRewind(arena);
+    ndiFrame* frame = (ndiFrame*)ndiArenaAlloc(arena, sizeof(ndiFrame));
+    if (frame == NULL)
+    {
+      return NULL;
+    }
+    frame->Source = source;
 
-  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
-  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
-  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
+    switch (source)
+    {
+    case NDI_FRAME_GX:
+      ndiFrameFromGX(pol, arena, *frame);
+      break;
+    case NDI_FRAME_TX:
+      ndiFrameFromTX(pol, arena, *frame);
+      break;
+    case NDI_FRAME_BX:
+      ndiFrameFromBX(pol, arena, *frame);
+      break;
+    case NDI_FRAME_BX2:
+      ndiFrameFromBX2(pol, arena, *frame);
+      break;
+    }
 
-  return NDI_OKAY;
+    return frame;
+  }
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned long ndiGetGXFrame(ndicapi* pol, int port)
+ndicapiExport const ndiFrame* ndiGetFrame(ndicapi* pol)
 {
-  char* dp;
-
-  if (port >= '1' && port <= '3')
-  {
-    dp = pol->GxFrame[port - '1'];
-  }
-  else if (port >= 'A' && port <= 'I')
+  if (pol->FrameSource == NDI_FRAME_NONE)
   {
-    dp = pol->GxPassiveFrame[port - 'A'];
+    return NULL;
   }
-  else
+
+  if (!pol->FrameIsBuilt)
   {
-    return 0;
+    pol->Frame = ndiBuildFrame(pol, pol->FrameSource, pol->FrameArena);
+    if (pol->Frame == NULL)
+    {
+      return NULL;
+    }
+    pol->FrameIsBuilt = true;
   }
 
-  return (unsigned long)ndiHexToUnsignedLong(dp, 8);
+  return pol->Frame;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXNumberOfPassiveStrays(ndicapi* pol)
+// Edges of the BX2 system alerts and tool buttons, see ndiPollAlertEvent()
+// and ndiPollButtonEvent().  Both are sets of pairs, (type, code) for an
+// alert and (handle, button number) for a button.  The set of the previous
+// frame is kept so that each pair is reported once when it appears and
+// once when it goes away, however many frames it spans.
+#define NDI_EDGE_QUEUE_SIZE 64
+
+template <typename Event, typename Callback>
+struct ndiBX2EdgeState
 {
-  const char* dp;
-  int n;
-
-  dp = pol->GxPassiveStray;
-
-  if (*dp == '\0')
-  {
-    return 0;
-  }
+  int ActiveCount;
+  unsigned short (*Active)[2];            // the pairs of the current frame
+  unsigned short (*Previous)[2];          // the pairs of the previous frame
+  int Size;                               // allocated entries, in both arrays
 
-  n = (int)ndiSignedToLong(dp, 3);
-  if (n < 0)
-  {
-    return 0;
-  }
-  if (n > 20)
-  {
-    return 20;
-  }
+  Event Queue[NDI_EDGE_QUEUE_SIZE];
+  int QueueHead;                          // oldest event
+  int QueueCount;
+  unsigned int Dropped;                   // events lost because the queue was full
 
-  return n;
-}
+  Callback EventCallback;
+  void* CallbackData;
+};
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetGXPassiveStray(ndicapi* pol, int i, double coord[3])
+struct ndiBX2AlertState : ndiBX2EdgeState<ndiAlertEvent, NDIAlertCallback>
 {
-  const char* dp;
-  int n;
+};
 
-  dp = pol->GxPassiveStray;
+struct ndiBX2ButtonState : ndiBX2EdgeState<ndiButtonEvent, NDIButtonCallback>
+{
+};
 
-  if (*dp == '\0')
+namespace
+{
+  //----------------------------------------------------------------------------
+  // The state is created when the application first polls for events or
+  // sets a callback, and the edges are only tracked from then on
+  template <typename State>
+  State* ndiBX2GetEdgeState(State*& state)
   {
-    return NDI_DISABLED;
+    if (state == NULL)
+    {
+      state = (State*)calloc(1, sizeof(State));
+    }
+    return state;
   }
 
-  n = (int)ndiSignedToLong(dp, 3);
-  dp += 3;
-  if (n < 0)
+  //----------------------------------------------------------------------------
+  template <typename State>
+  void ndiBX2EdgeStateDestroy(State*& state)
   {
-    return NDI_MISSING;
+    if (state != NULL)
+    {
+      free(state->Active);
+      free(state->Previous);
+      free(state);
+      state = NULL;
+    }
   }
-  if (n > 20)
+
+  //----------------------------------------------------------------------------
+  // Start a new frame of up to n pairs.  The pairs of the frame before become
+  // the previous set, and the current set is emptied.
+  template <typename State>
+  bool ndiBX2EdgeStart(State* state, int n, unsigned short (*&previous)[2], int& previousCount)
   {
-    n = 20;
+    if (n > state->Size)
+    {
+      unsigned short (*active)[2] = (unsigned short(*)[2])realloc(state->Active, n * sizeof(unsigned short[2]));
+      if (active == NULL)
+      {
+        return false;
+      }
+      state->Active = active;
+      unsigned short (*spare)[2] = (unsigned short(*)[2])realloc(state->Previous, n * sizeof(unsigned short[2]));
+      if (spare == NULL)
+      {
+        return false;
+      }
+      state->Previous = spare;
+      state->Size = n;
+    }
+
+    previous = state->Active;
+    previousCount = state->ActiveCount;
+    state->Active = state->Previous;
+    state->Previous = previous;
+    state->ActiveCount = 0;
+    return true;
   }
 
-  if (i < 0 || i >= n)
+  //----------------------------------------------------------------------------
+  // Check whether an alert (type, code) or a button (handle, number) is in a set
+  bool ndiBX2PairIsIn(const unsigned short pair[2], const unsigned short (*pairs)[2], int count)
   {
-    return NDI_MISSING;
+    for (int i = 0; i < count; i++)
+    {
+      if (pairs[i][0] == pair[0] && pairs[i][1] == pair[1])
+      {
+        return true;
+      }
+    }
+    return false;
   }
 
-  dp += 7 * 3 * i;
-  coord[0] = ndiSignedToLong(&dp[0],  7) * 0.01;
-  coord[1] = ndiSignedToLong(&dp[7],  7) * 0.01;
-  coord[2] = ndiSignedToLong(&dp[14], 7) * 0.01;
-
-  return NDI_OKAY;
-}
+  //----------------------------------------------------------------------------
+  template <typename State>
+  void ndiBX2EdgeAdd(State* state, const unsigned short pair[2])
+  {
+    state->Active[state->ActiveCount][0] = pair[0];
+    state->Active[state->ActiveCount][1] = pair[1];
+    state->ActiveCount++;
+  }
 
-//----------------------------------------------------------------------------
-ndicapiExport unsigned short ndiGetBXReplyLength(ndicapi* pol)
-{
-  return pol->BxReplyLength;
-}
+  //----------------------------------------------------------------------------
+  // Queue an event, dropping the oldest one if the application has not
+  // kept up, then pass it to the callback
+  template <typename State, typename Event>
+  void ndiBX2EdgeQueue(State* state, const Event& event)
+  {
+    if (state->QueueCount == NDI_EDGE_QUEUE_SIZE)
+    {
+      state->QueueHead = (state->QueueHead + 1) % NDI_EDGE_QUEUE_SIZE;
+      state->QueueCount--;
+      state->Dropped++;
+    }
+    state->Queue[(state->QueueHead + state->QueueCount) % NDI_EDGE_QUEUE_SIZE] = event;
+    state->QueueCount++;
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXTransform(ndicapi* pol, int portHandle, float transform[8])
-{
-  int i, n;
+    if (state->EventCallback)
+    {
+      state->EventCallback(&event, state->CallbackData);
+    }
+  }
 
-  n = pol->BxHandleCount;
-  for (i = 0; i < n; i++)
+  //----------------------------------------------------------------------------
+  template <typename State, typename Event>
+  int ndiBX2EdgePoll(State* state, Event* event)
   {
-    if (pol->BxHandles[i] == portHandle)
+    if (state == NULL || state->QueueCount == 0)
     {
-      break;
+      return 0;
     }
+
+    *event = state->Queue[state->QueueHead];
+    state->QueueHead = (state->QueueHead + 1) % NDI_EDGE_QUEUE_SIZE;
+    state->QueueCount--;
+    return 1;
   }
-  if (i == n)
+
+  //----------------------------------------------------------------------------
+  void ndiBX2AlertsDestroy(ndicapi* api)
   {
-    return NDI_DISABLED;
+    ndiBX2EdgeStateDestroy(api->Bx2AlertState);
   }
 
-  memcpy(&transform[0], &pol->BxTransforms[i][0], sizeof(float) * 8);
-  if (pol->BxHandlesStatus[i] & NDI_HANDLE_DISABLED)
+  //----------------------------------------------------------------------------
+  void ndiBX2AlertEmit(ndicapi* api, ndiBX2AlertState* state, const unsigned short alert[2], int onset)
   {
-    return NDI_DISABLED;
+    ndiAlertEvent event;
+    event.Onset = onset;
+    event.Type = alert[0];
+    event.Code = alert[1];
+    event.FrameNumber = api->Bx2FrameNumber;
+    ndiGetBX2Timestamp(api, &event.TimestampSeconds, &event.TimestampNanoseconds);
+    ndiBX2EdgeQueue(state, event);
   }
-  else if (pol->BxHandlesStatus[i] & NDI_HANDLE_MISSING)
+
+  //----------------------------------------------------------------------------
+  // Compare the alerts of the selected frame with those of the previous frame
+  void ndiBX2AlertsUpdate(ndicapi* api)
   {
-    return NDI_MISSING;
-  }
+    if ((api->Bx2DecodeMask & NDI_BX2_DECODE_SYS_ALERT) == 0 || (api->Bx2PresentComponents & NDI_BX2_DECODE_SYS_ALERT) == 0)
+    {
+      // without the alerts, every condition would appear to have cleared
+      return;
+    }
+    ndiBX2AlertState* state = api->Bx2AlertState;
+    if (state == NULL)
+    {
+      // alert events have not been asked for, so the alerts need not be decoded
+      return;
+    }
 
-  return NDI_OKAY;
-}
+    ndiBX2DecodePending(api, NDI_BX2_SLOT_SYS_ALERT);
+    int n = api->Bx2SystemAlertsCount;
+    const unsigned short (*alerts)[2] = api->Bx2SystemAlerts;
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXPortStatus(ndicapi* pol, int portHandle)
-{
-  int i, n;
+    unsigned short (*previous)[2];
+    int previousCount;
+    if (!ndiBX2EdgeStart(state, n, previous, previousCount))
+    {
+      return;
+    }
 
-  n = pol->BxHandleCount;
-  for (i = 0; i < n; i++)
-  {
-    if (pol->BxHandles[i] == portHandle)
+    // conditions that are no longer reported have cleared, events are
+    // one-shot and have no clear edge
+    for (int i = 0; i < previousCount; i++)
     {
-      break;
+      if (previous[i][0] != NDI_SYS_ALERT_EVENT && !ndiBX2PairIsIn(previous[i], alerts, n))
+      {
+        ndiBX2AlertEmit(api, state, previous[i], 0);
+      }
+    }
+
+    // new conditions, duplicates within the frame are only kept once
+    for (int i = 0; i < n; i++)
+    {
+      if (ndiBX2PairIsIn(alerts[i], state->Active, state->ActiveCount))
+      {
+        continue;
+      }
+      if (!ndiBX2PairIsIn(alerts[i], previous, previousCount))
+      {
+        ndiBX2AlertEmit(api, state, alerts[i], 1);
+      }
+      ndiBX2EdgeAdd(state, alerts[i]);
     }
   }
-  if (i == n)
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetAlertCallback(ndicapi* pol, NDIAlertCallback callback, void* userdata)
+{
+  ndiBX2AlertState* state = ndiBX2GetEdgeState(pol->Bx2AlertState);
+  if (state != NULL)
   {
-    return 0;
+    state->EventCallback = callback;
+    state->CallbackData = userdata;
   }
+}
 
-  return pol->BxPortStatus[i];
+//----------------------------------------------------------------------------
+ndicapiExport int ndiPollAlertEvent(ndicapi* pol, ndiAlertEvent* event)
+{
+  // the first poll starts the tracking of alerts
+  return ndiBX2EdgePoll(ndiBX2GetEdgeState(pol->Bx2AlertState), event);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned long ndiGetBXFrame(ndicapi* pol, int portHandle)
+ndicapiExport unsigned int ndiGetAlertEventsDropped(ndicapi* pol)
 {
-  int i, n;
+  return (pol->Bx2AlertState ? pol->Bx2AlertState->Dropped : 0);
+}
 
-  n = pol->BxHandleCount;
-  for (i = 0; i < n; i++)
+namespace
+{
+  //----------------------------------------------------------------------------
+  void ndiBX2ButtonsDestroy(ndicapi* api)
   {
-    if (pol->BxHandles[i] == portHandle)
-    {
-      break;
-    }
+    ndiBX2EdgeStateDestroy(api->Bx2ButtonState);
   }
-  if (i == n)
+
+  //----------------------------------------------------------------------------
+  void ndiBX2ButtonEmit(ndicapi* api, ndiBX2ButtonState* state, const unsigned short button[2], int pressed)
   {
-    return 0;
+    ndiButtonEvent event;
+    event.Pressed = pressed;
+    event.Handle = button[0];
+    event.Button = button[1];
+    event.FrameNumber = api->Bx2FrameNumber;
+    ndiGetBX2Timestamp(api, &event.TimestampSeconds, &event.TimestampNanoseconds);
+    ndiBX2EdgeQueue(state, event);
   }
 
-  return pol->BxFrameNumber[i];
-}
+  //----------------------------------------------------------------------------
+  // Compare the buttons of the selected frame with those of the previous
+  // frame that reported buttons.  Only the buttons that are held down are
+  // in the set, and a button counts as released when its tool is no longer
+  // reported, so that a tool that drops out cannot leave a button held down.
+  void ndiBX2ButtonsUpdate(ndicapi* api)
+  {
+    if ((api->Bx2DecodeMask & NDI_BX2_DECODE_1D) == 0 || (api->Bx2PresentComponents & NDI_BX2_DECODE_1D) == 0)
+    {
+      // frames without buttons, e.g. passive frames, say nothing about them
+      return;
+    }
+    ndiBX2ButtonState* state = api->Bx2ButtonState;
+    if (state == NULL)
+    {
+      // button events have not been asked for, so the buttons need not be decoded
+      return;
+    }
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXToolInfo(ndicapi* pol, int portHandle, char& outToolInfo)
-{
-  int i, n;
+    ndiBX2DecodePending(api, NDI_BX2_SLOT_1D);
+    int n = 0;
+    for (unsigned int i = 0; i < api->Bx2_1DCount; i++)
+    {
+      n += api->Bx2_1DButtonCount[i];
+    }
 
-  n = pol->BxHandleCount;
-  for (i = 0; i < n; i++)
-  {
-    if (pol->BxHandles[i] == portHandle)
+    unsigned short (*previous)[2];
+    int previousCount;
+    if (!ndiBX2EdgeStart(state, n, previous, previousCount))
     {
-      break;
+      return;
+    }
+
+    for (unsigned int i = 0; i < api->Bx2_1DCount; i++)
+    {
+      for (unsigned short j = 0; j < api->Bx2_1DButtonCount[i]; j++)
+      {
+        if (api->Bx2_1DButtons[i][j] != 0)
+        {
+          unsigned short button[2] = { api->Bx2_1DHandles[i], j };
+          if (!ndiBX2PairIsIn(button, previous, previousCount))
+          {
+            ndiBX2ButtonEmit(api, state, button, 1);
+          }
+          ndiBX2EdgeAdd(state, button);
+        }
+      }
+    }
+
+    for (int i = 0; i < previousCount; i++)
+    {
+      if (!ndiBX2PairIsIn(previous[i], state->Active, state->ActiveCount))
+      {
+        ndiBX2ButtonEmit(api, state, previous[i], 0);
+      }
     }
   }
-  if (i == n)
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetButtonCallback(ndicapi* pol, NDIButtonCallback callback, void* userdata)
+{
+  ndiBX2ButtonState* state = ndiBX2GetEdgeState(pol->Bx2ButtonState);
+  if (state != NULL)
   {
-    return NDI_DISABLED;
+    state->EventCallback = callback;
+    state->CallbackData = userdata;
   }
+}
 
-  outToolInfo = pol->BxToolMarkerInformation[i][0];
-  return NDI_OKAY;
+//----------------------------------------------------------------------------
+ndicapiExport int ndiPollButtonEvent(ndicapi* pol, ndiButtonEvent* event)
+{
+  // the first poll starts the tracking of buttons
+  return ndiBX2EdgePoll(ndiBX2GetEdgeState(pol->Bx2ButtonState), event);
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXMarkerInfo(ndicapi* pol, int portHandle, int marker, char& outMarkerInfo)
+ndicapiExport unsigned int ndiGetButtonEventsDropped(ndicapi* pol)
 {
-  int i, n;
+  return (pol->Bx2ButtonState ? pol->Bx2ButtonState->Dropped : 0);
+}
 
-  if (marker >= 20)
-  {
-    return false;
-  }
+//----------------------------------------------------------------------------
+// Copies of the most recent BX2 images, see ndiSetBX2ImageRing()
+struct ndiBX2ImageRing
+{
+  int Depth;
+  int Count;                              // number of images in the ring
+  int Next;                               // slot for the next image
+  ndiBX2Image* Images;
+  unsigned char** Pixels;                 // owned by the ring, one per slot
+  unsigned int* Capacities;               // size of each pixel buffer
+};
 
-  n = pol->BxHandleCount;
-  for (i = 0; i < n; i++)
+namespace
+{
+  //----------------------------------------------------------------------------
+  void ndiBX2ImageRingDestroy(ndicapi* api)
   {
-    if (pol->BxHandles[i] == portHandle)
+    ndiBX2ImageRing* ring = api->Bx2ImageRing;
+    if (ring != NULL)
     {
-      break;
+      for (int i = 0; i < ring->Depth; i++)
+      {
+        free(ring->Pixels[i]);
+      }
+      free(ring->Images);
+      free(ring->Pixels);
+      free(ring->Capacities);
+      free(ring);
+      api->Bx2ImageRing = NULL;
     }
   }
-  if (i == n)
-  {
-    return NDI_DISABLED;
-  }
 
-  int byteIndex = marker / 2;
-  if (marker % 2 == 0)
-  {
-    // low 4 bits, little endian format, so index backwards from the rear
-    outMarkerInfo = pol->BxToolMarkerInformation[i][1 + (10 - byteIndex)] & 0x00FF;
-  }
-  else
+  //----------------------------------------------------------------------------
+  // Copy the images of the selected BX2 frame into the ring.  The pixel
+  // buffers are kept from one lap of the ring to the next, so nothing is
+  // allocated once the ring has filled with images of the usual size.
+  void ndiBX2ImageRingPush(ndicapi* api)
   {
-    // high 4 bits, little endian format, so index backwards from the rear
-    outMarkerInfo = pol->BxToolMarkerInformation[i][1 + (10 - byteIndex)] & 0xFF00 >> 4;
+    ndiBX2ImageRing* ring = api->Bx2ImageRing;
+    if (ring == NULL ||
+        (api->Bx2DecodeMask & NDI_BX2_DECODE_IMAGE) == 0 ||
+        (api->Bx2PresentComponents & NDI_BX2_DECODE_IMAGE) == 0)
+    {
+      return;
+    }
+
+    ndiBX2DecodePending(api, NDI_BX2_SLOT_IMAGE);
+    for (unsigned int i = 0; i < api->Bx2ImageCount; i++)
+    {
+      const ndiBX2Image& image = api->Bx2Images[i];
+      int slot = ring->Next;
+      if (image.Size > ring->Capacities[slot])
+      {
+        unsigned char* pixels = (unsigned char*)realloc(ring->Pixels[slot], image.Size);
+        if (pixels == NULL)
+        {
+          return;
+        }
+        ring->Pixels[slot] = pixels;
+        ring->Capacities[slot] = image.Size;
+      }
+      if (image.Size > 0)
+      {
+        memcpy(ring->Pixels[slot], image.Pixels, image.Size);
+      }
+      ring->Images[slot] = image;
+      ring->Images[slot].Pixels = ring->Pixels[slot];
+
+      ring->Next = (slot + 1) % ring->Depth;
+      if (ring->Count < ring->Depth)
+      {
+        ring->Count++;
+      }
+    }
   }
-  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXSingleStray(ndicapi* pol, int portHandle, float outCoord[3])
+ndicapiExport int ndiSetBX2ImageRing(ndicapi* pol, int depth)
 {
-  int i, n;
+  if (depth < 0)
+  {
+    return NDI_DISABLED;
+  }
 
-  n = pol->BxHandleCount;
-  for (i = 0; i < n; i++)
+  ndiBX2ImageRingDestroy(pol);
+  if (depth > 0)
   {
-    if (pol->BxHandles[i] == portHandle)
+    ndiBX2ImageRing* ring = (ndiBX2ImageRing*)calloc(1, sizeof(ndiBX2ImageRing));
+    if (ring == NULL)
     {
-      break;
+      return NDI_DISABLED;
     }
-  }
-  if (i == n)
-  {
-    return NDI_DISABLED;
+    ring->Images = (ndiBX2Image*)calloc(depth, sizeof(ndiBX2Image));
+    ring->Pixels = (unsigned char**)calloc(depth, sizeof(unsigned char*));
+    ring->Capacities = (unsigned int*)calloc(depth, sizeof(unsigned int));
+    if (ring->Images == NULL || ring->Pixels == NULL || ring->Capacities == NULL)
+    {
+      free(ring->Images);
+      free(ring->Pixels);
+      free(ring->Capacities);
+      free(ring);
+      return NDI_DISABLED;
+    }
+    ring->Depth = depth;
+    pol->Bx2ImageRing = ring;
   }
 
-  memcpy(outCoord, pol->BxActiveSingleStrayMarkerPosition[i], sizeof(float) * 3);
   return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXNumberOfPassiveStrays(ndicapi* pol)
-{
-  return pol->BxPassiveStrayCount;
-}
-
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXPassiveStray(ndicapi* pol, int i, float outCoord[3])
+ndicapiExport const ndiBX2Image* ndiGetBX2RingImage(ndicapi* pol, int age)
 {
-  if (i > pol->BxPassiveStrayCount)
+  ndiBX2ImageRing* ring = pol->Bx2ImageRing;
+  if (ring == NULL || age < 0 || age >= ring->Count)
   {
-    return NDI_DISABLED;
+    return NULL;
   }
-  memcpy(outCoord, pol->BxPassiveStrayPosition[i], sizeof(float) * 3);
-  return NDI_OKAY;
+
+  int slot = (ring->Next - 1 - age + ring->Depth) % ring->Depth;
+  return &ring->Images[slot];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetBXSystemStatus(ndicapi* pol)
+// One stream of BX2 frames of a single frame type, see ndiAddBX2StreamCallback()
+struct ndiBX2StreamSubscriber
 {
-  return pol->BxSystemStatus;
-}
+  NDIBX2StreamCallback Callback;
+  void* UserData;
+};
 
-//----------------------------------------------------------------------------
-ndicapiExport int ndiGetBX2Transform(ndicapi* pol, int portHandle, float transform[8])
+struct ndiBX2Stream
 {
-  int i, n;
+  ndiBX2StreamStats Stats;
+  double MeanInterval;                    // smoothed seconds between frames
 
-  n = pol->Bx2HandleCount;
-  for (i = 0; i < n; i++)
+  int HistoryDepth;                       // number of frames kept, zero for none
+  int HistoryCount;                       // number of frames in the history
+  int HistoryNext;                        // slot for the next frame
+  ndiArena** HistoryArenas;               // one arena per slot, holds the frame
+  ndiFrame** HistoryFrames;
+
+  int SubscriberCount;
+  ndiBX2StreamSubscriber* Subscribers;
+};
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void ndiBX2StreamFreeHistory(ndiBX2Stream* stream)
   {
-    if (pol->Bx2Handles[i] == portHandle)
+    for (int i = 0; i < stream->HistoryDepth; i++)
     {
-      break;
+      ndiArenaDestroy(stream->HistoryArenas[i]);
     }
+    free(stream->HistoryArenas);
+    free(stream->HistoryFrames);
+    stream->HistoryArenas = NULL;
+    stream->HistoryFrames = NULL;
+    stream->HistoryDepth = 0;
+    stream->HistoryCount = 0;
+    stream->HistoryNext = 0;
   }
-  if (i == n)
+
+  //----------------------------------------------------------------------------
+  // The streams are created with the device handle, so that the replies
+  // only ever update them
+  bool ndiBX2StreamsCreate(ndicapi* api)
   {
-    return NDI_DISABLED;
+    api->Bx2Streams = (ndiBX2Stream*)calloc(NDI_BX2_FRAME_TYPE_COUNT, sizeof(ndiBX2Stream));
+    return (api->Bx2Streams != NULL);
   }
 
-  memcpy(&transform[0], &pol->Bx2Transforms[i][0], sizeof(float) * 8);
-  if (pol->Bx2HandlesStatus[i] & NDI_HANDLE_DISABLED)
+  //----------------------------------------------------------------------------
+  // Return the stream for a frame type
+  ndiBX2Stream* ndiBX2GetStream(ndicapi* api, int frameType)
   {
-    return NDI_DISABLED;
+    if (frameType < 0 || frameType >= NDI_BX2_FRAME_TYPE_COUNT || api->Bx2Streams == NULL)
+    {
+      return NULL;
+    }
+    return &api->Bx2Streams[frameType];
   }
-  else if (pol->Bx2HandlesStatus[i] & NDI_BX2_MISSING_BIT)
+
+  //----------------------------------------------------------------------------
+  void ndiBX2StreamsDestroy(ndicapi* api)
   {
-    return NDI_MISSING;
+    if (api->Bx2Streams != NULL)
+    {
+      for (int i = 0; i < NDI_BX2_FRAME_TYPE_COUNT; i++)
+      {
+        ndiBX2StreamFreeHistory(&api->Bx2Streams[i]);
+        free(api->Bx2Streams[i].Subscribers);
+      }
+      free(api->Bx2Streams);
+      api->Bx2Streams = NULL;
+    }
   }
 
-  return NDI_OKAY;
-}
+  //----------------------------------------------------------------------------
+  // Hand the selected BX2 frame to the stream for its frame type
+  void ndiBX2StreamPush(ndicapi* api)
+  {
+    ndiBX2Stream* stream = ndiBX2GetStream(api, api->Bx2FrameType);
+    if (stream == NULL)
+    {
+      return;
+    }
 
-//----------------------------------------------------------------------------
-ndicapiExport unsigned int ndiGetBX2ReplyLength(ndicapi* pol)
-{
-  return pol->Bx2ReplyLength;
+    // the frame rate comes from the device timestamps, not from the time
+    // at which the host happened to poll
+    ndiBX2StreamStats& stats = stream->Stats;
+    unsigned int seconds, nanoseconds;
+    ndiGetBX2Timestamp(api, &seconds, &nanoseconds);
+    if (stats.FrameCount > 0)
+    {
+      double interval = ((double)seconds - stats.LastTimestampSeconds) + ((double)nanoseconds - stats.LastTimestampNanoseconds) * 1e-9;
+      if (interval > 0)
+      {
+        stream->MeanInterval = (stream->MeanInterval > 0 ? 0.9 * stream->MeanInterval + 0.1 * interval : interval);
+        stats.FrameRate = 1.0 / stream->MeanInterval;
+      }
+    }
+    stats.FrameCount++;
+    stats.LastFrameNumber = api->Bx2FrameNumber;
+    stats.LastTimestampSeconds = seconds;
+    stats.LastTimestampNanoseconds = nanoseconds;
+
+    if (stream->HistoryDepth > 0)
+    {
+      int slot = stream->HistoryNext;
+      stream->HistoryFrames[slot] = ndiBuildFrame(api, NDI_FRAME_BX2, stream->HistoryArenas[slot]);
+      stream->HistoryNext = (slot + 1) % stream->HistoryDepth;
+      if (stream->HistoryCount < stream->HistoryDepth)
+      {
+        stream->HistoryCount++;
+      }
+    }
+
+    for (int i = 0; i < stream->SubscriberCount; i++)
+    {
+      stream->Subscribers[i].Callback(api, api->Bx2FrameType, stream->Subscribers[i].UserData);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Deliver every frame of a BX2 reply to its stream, in reply order, after
+  // its alert and button edges and its images.  The last frame is left selected, as it is after a reply.
+  void ndiBX2StreamsUpdate(ndicapi* api)
+  {
+    int n = api->Bx2FrameCount;
+    for (int i = 0; i < n; i++)
+    {
+      ndiSelectBX2Frame(api, i);
+      ndiBX2AlertsUpdate(api);
+      ndiBX2ButtonsUpdate(api);
+      ndiBX2ImageRingPush(api);
+      ndiBX2StreamPush(api);
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned short ndiGetBX2PortStatus(ndicapi* pol, int portHandle)
+ndicapiExport int ndiSetBX2StreamHistory(ndicapi* pol, int frameType, int depth)
 {
-  int i, n;
+  ndiBX2Stream* stream = ndiBX2GetStream(pol, frameType);
+  if (stream == NULL || depth < 0)
+  {
+    return NDI_DISABLED;
+  }
 
-  n = pol->Bx2HandleCount;
-  for (i = 0; i < n; i++)
+  ndiBX2StreamFreeHistory(stream);
+  if (depth > 0)
   {
-    if (pol->Bx2Handles[i] == portHandle)
+    stream->HistoryArenas = (ndiArena**)calloc(depth, sizeof(ndiArena*));
+    stream->HistoryFrames = (ndiFrame**)calloc(depth, sizeof(ndiFrame*));
+    if (stream->HistoryArenas == NULL || stream->HistoryFrames == NULL)
     {
-      break;
+      free(stream->HistoryArenas);
+      free(stream->HistoryFrames);
+      stream->HistoryArenas = NULL;
+      stream->HistoryFrames = NULL;
+      return NDI_DISABLED;
     }
+    stream->HistoryDepth = depth;
   }
-  if (i == n)
+
+  return NDI_OKAY;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport const ndiFrame* ndiGetBX2StreamFrame(ndicapi* pol, int frameType, int age)
+{
+  ndiBX2Stream* stream = ndiBX2GetStream(pol, frameType);
+  if (stream == NULL || age < 0 || age >= stream->HistoryCount)
   {
-    return 0;
+    return NULL;
   }
 
-  return pol->Bx2HandlesStatus[i];
+  int slot = (stream->HistoryNext - 1 - age + stream->HistoryDepth) % stream->HistoryDepth;
+  return stream->HistoryFrames[slot];
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned short* ndiGetBX2SystemAlert(ndicapi* pol, int index)
+ndicapiExport int ndiGetBX2StreamStats(ndicapi* pol, int frameType, ndiBX2StreamStats* stats)
 {
-  if (index < pol->Bx2SystemAlertsCount)
+  ndiBX2Stream* stream = ndiBX2GetStream(pol, frameType);
+  if (stream == NULL)
   {
-    return pol->Bx2SystemAlerts[index];
+    return NDI_DISABLED;
   }
 
-  return nullptr;
+  *stats = stream->Stats;
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiGetBX2SystemAlertsCount(ndicapi* pol)
+ndicapiExport void ndiResetBX2Stream(ndicapi* pol, int frameType)
 {
-  return pol->Bx2SystemAlertsCount;
+  ndiBX2Stream* stream = ndiBX2GetStream(pol, frameType);
+  if (stream != NULL)
+  {
+    memset(&stream->Stats, 0, sizeof(ndiBX2StreamStats));
+    stream->MeanInterval = 0;
+    stream->HistoryCount = 0;
+    stream->HistoryNext = 0;
+  }
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport unsigned int ndiGetBX2Frame(ndicapi* pol)
+ndicapiExport int ndiAddBX2StreamCallback(ndicapi* pol, int frameType, NDIBX2StreamCallback callback, void* userdata)
 {
-  return pol->Bx2FrameNumber;
+  ndiBX2Stream* stream = ndiBX2GetStream(pol, frameType);
+  if (stream == NULL || callback == NULL)
+  {
+    return NDI_DISABLED;
+  }
+
+  ndiBX2StreamSubscriber* subscribers = (ndiBX2StreamSubscriber*)realloc(stream->Subscribers, (stream->SubscriberCount + 1) * sizeof(ndiBX2StreamSubscriber));
+  if (subscribers == NULL)
+  {
+    return NDI_DISABLED;
+  }
+  subscribers[stream->SubscriberCount].Callback = callback;
+  subscribers[stream->SubscriberCount].UserData = userdata;
+  stream->Subscribers = subscribers;
+  stream->SubscriberCount++;
+
+  return NDI_OKAY;
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport bool ndiGetBX2HandleAveragingEnabled(ndicapi* pol, int portHandle)
+ndicapiExport int ndiRemoveBX2StreamCallback(ndicapi* pol, int frameType, NDIBX2StreamCallback callback, void* userdata)
 {
-  int i, n;
+  ndiBX2Stream* stream = ndiBX2GetStream(pol, frameType);
+  if (stream == NULL)
+  {
+    return NDI_DISABLED;
+  }
 
-  n = pol->Bx2HandleCount;
-  for (i = 0; i < n; i++)
+  for (int i = 0; i < stream->SubscriberCount; i++)
   {
-    if (pol->Bx2Handles[i] == portHandle)
+    if (stream->Subscribers[i].Callback == callback && stream->Subscribers[i].UserData == userdata)
     {
-      break;
+      memmove(&stream->Subscribers[i], &stream->Subscribers[i + 1], (stream->SubscriberCount - i - 1) * sizeof(ndiBX2StreamSubscriber));
+      stream->SubscriberCount--;
+      return NDI_OKAY;
     }
   }
-  if (i == n)
-  {
-    return 0;
-  }
 
-  return pol->Bx2HandleAveragingEnabled[i];
+  return NDI_DISABLED;
 }
 
 //----------------------------------------------------------------------------
@@ -4318,7 +8355,6 @@ static void* ndiThreadFunc(void* userdata)
 
   pol = (ndicapi*)userdata;
   command = pol->ThreadCommand;
-  reply = pol->ThreadReply;
 
   while (errorCode == 0)
   {
@@ -4335,63 +8371,27 @@ static void* ndiThreadFunc(void* userdata)
     // check whether we have a GX/BX/TX command ready to send
     if (command[0] == '\0')
     {
-      if (pol->SerialDevice != NDI_INVALID_HANDLE)
-      {
-        ndiSerialSleep(pol->SerialDevice, 20);
-      }
-      else
-      {
-        ndiSocketSleep(pol->Socket, 20);
-      }
+      pol->Transport->Sleep(pol, 20);
       ndiMutexUnlock(pol->ThreadMutex);
       continue;
     }
 
-    // flush the input buffer, because anything that we haven't read
-    //   yet is garbage left over by a previously failed command
-    if (pol->SerialDevice != NDI_INVALID_HANDLE)
-    {
-      ndiSerialFlush(pol->SerialDevice, NDI_IFLUSH);
-    }
-    else
+    // the replies to a streamed command arrive without the command being sent
+    if (pol->Streaming == NULL)
     {
-      ndiSocketFlush(pol->Socket, NDI_IFLUSH);
-    }
+      // flush the input buffer, because anything that we haven't read
+      //   yet is garbage left over by a previously failed command
+      ndiTransportFlush(pol, NDI_IFLUSH);
 
-    // send the command to the Measurement System
-    i = (int)strlen(command);
-    if (errorCode == 0)
-    {
-      if (pol->SerialDevice != NDI_INVALID_HANDLE)
-      {
-        m = ndiSerialWrite(pol->SerialDevice, command, i);
-      }
-      else
-      {
-        m = ndiSocketWrite(pol->Socket, command, i);
-      }
-      if (m < 0)
-      {
-        errorCode = NDI_WRITE_ERROR;
-      }
-      else if (m < i)
-      {
-        errorCode = NDI_TIMEOUT;
-      }
+      // send the command to the Measurement System
+      errorCode = ndiTransportWrite(pol, command, (int)strlen(command));
     }
 
     // read the reply from the Measurement System
+    m = 0;
     if (errorCode == 0)
     {
-      if (pol->SerialDevice != NDI_INVALID_HANDLE)
-      {
-        m = ndiSerialRead(pol->SerialDevice, reply, 2047, pol->IsThreadedCommandBinary, &errorCode);
-      }
-      else
-      {
-        int errorCode;
-        m = ndiSocketRead(pol->Socket, reply, 2047, pol->IsThreadedCommandBinary, &errorCode);
-      }
+      m = ndiReadReply(pol, pol->ThreadReply, pol->ThreadReplySize, pol->IsThreadedCommandBinary);
       if (m < 0)
       {
         errorCode = NDI_READ_ERROR;
@@ -4402,13 +8402,30 @@ static void* ndiThreadFunc(void* userdata)
         errorCode = NDI_TIMEOUT;
       }
       // terminate the string
-      reply[m] = '\0';
+      pol->ThreadReply[m] = '\0';
+    }
+
+    if ((errorCode == NDI_WRITE_ERROR || errorCode == NDI_READ_ERROR) && pol->IsReconnectMode)
+    {
+      // restore the session, and then carry on with the same command
+      if (ndiReconnect(pol, true, true))
+      {
+        errorCode = 0;
+        ndiMutexUnlock(pol->ThreadMutex);
+        continue;
+      }
     }
 
     // lock the buffer
     ndiMutexLock(pol->ThreadBufferMutex);
-    // copy the reply into the buffer, also copy the error code
-    strcpy(pol->ThreadBuffer, reply);
+    // swap the reply into the buffer, also copy the error code
+    reply = pol->ThreadReply;
+    pol->ThreadReply = pol->ThreadBuffer;
+    pol->ThreadBuffer = reply;
+    i = pol->ThreadReplySize;
+    pol->ThreadReplySize = pol->ThreadBufferSize;
+    pol->ThreadBufferSize = i;
+    pol->ThreadBufferLength = m;
     pol->ThreadErrorCode = errorCode;
     // signal the main thread that a new data record is ready
     ndiEventSignal(pol->ThreadBufferEvent);
@@ -4430,8 +8447,11 @@ static void ndiSpawnThread(ndicapi* pol)
   pol->ThreadCommand[0] = '\0';
   pol->ThreadReply = (char*)malloc(2048);
   pol->ThreadReply[0] = '\0';
+  pol->ThreadReplySize = 2048;
   pol->ThreadBuffer = (char*)malloc(2048);
   pol->ThreadBuffer[0] = '\0';
+  pol->ThreadBufferSize = 2048;
+  pol->ThreadBufferLength = 0;
   pol->ThreadErrorCode = 0;
 
   pol->ThreadBufferMutex = ndiMutexCreate();
@@ -4495,4 +8515,44 @@ ndicapiExport void ndiSetThreadMode(ndicapi* pol, bool mode)
 ndicapiExport int ndiGetThreadMode(ndicapi* pol)
 {
   return pol->IsThreadedMode;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetReconnectMode(ndicapi* pol, bool mode)
+{
+  pol->IsReconnectMode = mode;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport void ndiSetReconnectCallback(ndicapi* pol, NDIReconnectCallback callback, void* userdata)
+{
+  pol->ReconnectCallback = callback;
+  pol->ReconnectCallbackData = userdata;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetReconnectCount(ndicapi* pol)
+{
+  // the tracking thread counts its own reconnects
+  if (!pol->IsThreadedMode)
+  {
+    return pol->ReconnectCount;
+  }
+  ndiMutexLock(pol->ThreadBufferMutex);
+  int count = pol->ReconnectCount;
+  ndiMutexUnlock(pol->ThreadBufferMutex);
+  return count;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiGetReconnectOutage(ndicapi* pol)
+{
+  if (!pol->IsThreadedMode)
+  {
+    return pol->ReconnectOutageMs;
+  }
+  ndiMutexLock(pol->ThreadBufferMutex);
+  int outage = pol->ReconnectOutageMs;
+  ndiMutexUnlock(pol->ThreadBufferMutex);
+  return outage;
 }
\ No newline at end of file
@@ -44,6 +44,7 @@ POSSIBILITY OF SUCH DAMAGES.
 #include "ndicapi_serial.h"
 #include "ndicapi_socket.h"
 #include "ndicapi_thread.h"
+#include "ndicapi_transport.h"
 
 #include <stdarg.h>
 #include <limits.h>
@@ -56,6 +57,77 @@ POSSIBILITY OF SUCH DAMAGES.
 // be simultaneously occupied)
 #define NDI_MAX_HANDLES 24
 
+// Per-reply storage for decoded BX and BX2 data, see ndicapi.cxx
+struct ndiArena;
+struct ndiBX2Component;
+struct ndiBX2Frame;
+struct ndiBX2Stream;
+struct ndiBX2AlertState;
+struct ndiBX2ButtonState;
+struct ndiBX2ImageRing;
+
+// The commands of a device-pushed stream, see ndiStartStreaming()
+struct ndiStreaming;
+
+//----------------------------------------------------------------------------
+// Tracking data from the latest GX, TX, BX or BX2 reply, in a form that does
+// not depend on the command that was used.  See ndiGetFrame().
+//
+// Coordinates are stored as one array per element rather than one array per
+// tool, and every array starts on a NDI_FRAME_ALIGNMENT boundary and is
+// zero-padded to a multiple of NDI_FRAME_ALIGNMENT bytes, so whole vectors
+// can be loaded even for the last few tools.
+#define NDI_FRAME_ALIGNMENT 64
+
+struct ndiFrame
+{
+  int Source;                             // NDI_FRAME_GX, NDI_FRAME_TX, NDI_FRAME_BX or NDI_FRAME_BX2
+  unsigned int FrameNumber;               // BX2 frame number, or the frame number of the first tool
+  unsigned int TimestampSeconds;          // BX2 only, zero for the other commands
+  unsigned int TimestampNanoseconds;
+  int SystemStatus;                       // zero for BX2, which reports system alerts instead
+
+  int ToolCount;
+  int* Handles;                           // port handle, or the port character for GX
+  int* ToolStatus;                        // NDI_OKAY, NDI_MISSING or NDI_DISABLED
+  unsigned int* PortStatus;               // port status bits, as reported by the command
+  unsigned int* ToolFrameNumbers;
+  float* Transforms[8];                   // q0, qx, qy, qz, x, y, z, error arrays
+
+  int MarkerCount;                        // 3D markers that belong to tools
+  int* MarkerHandles;                     // tool handle, for each marker
+  int* MarkerStatus;                      // NDI_OKAY or NDI_MISSING
+  float* Markers[3];                      // x, y, z arrays
+
+  int StrayCount;                         // stray passive markers
+  float* Strays[3];                       // x, y, z arrays
+};
+
+//----------------------------------------------------------------------------
+// A sensor image from a BX2 reply, see ndiGetBX2Image().  The pixels are
+// not copied out of the reply, so they are only valid until the next
+// command, unless the image was taken from the ring (ndiGetBX2RingImage()).
+struct ndiBX2Image
+{
+  unsigned short Sensor;                  // the sensor that took the image
+  unsigned short BytesPerPixel;
+  unsigned int Width;                     // pixels per line
+  unsigned int Height;                    // lines, 1 for a line sensor
+  unsigned int FrameNumber;               // the frame that the image belongs to
+  unsigned int Size;                      // Width * Height * BytesPerPixel
+  const unsigned char* Pixels;            // row by row, little-endian pixels
+};
+
+//----------------------------------------------------------------------------
+// The spots that one sensor sees in a BX2 reply, see ndiGetBX2UV().  As for
+// images, the spots point into the reply and are valid until the next command.
+struct ndiBX2UV
+{
+  unsigned short Sensor;                  // the sensor that saw the spots
+  unsigned short SpotCount;
+  const unsigned char* Spots;             // U, V and brightness floats for each spot, unaligned, see ndiGetBX2UVSpot()
+};
+
 //----------------------------------------------------------------------------
 // Structure for holding ndicapi data.
 struct ndicapi
@@ -69,8 +141,18 @@ struct ndicapi
   int Port;                               // socket port
   int SocketErrorCode;                    // error code (zero if no error)
 
+  const ndiTransport* Transport;          // moves the bytes, see ndiOpenTransport()
+  char* TransportAddress;                 // as given to Transport->Open(), for a reconnect
+  void* TransportData;                    // for the transport's own use
+  bool IsTransportOpen;
+
   char* Command;                          // text sent to the ndicapi
   char* Reply;                            // reply from the ndicapi
+  int ReplySize;                          // grows to fit long binary replies
+  char* Receive;                          // bytes received but not yet read as a reply
+  int ReceiveSize;
+  int ReceiveStart;                       // the first byte that has not been read
+  int ReceiveLength;                      // the number of bytes from ReceiveStart
 
   // this is set to true during tracking mode
   bool IsTracking;
@@ -83,12 +165,31 @@ struct ndicapi
   NDIEvent ThreadBufferEvent;             // for when buffer is updated
   char* ThreadCommand;                    // last command sent from thread
   char* ThreadReply;                      // reply from the ndicapi
+  int ThreadReplySize;
   char* ThreadBuffer;                     // buffer for previous reply
+  int ThreadBufferSize;
+  int ThreadBufferLength;                 // number of bytes in the buffer
   bool IsThreadedCommandBinary;           // cache whether we're sending BX (true) or TX/GX (false)
   int ThreadErrorCode;                    // error code to go with buffer
 
+  // session recovery, see ndiSetReconnectMode()
+  bool IsReconnectMode;
+  bool IsReconnecting;                    // set while the session is replayed
+  char* SessionLog;                       // configuration commands since the last INIT
+  int SessionLogSize;
+  int SessionLogLength;
+  char SessionTrackingCommand[32];        // the last TSTART command
+  int ReconnectCount;
+  int ReconnectOutageMs;                  // how long the last outage lasted
+  void (*ReconnectCallback)(ndicapi* pol, bool reconnected, int outageMs, void* data);
+  void* ReconnectCallbackData;
+
+  // device-pushed replies, see ndiStartStreaming()
+  ndiStreaming* Streaming;                // NULL unless a stream is running
+
   // command reply -- this is the return value from plCommand()
   char* ReplyNoCRC;                     // reply without CRC and <CR>
+  int ReplyNoCRCSize;
 
   // error handling information
   int ErrorCode;                          // error code (zero if no error)
@@ -162,48 +263,86 @@ struct ndicapi
   char TxPassiveStrayOov[14];
   char TxPassiveStray[1052];
 
-  // BX command reply data
+  // BX command reply data, allocated from BxArena for each reply
+  ndiArena* BxArena;
   unsigned short BxReplyLength;
   unsigned char BxHandleCount;
-  char BxHandles[NDI_MAX_HANDLES];
-  char BxHandlesStatus[NDI_MAX_HANDLES];
-  unsigned int BxFrameNumber[NDI_MAX_HANDLES];
-  float BxTransforms[NDI_MAX_HANDLES][8];
-  int BxPortStatus[NDI_MAX_HANDLES];
-  char BxToolMarkerInformation[NDI_MAX_HANDLES][11];
+  char* BxHandles;
+  char* BxHandlesStatus;
+  unsigned int* BxFrameNumber;
+  float (*BxTransforms)[8];
+  int* BxPortStatus;
+  char (*BxToolMarkerInformation)[11];
 
-  char BxActiveSingleStrayMarkerStatus[NDI_MAX_HANDLES];
-  float BxActiveSingleStrayMarkerPosition[NDI_MAX_HANDLES][3];
+  char* BxActiveSingleStrayMarkerStatus;
+  float (*BxActiveSingleStrayMarkerPosition)[3];
 
-  char Bx3DMarkerCount[NDI_MAX_HANDLES];
-  char Bx3DMarkerOutOfVolume[NDI_MAX_HANDLES][3]; // 3 bytes holds 1 bit entries for up to 24 markers (but 20 is max)
-  float Bx3DMarkerPosition[NDI_MAX_HANDLES][20][3]; // a tool can have up to 20 markers
+  unsigned char* Bx3DMarkerCount;
+  char** Bx3DMarkerOutOfVolume;           // 1 bit per marker, for each handle
+  float (**Bx3DMarkerPosition)[3];        // marker positions, for each handle
 
   int BxPassiveStrayCount;
-  char BxPassiveStrayOutOfVolume[30]; // 30 bytes holds 1 bit entries for up to 240 markers
-  float BxPassiveStrayPosition[240][3]; // hold up to 240 stray markers
+  char* BxPassiveStrayOutOfVolume;        // 1 bit per marker
+  float (*BxPassiveStrayPosition)[3];
 
   int BxSystemStatus;
 
-  // BX2 command reply data
+  // BX2 command reply data, allocated from Bx2Arena for each reply
+  ndiArena* Bx2Arena;
   unsigned short Bx2GBFVersion;
   unsigned short Bx2ComponentCount;
   unsigned int Bx2ReplyLength;
   unsigned char Bx2FrameType;
   unsigned int Bx2FrameNumber;
-  float Bx2Transforms[NDI_MAX_HANDLES][8];
   unsigned char Bx2FrameSequenceIndex;
   unsigned char Bx2Timestamp[8];
+
   unsigned int Bx2HandleCount;
-  unsigned short Bx2Handles[NDI_MAX_HANDLES];
-  unsigned short Bx2HandlesStatus[NDI_MAX_HANDLES];
-  bool Bx2HandleAveragingEnabled[NDI_MAX_HANDLES];
-  unsigned short Bx2SystemAlerts[256][2]; // Type and value together
-  unsigned int Bx2SystemAlertsCount;
+  unsigned short* Bx2Handles;
+  unsigned short* Bx2HandlesStatus;
+  bool* Bx2HandleAveragingEnabled;
+  float (*Bx2Transforms)[8];
 
-  unsigned short Bx2_3DMarkerCount[NDI_MAX_HANDLES];
-  char Bx2_3DMarkerStatus[NDI_MAX_HANDLES][20];
-  float Bx2_3DMarkerPosition[NDI_MAX_HANDLES][20][3]; // a tool can have up to 20 markers
+  unsigned int Bx2SystemAlertsCount;
+  unsigned short (*Bx2SystemAlerts)[2];   // Type and value together
+
+  unsigned int Bx2_3DCount;               // number of 3D items (one per tool, plus strays)
+  unsigned short* Bx2_3DHandles;          // tool handle, or 0xffff for stray 3Ds
+  unsigned short* Bx2_3DMarkerCount;
+  char** Bx2_3DMarkerStatus;              // marker status, for each item
+  float (**Bx2_3DMarkerPosition)[3];      // marker positions, for each item
+
+  unsigned int Bx2_1DCount;               // number of tools that reported buttons
+  unsigned short* Bx2_1DHandles;
+  unsigned short* Bx2_1DButtonCount;
+  unsigned char** Bx2_1DButtons;          // button states, for each tool
+
+  unsigned int Bx2ImageCount;             // one image per sensor
+  ndiBX2Image* Bx2Images;                 // the pixels are in the reply
+  unsigned int Bx2UVCount;                // one item per sensor
+  ndiBX2UV* Bx2UVs;                       // the spots are in the reply
+
+  // BX2 decoding options, see ndiSetBX2DecodeMask() and ndiSetBX2LazyDecoding()
+  unsigned int Bx2DecodeMask;             // NDI_BX2_DECODE_xxx bits requested by the caller
+  bool Bx2LazyDecoding;
+  unsigned int Bx2PendingComponents;      // components that have not been decoded yet
+  unsigned int Bx2PresentComponents;      // components in the reply, decoded or not
+  ndiBX2Component* Bx2Components;         // allocated from Bx2Arena
+
+  // frame components of the BX2 reply, see ndiSelectBX2Frame()
+  unsigned int Bx2FrameCount;
+  ndiBX2Frame* Bx2Frames;                 // allocated from Bx2Arena, in reply order
+  ndiBX2Frame* Bx2SelectedFrame;          // the frame that the Bx2 members above describe
+  ndiBX2Stream* Bx2Streams;               // one per frame type, see ndiAddBX2StreamCallback()
+  ndiBX2AlertState* Bx2AlertState;        // active alerts and queued edges, see ndiPollAlertEvent()
+  ndiBX2ButtonState* Bx2ButtonState;      // pressed buttons and queued edges, see ndiPollButtonEvent()
+  ndiBX2ImageRing* Bx2ImageRing;          // copies of recent images, see ndiSetBX2ImageRing()
+
+  // tracking data for ndiGetFrame(), built from the reply on first access
+  int FrameSource;                        // NDI_FRAME_xxx of the latest tracking reply
+  bool FrameIsBuilt;
+  ndiArena* FrameArena;
+  ndiFrame* Frame;                        // allocated from FrameArena, apart from the state above
 };
 
 typedef struct ndicapi ndicapi;
@@ -255,6 +394,55 @@ ndicapiExport const char* ndiSerialDeviceName(int i);
 */
 ndicapiExport int ndiSerialProbe(const char* device, bool checkDSR);
 
+//----------------------------------------------------------------------------
+// An NDI device that was found by ndiSerialProbeAll()
+#define NDI_PROBE_MAX_PORTS 64
+
+struct ndiSerialProbeResult
+{
+  char Device[256];                       // the serial port device name, for ndiOpenSerial()
+  int Baud;                               // the baud rate that the device answered at
+  char Firmware[256];                     // the reply to GETINFO:Features.Firmware.Version, or VER:0
+};
+
+/*! \ingroup NDIMethods
+  Probe all of the serial ports for NDI devices at once.  On linux the
+  ports are those in /dev/serial/by-id and the ttyUSB, ttyACM and ttyS
+  ports in sysfs, elsewhere they are those of ndiSerialDeviceName().  Each
+  port is probed as by ndiSerialProbe() in a thread of its own, with
+  shorter waits, so the ports with nothing on them do not add up.
+
+  The port and baud rate of the last device that was found are kept in a
+  file, see ndiSetSerialProbeCache(), as are those of the last device that
+  was sent a COMM command if the file was set.
+  That port is probed first, and at that baud rate before 9600, so that a
+  device that was left at a higher baud rate answers without a reset.  If
+  only one device is wanted and it is found there, the other ports are not
+  probed at all.
+
+  \param results       array for the devices that are found
+  \param maxResults    size of the array
+  \param checkDSR      whether or not to perform a DSR check
+  \param milliseconds  how long a device is given to answer a serial break,
+                       the other waits are shorter
+
+  \return the number of devices found, the one in the cache first
+*/
+ndicapiExport int ndiSerialProbeAll(ndiSerialProbeResult* results, int maxResults, bool checkDSR, int milliseconds);
+
+/*! \ingroup NDIMethods
+  Set the file in which ndiSerialProbeAll() keeps the last known good port
+  and baud rate, or NULL for none.  The default is ndicapi-serial-probe in
+  $XDG_CACHE_HOME or ~/.cache, or in %LOCALAPPDATA% on Windows.
+
+  The default file is only written by ndiSerialProbeAll().  Once a file
+  has been set, the baud rate of each COMM command that is sent to a
+  serial device is also written to it, so that a device that was left at
+  that baud rate is found without a reset.  A probe that is already
+  running keeps using the file that it started with.
+*/
+ndicapiExport void ndiSetSerialProbeCache(const char* filename);
+
 /*! \ingroup NDIMethods
   Open communication with the NDI device on the specified
   serial port device.  This also sets the serial port parameters to
@@ -279,6 +467,41 @@ network host and port.
 */
 ndicapiExport ndicapi* ndiOpenNetwork(const char* hostname, int port);
 
+/*! \ingroup NDIMethods
+Open communication with the NDI device on the specified network host
+and port, and give up if it has not answered within the given time.
+ndiOpenNetwork() waits for NDI_CONNECT_TIMEOUT_MS.
+
+\param hostname URL or IPv4/IPv6 address of the NDI device
+\param port Port of the NDI device
+\param timeoutMs the time to wait for the connection, or 0 to wait as long as the system does
+
+\return a handle for the device, or NULL if it could not be reached
+
+*/
+ndicapiExport ndicapi* ndiOpenNetworkTimeout(const char* hostname, int port, int timeoutMs);
+
+/*! \ingroup NDIMethods
+Open communication with an NDI device through a transport that was
+registered with ndiRegisterTransport(), or through one of the built-in
+"serial" and "tcp" transports.
+
+\param name     the name of the transport
+\param address  where the device is, in the form that the transport expects
+\param userdata the initial value of pol->TransportData
+
+\return a handle for the device, or NULL if the transport could not be opened
+
+ndiOpenTransport("serial", device, NULL) is the same as ndiOpenSerial(device).
+The handle must be closed with ndiCloseTransport().
+*/
+ndicapiExport ndicapi* ndiOpenTransport(const char* name, const char* address, void* userdata);
+
+/*! \ingroup NDIMethods
+Close communication with the NDI device, whatever the transport.
+*/
+ndicapiExport void ndiCloseTransport(ndicapi* pol);
+
 /*! \ingroup NDIMethods
   Close communication with the NDI device.  You should send
   a "COMM:00000" command before you close communication so that you
@@ -321,6 +544,92 @@ ndicapiExport void ndiCloseNetwork(ndicapi* pol);
 */
 ndicapiExport void ndiSetThreadMode(ndicapi* pol, bool mode);
 
+/*! \ingroup NDIMethods
+  Reconnect callback type for use with ndiSetReconnectCallback().
+*/
+typedef void (*NDIReconnectCallback)(ndicapi* pol, bool reconnected, int outageMs, void* userdata);
+
+/*! \ingroup NDIMethods
+  Restore the session automatically when the link to the device is lost.
+
+  \param pol    valid NDI device handle
+  \param mode   true to reconnect after a read or write error
+
+  The configuration commands that the device accepts (INIT, COMM, PHRQ,
+  PVWR, PINIT, PENA, PHF, TSTART and a few others) are recorded, starting
+  again at each INIT.  When a command or the tracking thread gets a read or
+  write error, the serial port or socket is opened again, a serial device
+  is reset with a break, and the recorded commands are replayed.  If the
+  device was tracking, TSTART is sent and the tracking thread carries on
+  with its command.  A command that failed is sent once more after the
+  session has been restored.
+
+  Attempts are repeated with a growing delay for up to 30 seconds.  Port
+  handles are only the same as before if the device gives them out in the
+  same order, which it does when the same commands are replayed.
+*/
+ndicapiExport void ndiSetReconnectMode(ndicapi* pol, bool mode);
+
+/*! \ingroup NDIMethods
+  Set a function that will be called after each attempt to restore the
+  session, with whether it succeeded and how long the link was down.
+
+  The callback is called by the tracking thread if the thread lost the link.
+  The thread holds the link while it calls back, so the callback must not
+  send commands to the device.  A thread that gives up sets no error code
+  and calls no error callback, the next tracking command reports the error.
+  The callback can be set to NULL to erase a previous callback.
+*/
+ndicapiExport void ndiSetReconnectCallback(ndicapi* pol, NDIReconnectCallback callback, void* userdata);
+
+/*! \ingroup NDIMethods
+  Decode the components of a BX2 reply only when they are needed.
+
+  \param pol   valid NDI device handle
+  \param mode  true to decode on demand, false to decode every reply in full
+
+  When lazy decoding is on, the BX2 reply is only scanned and checked when
+  it arrives.  Each component (6D, 3D, system alerts, ...) is decoded the
+  first time that one of the ndiGetBX2() functions asks for it, and the
+  result is kept until the next BX2 reply.  This saves time when the reply
+  options request components that are only looked at occasionally.
+
+  When lazy decoding is on, the Bx2 members of the ndicapi structure are
+  only valid after the matching ndiGetBX2() function has been called.
+
+  Because the first ndiGetBX2() call for a component writes the decoded
+  data into the ndicapi structure, the getters are not thread safe in this
+  mode: call them from the thread that sends the commands, or serialize
+  them with ndiCommand() and with each other.  The tracking thread never
+  decodes replies, so it does not need to be taken into account.
+*/
+ndicapiExport void ndiSetBX2LazyDecoding(ndicapi* pol, bool mode);
+
+/*! \ingroup NDIMethods
+  Select which BX2 reply components are decoded.
+
+  \param pol   valid NDI device handle
+  \param mask  a bitwise OR of the following values:
+  - NDI_BX2_DECODE_6D         0x0001
+  - NDI_BX2_DECODE_3D         0x0002
+  - NDI_BX2_DECODE_1D         0x0004
+  - NDI_BX2_DECODE_2D         0x0008
+  - NDI_BX2_DECODE_LINE_SEP   0x0010
+  - NDI_BX2_DECODE_3D_ERROR   0x0020
+  - NDI_BX2_DECODE_IMAGE      0x0040
+  - NDI_BX2_DECODE_UV         0x0080
+  - NDI_BX2_DECODE_SYS_ALERT  0x0100
+  - NDI_BX2_DECODE_ALL        0x01FF - the default
+
+  Components that are not in the mask are skipped over without their
+  payload being read, and the corresponding ndiGetBX2() functions report
+  nothing for them.  This is useful when the BX2 reply options are chosen
+  for some other purpose, but the application only needs e.g. the 6D data.
+  The frame headers are always decoded.
+*/
+ndicapiExport void ndiSetBX2DecodeMask(ndicapi* pol, unsigned int mask);
+ndicapiExport unsigned int ndiGetBX2DecodeMask(ndicapi* pol);
+
 /*! \ingroup NDIMethods
   Send a command to the device using a printf-style format string.
 
@@ -373,6 +682,240 @@ ndicapiExport char* ndiCommand(ndicapi* pol, const char* format, ...);
 */
 ndicapiExport char* ndiCommandVA(ndicapi* pol, const char* format, va_list ap);
 
+/*! \ingroup NDIMethods
+  Space for a command encoded by the ndiEncode functions, including
+  the CRC and the carriage return.
+*/
+#define NDI_ENCODED_COMMAND_SIZE 256
+
+/*! \ingroup NDIMethods
+  A command that is ready to be sent to the device.
+
+  The ndiEncode functions write the mnemonic, the arguments, the CRC and
+  the final carriage return into the structure in a single pass, without
+  any allocation or printf-style formatting.  A command that is sent
+  repeatedly, such as the BX2 or TX command during tracking, can be
+  encoded once and then sent as often as needed with ndiCommandEncoded().
+*/
+struct ndiEncodedCommand
+{
+  char Text[NDI_ENCODED_COMMAND_SIZE];    // terminated command text
+  int Length;                             // bytes in Text, or -1 if the command did not fit
+  int MnemonicLength;
+  unsigned int MnemonicHash;
+  unsigned short CRC;                     // CRC of the text so far
+  bool UseCRC;                            // true if the mnemonic was followed by ':'
+};
+
+/*! \ingroup NDIMethods
+  Send a command that was prepared with the ndiEncode functions.
+
+  \param pol      valid NDI device handle
+  \param command  a command that has been completed with ndiEncodeEnd()
+
+  \return         the text reply from the device with the
+                  CRC chopped off
+
+  This behaves exactly like ndiCommand(), except that the command text is
+  sent as-is.  If the command could not be encoded, the error is set to
+  NDI_COMMAND_TOO_LONG and nothing is sent.
+*/
+ndicapiExport char* ndiCommandEncoded(ndicapi* pol, const ndiEncodedCommand* command);
+
+/*! \ingroup NDIMethods
+  Stream callback type for use with ndiCommandStream().  It is given the
+  next piece of the reply data, the number of data bytes received so far
+  (including this piece) and the total for the reply, and returns zero to
+  keep going or nonzero to stop.
+*/
+typedef int (*NDIStreamCallback)(const char* data, int length, unsigned int received, unsigned int total, void* userdata);
+
+/*! \ingroup NDIMethods
+  Send a command with a binary reply, such as GETLOG or VGET, and pass
+  the reply to a callback as it arrives.
+
+  \param pol       valid NDI device handle
+  \param command   a command that has been completed with ndiEncodeEnd()
+  \param callback  receives the reply data a piece at a time, see
+                   NDIStreamCallback, ndiStreamToFile() and ndiStreamToBuffer()
+  \param userdata  data to send to the callback each time it is called
+
+  \return NDI_OKAY, or the error code, which is also set as for ndiCommand()
+
+  The header and the CRC are checked but are not passed to the callback.
+  The reply goes through the reply buffer a piece at a time, so a reply
+  of any length can be received without being held in memory, and the
+  buffer is not grown for it.  The data is only complete and correct if
+  the return value is NDI_OKAY: a bad CRC can only be seen at the end.
+  If the callback stops the transfer, the rest of the reply is read and
+  thrown away, and NDI_STREAM_STOPPED is returned.
+
+  In threaded mode the tracking thread waits while the reply is being
+  received, because the device answers one command at a time.  A long
+  transfer can be split into several commands, such as GETLOG with an
+  offset and a length, to let tracking replies through in between.
+*/
+ndicapiExport int ndiCommandStream(ndicapi* pol, const ndiEncodedCommand* command, NDIStreamCallback callback, void* userdata);
+
+/*! \ingroup NDIMethods
+  A stream callback that writes the reply data to a file.  The userdata
+  for ndiCommandStream() must be the FILE pointer.  The transfer is
+  stopped if the data cannot be written.
+*/
+ndicapiExport int ndiStreamToFile(const char* data, int length, unsigned int received, unsigned int total, void* userdata);
+
+/*! \ingroup NDIMethods
+  Caller-provided memory for ndiStreamToBuffer().
+*/
+struct ndiStreamBuffer
+{
+  char* Data;
+  unsigned int Size;                      // space at Data
+  unsigned int Length;                    // bytes written so far, set to zero before the command
+};
+
+/*! \ingroup NDIMethods
+  A stream callback that copies the reply data to memory.  The userdata
+  for ndiCommandStream() must point to an ndiStreamBuffer.  The transfer
+  is stopped if the reply does not fit.
+*/
+ndicapiExport int ndiStreamToBuffer(const char* data, int length, unsigned int received, unsigned int total, void* userdata);
+
+/*! \ingroup NDIMethods
+  Have the device send the replies to a tracking command by itself, at
+  its own frame rate, instead of answering the command each time it is sent.
+
+  \param pol       valid NDI device handle
+  \param command   the command to stream, such as BX2 or TX, completed
+                   with ndiEncodeEnd()
+  \param streamId  a name for the stream, which is given to the device
+
+  \return NDI_OKAY, or the error code, which is also set as for ndiCommand()
+
+  The device is sent STREAM --id=streamId --cmd="command" and, once it
+  has agreed, pushes one reply after another.  The replies are framed as
+  the replies to the command itself, and are passed to the helper for the
+  command, so that ndiGetBX2Transform() and the like work as usual.
+
+  Without the tracking thread, each reply is read by ndiReadStreamedReply().
+  In threaded mode the thread reads the replies instead of sending the
+  command, and ndiCommandEncoded() with the same command returns the latest
+  one.  Other commands fail with NDI_STREAMING until ndiStopStreaming() is
+  called, because the replies to them could not be told apart from the
+  stream.  After a reconnect, see ndiSetReconnectMode(), the stream is
+  started again.
+*/
+ndicapiExport int ndiStartStreaming(ndicapi* pol, const ndiEncodedCommand* command, const char* streamId);
+
+/*! \ingroup NDIMethods
+  Wait for the next reply of the stream that was started by
+  ndiStartStreaming(), and pass it to the helper for the streamed command.
+
+  \return the reply without its CRC, as for ndiCommand()
+
+  This fails with NDI_STREAMING if no stream is running, or if the tracking
+  thread is reading the stream.
+*/
+ndicapiExport char* ndiReadStreamedReply(ndicapi* pol);
+
+/*! \ingroup NDIMethods
+  Stop the stream that was started by ndiStartStreaming().
+
+  \return NDI_OKAY, or the error code, which is also set as for ndiCommand()
+
+  The device is sent USTREAM --id=streamId, and the replies that it pushed
+  before it stopped are read and thrown away, up to the reply to USTREAM.
+  Nothing is sent if no stream is running.
+*/
+ndicapiExport int ndiStopStreaming(ndicapi* pol);
+
+/*! \ingroup NDIMethods
+  Start encoding a command.
+
+  \param command    the structure to write the command into
+  \param mnemonic   the command name, e.g. "TX" or "BX2"
+  \param separator  ':' for commands that carry a CRC, ' ' for commands
+                    with space-separated arguments, or 0 for none
+
+  The ndiEncode functions never write past the end of command->Text.
+  If the command does not fit, command->Length is set to -1 and all
+  further ndiEncode calls on it are ignored.
+*/
+ndicapiExport void ndiEncodeBegin(ndiEncodedCommand* command, const char* mnemonic, char separator);
+
+/*! \ingroup NDIMethods
+  Append a value as a fixed number of upper-case hexadecimal digits,
+  as printf "%0*X" would.
+*/
+ndicapiExport void ndiEncodeHex(ndiEncodedCommand* command, unsigned long value, int digits);
+
+/*! \ingroup NDIMethods
+  Append a non-negative decimal value, zero-padded to at least 'digits'
+  digits, as printf "%0*d" would.
+*/
+ndicapiExport void ndiEncodeDecimal(ndiEncodedCommand* command, unsigned long value, int digits);
+
+/*! \ingroup NDIMethods
+  Append a single character.
+*/
+ndicapiExport void ndiEncodeChar(ndiEncodedCommand* command, char c);
+
+/*! \ingroup NDIMethods
+  Append a string.  If width is positive, the string is truncated or
+  padded with spaces to exactly that width, as printf "%-*.*s" would.
+*/
+ndicapiExport void ndiEncodeString(ndiEncodedCommand* command, const char* text, int width);
+
+/*! \ingroup NDIMethods
+  Finish the command by appending the CRC (for commands that use ':')
+  and the carriage return.
+
+  \return the length of the command, or -1 if it did not fit
+*/
+ndicapiExport int ndiEncodeEnd(ndiEncodedCommand* command);
+
+/*! \ingroup NDIMethods
+  Encode a complete GX, TX or BX command with the given reply mode,
+  see ndiGX(), ndiTX() and ndiBX().
+
+  \return the length of the command, or -1 if it did not fit
+*/
+ndicapiExport int ndiEncodeGX(ndiEncodedCommand* command, int mode);
+ndicapiExport int ndiEncodeTX(ndiEncodedCommand* command, int mode);
+ndicapiExport int ndiEncodeBX(ndiEncodedCommand* command, int mode);
+
+/*! \ingroup NDIMethods
+  Reply options for the BX2 command, for use with ndiEncodeBX2().
+
+  Each member is one of the NDI_BX2_REPLY_xxx values.  Options that are
+  left as NDI_BX2_REPLY_DEFAULT are not sent, so the device default is
+  used and the command stays as short as possible.
+  - Reply6D:     NDI_BX2_REPLY_NONE or NDI_BX2_REPLY_TOOLS (device default)
+  - Reply3D:     NDI_BX2_REPLY_NONE (device default), _TOOLS, _STRAYS or _ALL
+  - Reply2D:     NDI_BX2_REPLY_NONE (device default), _TOOLS, _STRAYS or _ALL
+  - ReplySensor: NDI_BX2_REPLY_NONE (device default), _TOOLS, _STRAYS or _ALL
+  - Reply1D:     NDI_BX2_REPLY_NONE or NDI_BX2_REPLY_BUTTONS (device default)
+*/
+struct ndiBX2Options
+{
+  int Reply6D;
+  int Reply3D;
+  int Reply2D;
+  int ReplySensor;
+  int Reply1D;
+};
+
+/*! \ingroup NDIMethods
+  Encode a complete BX2 command from a set of reply options.
+
+  \param command  the structure to write the command into
+  \param options  the reply options, or NULL for the device defaults
+
+  \return the length of the command, or -1 if an option is not valid
+          for its component
+*/
+ndicapiExport int ndiEncodeBX2(ndiEncodedCommand* command, const ndiBX2Options* options);
+
 /*! \ingroup NDIMethods
   Error callback type for use with ndiSetErrorCallback().
 */
@@ -399,12 +942,23 @@ Log current state of NDICAPI to string
 ndicapiExport void ndiLogState(ndicapi* pol, char outInformation[USHRT_MAX]);
 
 /*! \ingroup NDIMethods
-Set the socket timeout
+Set the timeout of the transport, which is the socket for a device on
+the network
 
 \param timeoutMsec the timeout in milliseconds
 */
 ndicapiExport void ndiTimeoutSocket(ndicapi* pol, int timeoutMsec);
 
+/*! \ingroup NDIMethods
+Turn low-latency mode on or off for the serial port, see ndiSerialLowLatency().
+This is worthwhile for USB-serial adapters, which otherwise hold back each
+reply for several milliseconds.
+
+\return 0 if successful, or -1 if the transport has no low-latency mode,
+e.g. because it is not a serial port, or if the port does not support it
+*/
+ndicapiExport int ndiSetSerialLowLatency(ndicapi* pol, bool enable);
+
 /*=====================================================================*/
 /*! \defgroup NDIMacros Command Macros
   These are a set of macros that send commands to the device via
@@ -920,6 +1474,17 @@ ndicapiExport int ndiGetPort(ndicapi* pol);
 */
 ndicapiExport int ndiGetThreadMode(ndicapi* pol);
 
+/*! \ingroup GetMethods
+  Get the number of times that the session was restored, see ndiSetReconnectMode().
+*/
+ndicapiExport int ndiGetReconnectCount(ndicapi* pol);
+
+/*! \ingroup GetMethods
+  Get how long the link was down before the last time the session was
+  restored, in milliseconds.
+*/
+ndicapiExport int ndiGetReconnectOutage(ndicapi* pol);
+
 /*! \ingroup GetMethods
   Get the current error callback function, or NULL if there is none.
 */
@@ -1705,6 +2270,269 @@ This information is updated each time that the BX2 command is sent to the device
 */
 ndicapiExport unsigned int ndiGetBX2Frame(ndicapi * pol);
 
+/*! \ingroup GetMethods
+Get the number of frames in the latest BX2 reply.
+
+\param pol       valid NDI device handle
+
+\return the number of frame components, or zero if the reply had none
+
+<p>A single BX2 reply can hold several frames, for example a passive frame
+and an active wireless frame, or several frames of the same type when the
+device has measured more than one frame since the previous BX2 command.
+All of them are kept, and ndiSelectBX2Frame() chooses which one the
+other ndiGetBX2() functions report.  After each reply the last frame in
+the reply is selected.
+*/
+ndicapiExport int ndiGetBX2FrameCount(ndicapi* pol);
+
+/*! \ingroup GetMethods
+Choose which frame of the latest BX2 reply is reported by the other
+ndiGetBX2() functions and by ndiGetFrame().
+
+\param pol       valid NDI device handle
+\param index     a number between 0 and ndiGetBX2FrameCount() - 1
+
+\return NDI_OKAY, or NDI_DISABLED if there is no such frame
+*/
+ndicapiExport int ndiSelectBX2Frame(ndicapi* pol, int index);
+
+/*! \ingroup GetMethods
+Get the type of the selected BX2 frame.
+
+\param pol       valid NDI device handle
+
+\return one of the following:
+- NDI_BX2_FRAME_DUMMY            0
+- NDI_BX2_FRAME_ACTIVE_WIRELESS  1
+- NDI_BX2_FRAME_PASSIVE          2
+- NDI_BX2_FRAME_ACTIVE           3
+- NDI_BX2_FRAME_LASER            4
+- NDI_BX2_FRAME_ILLUMINATED      5
+- NDI_BX2_FRAME_BACKGROUND       6
+- NDI_BX2_FRAME_MAGNETIC         7
+*/
+ndicapiExport int ndiGetBX2FrameType(ndicapi* pol);
+
+/*! \ingroup GetMethods
+Get the sequence index of the selected BX2 frame.
+*/
+ndicapiExport int ndiGetBX2FrameSequenceIndex(ndicapi* pol);
+
+/*! \ingroup GetMethods
+Get the timestamp of the selected BX2 frame.
+
+\param pol          valid NDI device handle
+\param seconds      seconds since the start of the Unix epoch
+\param nanoseconds  nanoseconds within the second
+*/
+ndicapiExport void ndiGetBX2Timestamp(ndicapi* pol, unsigned int* seconds, unsigned int* nanoseconds);
+
+/*! \ingroup GetMethods
+  Statistics for the stream of BX2 frames of one frame type, see
+  ndiGetBX2StreamStats().
+*/
+struct ndiBX2StreamStats
+{
+  unsigned int FrameCount;                // frames received since the stream was reset
+  unsigned int LastFrameNumber;
+  unsigned int LastTimestampSeconds;
+  unsigned int LastTimestampNanoseconds;
+  double FrameRate;                       // frames per second, from the device timestamps
+};
+
+/*! \ingroup GetMethods
+  Stream callback type for use with ndiAddBX2StreamCallback().
+*/
+typedef void (*NDIBX2StreamCallback)(ndicapi* pol, int frameType, void* userdata);
+
+/*! \ingroup GetMethods
+  Call a function for each BX2 frame of the given type.
+
+  \param pol        valid NDI device handle
+  \param frameType  one of the NDI_BX2_FRAME_xxx types
+  \param callback   a callback with the following signature:\n
+    void callback(ndicapi *pol, int frameType, void *userdata)
+  \param userdata   data to send to the callback each time it is called
+
+  \return NDI_OKAY, or NDI_DISABLED if the frame type is not valid
+
+  The frames of each BX2 reply are split into one stream per frame type,
+  so that e.g. passive and active wireless tools can each be consumed at
+  their own rate.  The callbacks are called from within ndiCommand(), once
+  for each frame in reply order, with that frame selected so that the
+  ndiGetBX2() functions and ndiGetFrame() report it.  The callbacks must
+  not send commands to the device.
+*/
+ndicapiExport int ndiAddBX2StreamCallback(ndicapi* pol, int frameType, NDIBX2StreamCallback callback, void* userdata);
+
+/*! \ingroup GetMethods
+  Remove a callback that was added with ndiAddBX2StreamCallback().
+*/
+ndicapiExport int ndiRemoveBX2StreamCallback(ndicapi* pol, int frameType, NDIBX2StreamCallback callback, void* userdata);
+
+/*! \ingroup GetMethods
+  Keep the most recent BX2 frames of the given type.
+
+  \param pol        valid NDI device handle
+  \param frameType  one of the NDI_BX2_FRAME_xxx types
+  \param depth      the number of frames to keep, or zero to keep none
+
+  \return NDI_OKAY, or NDI_DISABLED if the frame type is not valid
+
+  The history is empty until it is enabled, because each frame that is
+  kept has to be copied out of the reply.  Changing the depth clears it.
+*/
+ndicapiExport int ndiSetBX2StreamHistory(ndicapi* pol, int frameType, int depth);
+
+/*! \ingroup GetMethods
+  Get a frame from the history of a BX2 stream.
+
+  \param pol        valid NDI device handle
+  \param frameType  one of the NDI_BX2_FRAME_xxx types
+  \param age        zero for the most recent frame, one for the frame before it, ...
+
+  \return the frame, or NULL if the history does not go back that far
+
+  The frame stays valid until the stream has received \em depth more frames.
+*/
+ndicapiExport const ndiFrame* ndiGetBX2StreamFrame(ndicapi* pol, int frameType, int age);
+
+/*! \ingroup GetMethods
+  Get the frame count and frame rate of a BX2 stream.
+
+  \return NDI_OKAY, or NDI_DISABLED if the frame type is not valid
+*/
+ndicapiExport int ndiGetBX2StreamStats(ndicapi* pol, int frameType, ndiBX2StreamStats* stats);
+
+/*! \ingroup GetMethods
+  Clear the statistics and the history of a BX2 stream.
+*/
+ndicapiExport void ndiResetBX2Stream(ndicapi* pol, int frameType);
+
+/*! \ingroup GetMethods
+  A change in the system alerts reported by BX2, see ndiPollAlertEvent().
+*/
+struct ndiAlertEvent
+{
+  int Onset;                              // 1 when the condition appeared, 0 when it cleared
+  unsigned short Type;                    // NDI_SYS_ALERT_FAULT, NDI_SYS_ALERT_ALERT or NDI_SYS_ALERT_EVENT
+  unsigned short Code;                    // the condition code
+  unsigned int FrameNumber;               // the frame in which the change was seen
+  unsigned int TimestampSeconds;
+  unsigned int TimestampNanoseconds;
+};
+
+/*! \ingroup GetMethods
+  Alert callback type for use with ndiSetAlertCallback().
+*/
+typedef void (*NDIAlertCallback)(const ndiAlertEvent* event, void* userdata);
+
+/*! \ingroup GetMethods
+  Get the next change in the BX2 system alerts.
+
+  \param pol    valid NDI device handle
+  \param event  the structure to write the change into
+
+  \return 1 if an event was returned, or 0 if there are no more events
+
+  Each BX2 frame is compared with the frame before it, and a condition is
+  reported once when it first appears (Onset = 1) and once when it is no
+  longer reported (Onset = 0), no matter how many frames it lasts for.
+  Conditions of type NDI_SYS_ALERT_EVENT have no clear edge.  The queue
+  holds the 64 most recent changes; older ones are dropped if they are not
+  polled in time, see ndiGetAlertEventsDropped().
+
+  Alerts are only tracked once the application has asked for them, by the
+  first call to this function or to ndiSetAlertCallback(), so that the
+  alerts are neither decoded nor queued for an application that does not
+  use them.  Call this function once before tracking starts to see the
+  changes from the first frame.  Alerts are also only tracked when
+  NDI_BX2_DECODE_SYS_ALERT is in the decode mask, and frames without a
+  system alert component are skipped over, so that they are not taken to
+  have cleared every condition.
+*/
+ndicapiExport int ndiPollAlertEvent(ndicapi* pol, ndiAlertEvent* event);
+
+/*! \ingroup GetMethods
+  Set a function that will be called for each change in the BX2 system
+  alerts, as soon as the frame that holds it has been received.
+
+  \param pol       valid NDI device handle
+  \param callback  a callback with the following signature:\n
+    void callback(const ndiAlertEvent *event, void *userdata)
+  \param userdata  data to send to the callback each time it is called
+
+  The callback is called from within ndiCommand(), and the events are
+  still queued for ndiPollAlertEvent().  The callback can be set to NULL
+  to erase a previous callback.
+*/
+ndicapiExport void ndiSetAlertCallback(ndicapi* pol, NDIAlertCallback callback, void* userdata);
+
+/*! \ingroup GetMethods
+  Get the number of alert events that were dropped because the queue was full.
+*/
+ndicapiExport unsigned int ndiGetAlertEventsDropped(ndicapi* pol);
+
+/*! \ingroup GetMethods
+  A tool button that was pressed or released, see ndiPollButtonEvent().
+*/
+struct ndiButtonEvent
+{
+  int Pressed;                            // 1 for a press, 0 for a release
+  unsigned short Handle;                  // the tool that the button belongs to
+  unsigned short Button;                  // the button number on the tool
+  unsigned int FrameNumber;               // the frame in which the change was seen
+  unsigned int TimestampSeconds;
+  unsigned int TimestampNanoseconds;
+};
+
+/*! \ingroup GetMethods
+  Button callback type for use with ndiSetButtonCallback().
+*/
+typedef void (*NDIButtonCallback)(const ndiButtonEvent* event, void* userdata);
+
+/*! \ingroup GetMethods
+  Get the next tool button press or release from the BX2 replies.
+
+  \param pol    valid NDI device handle
+  \param event  the structure to write the press or release into
+
+  \return 1 if an event was returned, or 0 if there are no more events
+
+  Each BX2 frame that reports buttons is compared with the previous one
+  that did, so a press or release is reported once, on the frame where it
+  happened.  Frames without buttons, such as passive frames, are ignored.
+  A button that was held down is released when its tool stops reporting
+  it.  The button events are kept apart from the tracking data and from
+  the alert events.  The queue holds the 64 most recent events.
+
+  As for the alerts, buttons are only tracked from the first call to this
+  function or to ndiSetButtonCallback().
+*/
+ndicapiExport int ndiPollButtonEvent(ndicapi* pol, ndiButtonEvent* event);
+
+/*! \ingroup GetMethods
+  Set a function that will be called for each tool button press or release,
+  as soon as the frame that holds it has been received.
+
+  \param pol       valid NDI device handle
+  \param callback  a callback with the following signature:\n
+    void callback(const ndiButtonEvent *event, void *userdata)
+  \param userdata  data to send to the callback each time it is called
+
+  The callback is called from within ndiCommand(), before the frame is
+  passed to the BX2 streams, and the events are still queued for
+  ndiPollButtonEvent().  The callback can be set to NULL to erase a
+  previous callback.
+*/
+ndicapiExport void ndiSetButtonCallback(ndicapi* pol, NDIButtonCallback callback, void* userdata);
+
+/*! \ingroup GetMethods
+  Get the number of button events that were dropped because the queue was full.
+*/
+ndicapiExport unsigned int ndiGetButtonEventsDropped(ndicapi* pol);
+
 /*! \ingroup GetMethods
 Get the camera frame number for the latest BX2 frame.
 
@@ -1717,6 +2545,165 @@ This information is updated each time that the BX2 command is sent to the device
 */
 ndicapiExport bool ndiGetBX2HandleAveragingEnabled(ndicapi* pol, int portHandle);
 
+/*! \ingroup GetMethods
+Get the number of 3D markers reported for a tool in the latest BX2 reply.
+
+\param pol         valid NDI device handle
+\param portHandle  valid port handle in range 0x01 to 0xFF, or 0xFFFF for stray markers
+
+\return the number of markers, or zero if no 3D data was returned for the handle
+
+<p>3D data is only returned when the BX2 command is sent with the --3d option.
+*/
+ndicapiExport int ndiGetBX2NumberOf3Ds(ndicapi* pol, int portHandle);
+
+/*! \ingroup GetMethods
+Copy the coordinates of a 3D marker from the latest BX2 reply.
+
+\param pol         valid NDI device handle
+\param portHandle  valid port handle in range 0x01 to 0xFF, or 0xFFFF for stray markers
+\param marker      a number between 0 and ndiGetBX2NumberOf3Ds() - 1
+\param coord       array to hold the three coordinates
+
+\return one of the following:
+- NDI_OKAY if successful
+- NDI_DISABLED if there is no such marker in the reply
+- NDI_MISSING if the marker is reported as missing
+
+<p>3D data is only returned when the BX2 command is sent with the --3d option.
+*/
+ndicapiExport int ndiGetBX23D(ndicapi* pol, int portHandle, int marker, float coord[3]);
+
+/*! \ingroup GetMethods
+Get the number of buttons reported for a tool in the latest BX2 reply.
+
+\param pol         valid NDI device handle
+\param portHandle  valid port handle in range 0x01 to 0xFF
+
+\return the number of buttons, or zero if the tool reported none
+
+<p>Buttons are returned unless the BX2 command is sent with --1d=none.
+*/
+ndicapiExport int ndiGetBX2NumberOfButtons(ndicapi* pol, int portHandle);
+
+/*! \ingroup GetMethods
+Check whether a tool button was pressed in the latest BX2 reply.
+
+\param pol         valid NDI device handle
+\param portHandle  valid port handle in range 0x01 to 0xFF
+\param button      a number between 0 and ndiGetBX2NumberOfButtons() - 1
+
+\return 1 if the button is pressed, 0 if it is released or not reported
+*/
+ndicapiExport int ndiGetBX2Button(ndicapi* pol, int portHandle, int button);
+
+/*! \ingroup GetMethods
+Get the number of sensor images in the latest BX2 reply.
+
+\param pol  valid NDI device handle
+
+\return the number of images, usually one per sensor
+
+<p>Images are only returned when the BX2 command asks for them.
+*/
+ndicapiExport int ndiGetBX2NumberOfImages(ndicapi* pol);
+
+/*! \ingroup GetMethods
+Get a sensor image from the latest BX2 reply.
+
+\param pol  valid NDI device handle
+\param i    a number between 0 and ndiGetBX2NumberOfImages() - 1
+
+\return the image, or NULL if there is no such image
+
+<p>The pixels are not copied: they point into the reply buffer, and are
+only valid until the next command is sent.  Use ndiSetBX2ImageRing() to
+keep images for longer.
+
+<p>An image component whose items do not exactly fill it, or that gives
+more than 4 bytes per pixel, makes the reply fail with NDI_BAD_GBF; the
+same goes for UV components, see ndiGetBX2UV().
+*/
+ndicapiExport const ndiBX2Image* ndiGetBX2Image(ndicapi* pol, int i);
+
+/*! \ingroup GetMethods
+Get the number of sensors that reported UV spots in the latest BX2 reply.
+
+\param pol  valid NDI device handle
+
+\return the number of ndiBX2UV items
+*/
+ndicapiExport int ndiGetBX2NumberOfUVs(ndicapi* pol);
+
+/*! \ingroup GetMethods
+Get the UV spots of one sensor from the latest BX2 reply.
+
+\param pol  valid NDI device handle
+\param i    a number between 0 and ndiGetBX2NumberOfUVs() - 1
+
+\return the spots, or NULL if there is no such item
+
+<p>As for images, the spots point into the reply buffer and are only
+valid until the next command is sent.
+*/
+ndicapiExport const ndiBX2UV* ndiGetBX2UV(ndicapi* pol, int i);
+
+/*! \ingroup GetMethods
+Get the position and brightness of one UV spot.
+
+\param uv      the spots of a sensor, from ndiGetBX2UV()
+\param spot    a number between 0 and uv->SpotCount - 1
+\param values  space for U, V and the brightness
+
+\return NDI_OKAY, or NDI_DISABLED if there is no such spot
+*/
+ndicapiExport int ndiGetBX2UVSpot(const ndiBX2UV* uv, int spot, float values[3]);
+
+/*! \ingroup GetMethods
+Keep copies of the most recent BX2 sensor images.
+
+\param pol    valid NDI device handle
+\param depth  number of images to keep, or zero to stop keeping them
+
+\return NDI_OKAY, or NDI_DISABLED if the depth is negative or the ring
+could not be allocated
+
+<p>Each image is copied once, into a pixel buffer that the ring reuses on
+its next lap.  The ring is emptied when the depth is changed.
+*/
+ndicapiExport int ndiSetBX2ImageRing(ndicapi* pol, int depth);
+
+/*! \ingroup GetMethods
+Get an image from the ring set up by ndiSetBX2ImageRing().
+
+\param pol  valid NDI device handle
+\param age  0 for the most recent image, 1 for the one before, and so on
+
+\return the image, or NULL if the ring does not hold that many images
+
+<p>The image is valid until the ring has taken in another \em depth images.
+*/
+ndicapiExport const ndiBX2Image* ndiGetBX2RingImage(ndicapi* pol, int age);
+
+/*! \ingroup GetMethods
+Get the tracking data from the latest GX, TX, BX or BX2 reply.
+
+\param pol    valid NDI device handle
+
+\return a frame that holds the tools, markers and strays of the reply, or
+        NULL if no tracking command has been sent
+
+<p>The frame has the same layout for all four commands, so code that
+consumes it does not have to change when a different tracking command
+is used.  Transforms are always converted to floats, and the status of
+each tool is given as NDI_OKAY, NDI_MISSING or NDI_DISABLED.  Fields that
+a command does not report are zero.
+
+<p>The frame is built on the first call after each reply, and it stays
+valid until the next GX, TX, BX or BX2 command is sent.
+*/
+ndicapiExport const ndiFrame* ndiGetFrame(ndicapi* pol);
+
 
 /*! \ingroup GetMethods
   Get the 8-bit status value for the specified port.
@@ -2105,6 +3092,11 @@ ndicapiExport void* ndiHexDecode(void* data, const char* cp, int n);
 #define NDI_READ_ERROR      0x0105  /*!<\brief Device read error */
 #define NDI_RESET_FAIL      0x0106  /*!<\brief Device failed to reset on break */
 #define NDI_PROBE_FAIL      0x0107  /*!<\brief Device not found on specified port */
+#define NDI_BAD_GBF         0x0108  /*!<\brief Malformed binary (GBF) reply from device */
+#define NDI_COMMAND_TOO_LONG 0x0109 /*!<\brief Command does not fit in the command buffer */
+#define NDI_STREAM_STOPPED  0x010A  /*!<\brief Streamed reply was stopped by the receiver */
+#define NDI_STREAMING       0x010B  /*!<\brief Not possible while a stream is running, or without one */
+#define NDI_BAD_ALLOC       0x010C  /*!<\brief Out of memory while storing a reply */
 
 #define NDI_DSR_FAILURE           0x0200  /*!<\brief Bad DSR query failure */
 #define NDI_BAD_REPLY             0x0201  /*!<\brief Bad reply from measurement system */
@@ -2129,6 +3121,33 @@ ndicapiExport void* ndiHexDecode(void* data, const char* cp, int n);
 #define NDI_COMPONENTID_SYS_ALERT  0x0012
 /*\}*/
 
+/* ndiGetBX2FrameType() return values */
+/*\{*/
+#define NDI_BX2_FRAME_DUMMY            0
+#define NDI_BX2_FRAME_ACTIVE_WIRELESS  1
+#define NDI_BX2_FRAME_PASSIVE          2
+#define NDI_BX2_FRAME_ACTIVE           3
+#define NDI_BX2_FRAME_LASER            4
+#define NDI_BX2_FRAME_ILLUMINATED      5
+#define NDI_BX2_FRAME_BACKGROUND       6
+#define NDI_BX2_FRAME_MAGNETIC         7
+#define NDI_BX2_FRAME_TYPE_COUNT       8
+/*\}*/
+
+/* ndiSetBX2DecodeMask() component bits */
+/*\{*/
+#define NDI_BX2_DECODE_6D          0x0001
+#define NDI_BX2_DECODE_3D          0x0002
+#define NDI_BX2_DECODE_1D          0x0004
+#define NDI_BX2_DECODE_2D          0x0008
+#define NDI_BX2_DECODE_LINE_SEP    0x0010
+#define NDI_BX2_DECODE_3D_ERROR    0x0020
+#define NDI_BX2_DECODE_IMAGE       0x0040
+#define NDI_BX2_DECODE_UV          0x0080
+#define NDI_BX2_DECODE_SYS_ALERT   0x0100
+#define NDI_BX2_DECODE_ALL         0x01FF
+/*\}*/
+
 /* ndiCOMM() baud rates */
 /*\{*/
 #define  NDI_9600     0
@@ -2246,8 +3265,31 @@ ndicapiExport void* ndiHexDecode(void* data, const char* cp, int n);
 #define NDI_BX2_TOOL_UNPLUGGED        33 // Tool has been unplugged from the System Control Unit
 /*\}*/
 
+/* BX2 tool status, the BX1 NDI_HANDLE_xxx values do not apply */
+#define NDI_BX2_ERROR_BITS  0x00FF  /* one of the ndiGetBX2PortStatus() codes above */
 #define NDI_BX2_MISSING_BIT 0x0100
 #define NDI_BX2_AVG_BIT     0x0200
+#define NDI_BX2_FACE_BITS   0xE000  /* face of a multi-face tool */
+#define NDI_BX2_3D_MISSING  0x01
+
+/* ndiEncodeBX2() reply options */
+/*\{*/
+#define NDI_BX2_REPLY_DEFAULT  0
+#define NDI_BX2_REPLY_NONE     1
+#define NDI_BX2_REPLY_TOOLS    2
+#define NDI_BX2_REPLY_STRAYS   3
+#define NDI_BX2_REPLY_ALL      4
+#define NDI_BX2_REPLY_BUTTONS  5
+/*\}*/
+
+/* ndiFrame sources */
+/*\{*/
+#define NDI_FRAME_NONE  0
+#define NDI_FRAME_GX    1
+#define NDI_FRAME_TX    2
+#define NDI_FRAME_BX    3
+#define NDI_FRAME_BX2   4
+/*\}*/
 
 #define NDI_SYS_ALERT_FAULT 0x01
 #define NDI_SYS_ALERT_ALERT 0x02
@@ -0,0 +1,123 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// This file contains helpers that are shared by the source files of the
+// ndicapi library.  It is not installed, and is not part of the API.
+
+#ifndef NDICAPI_INTERNAL_H
+#define NDICAPI_INTERNAL_H
+
+#include <chrono>
+#include <string.h>
+
+#include "ndicapi.h"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // The deadline that is 'milliseconds' from now
+  inline std::chrono::steady_clock::time_point ndiDeadline(int milliseconds)
+  {
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+  }
+
+  //----------------------------------------------------------------------------
+  // The milliseconds that are left until a deadline, rounded up, or zero
+  inline int ndiMillisecondsLeft(const std::chrono::steady_clock::time_point& deadline)
+  {
+    long long left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+    return (left > 0 ? (int)((left + 999) / 1000) : 0);
+  }
+
+  //----------------------------------------------------------------------------
+  // The error code of an "ERRORxx" reply of n characters, or zero if the
+  // reply is not an ERROR reply
+  inline int ndiReplyErrorCode(const char* reply, int n)
+  {
+    if (n < 7 || strncmp(reply, "ERROR", 5) != 0)
+    {
+      return 0;
+    }
+    return static_cast<int>(ndiHexToUnsignedLong(&reply[5], 2));
+  }
+
+  //----------------------------------------------------------------------------
+  // Read until 'buffer', which holds 'length' characters already, starts
+  // with a complete reply, framed by ndiReplyLength().  'reader' is called
+  // as ndiSerialReadSome() would be, and the whole reply must arrive within
+  // 'milliseconds'.  A binary reply is not read past its end once its header
+  // has been received, but the characters after an ASCII reply are left in
+  // the buffer and counted in 'length'.  The return value is the length of
+  // the reply, or 'size' if the buffer is full without one, and otherwise
+  // as for ndiSerialRead().
+  template <typename Reader>
+  int ndiFrameReply(const Reader& reader, int milliseconds, char* buffer, int size, int& length, bool isBinary, int* errorCode)
+  {
+    if (errorCode != NULL)
+    {
+      *errorCode = 0;
+    }
+
+    std::chrono::steady_clock::time_point deadline = ndiDeadline(milliseconds);
+    int replyLength;
+    while ((replyLength = ndiReplyLength(buffer, length, isBinary)) == 0)
+    {
+      if (length >= size)
+      {
+        return size;
+      }
+
+      int n = size - length;
+      int expected = 0;
+      int replySize = (isBinary ? ndiBinaryReplySize(buffer, length) : 0);
+      if (replySize > 0)
+      {
+        if (replySize - length < n)
+        {
+          n = replySize - length;
+        }
+        expected = n;
+      }
+
+      int m = reader(buffer + length, n, expected, ndiMillisecondsLeft(deadline));
+      if (m <= 0)
+      {
+        return m;
+      }
+      length += m;
+    }
+
+    if (errorCode != NULL)
+    {
+      *errorCode = ndiReplyErrorCode(buffer, replyLength);
+    }
+    return replyLength;
+  }
+
+  // The reads of ndiFrameReply() from a serial port
+  struct ndiSerialReader
+  {
+    NDIFileHandle Port;
+
+    int operator()(char* buffer, int n, int expected, int milliseconds) const
+    {
+      return ndiSerialReadSome(Port, buffer, n, expected, milliseconds);
+    }
+  };
+
+  // The reads of ndiFrameReply() from a socket, which has no use for 'expected'
+  struct ndiSocketReader
+  {
+    NDISocketHandle Socket;
+
+    int operator()(char* buffer, int n, int expected, int milliseconds) const
+    {
+      return ndiSocketReadSome(Socket, buffer, n, milliseconds);
+    }
+  };
+}
+
+#endif
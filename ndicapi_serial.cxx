@@ -37,7 +37,9 @@ POSSIBILITY OF SUCH DAMAGES.
 // that talk to the serial port.  All these methods
 // are of the form ndiSerialXX().
 
+#include <chrono>
 #include <errno.h>
+#include <limits.h>
 #include <time.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -45,14 +47,78 @@ POSSIBILITY OF SUCH DAMAGES.
 #include <string.h>
 
 #include "ndicapi_serial.h"
+#include "ndicapi_internal.h"
 
 // time out period in milliseconds
 #define TIMEOUT_PERIOD 5000
 
+//----------------------------------------------------------------------------
+ndicapiExport int ndiBinaryReplySize(const char* reply, int n)
+{
+  if (n < 2)
+  {
+    return 0;
+  }
+
+  if (reply[0] == (char)0xc4 && reply[1] == (char)0xa5)
+  {
+    // 2 bytes for the start sequence, 2 for the reply length, 2 for the header CRC, 2 for the CRC16
+    if (n < 4)
+    {
+      return 0;
+    }
+    return ((unsigned char)reply[2] | (unsigned char)reply[3] << 8) + 8;
+  }
+
+  if (reply[0] == (char)0xc8 && reply[1] == (char)0xa5)
+  {
+    // the extended header has a 4 byte reply length
+    if (n < 6)
+    {
+      return 0;
+    }
+    unsigned long length = (unsigned long)(unsigned char)reply[2] | (unsigned long)(unsigned char)reply[3] << 8 |
+                           (unsigned long)(unsigned char)reply[4] << 16 | (unsigned long)(unsigned char)reply[5] << 24;
+    if (length > (unsigned long)(INT_MAX - 10))
+    {
+      return INT_MAX;
+    }
+    return (int)length + 10;
+  }
+
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiReplyLength(const char* data, int n, bool isBinary)
+{
+  if (isBinary)
+  {
+    int size = ndiBinaryReplySize(data, n);
+    if (size >= 0)
+    {
+      return (size > 0 && size <= n ? size : 0);
+    }
+    // an ERROR reply to a binary command is ASCII
+  }
+
+  const char* end = (const char*)memchr(data, '\r', n);
+  return (end != NULL ? (int)(end - data) + 1 : 0);
+}
+
 #ifdef _WIN32
   #include "ndicapi_serial_win32.cxx"
 #elif defined(unix) || defined(__unix__) || defined(__linux__)
   #include "ndicapi_serial_unix.cxx"
 #elif defined(__APPLE__)
   #include "ndicapi_serial_apple.cxx"
-#endif
\ No newline at end of file
+#endif
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialRead(NDIFileHandle serial_port, char* reply, int numberOfBytesToRead, bool isBinary, int* errorCode)
+{
+  ndiSerialReader reader = { serial_port };
+  int length = 0;
+
+  return ndiFrameReply(reader, ndiSerialGetTimeout(serial_port), reply, numberOfBytesToRead, length, isBinary, errorCode);
+}
\ No newline at end of file
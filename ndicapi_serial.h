@@ -183,6 +183,8 @@ ndicapiExport int ndiSerialFlush(NDIFileHandle serial_port, int flushtype);
   Change the baud rate and other comm parameters.
 
   The baud rate should be one of 9600, 14400, 19200, 38400, 57600, 115200.
+  On linux, other rates such as 921600 and 1228739 are set with BOTHER
+  if the serial driver can produce them.
 
   The mode string should be one of "8N1", "7O2" etc. The first character
   is the number of data bits (7 or 8), the second character is the parity
@@ -208,13 +210,33 @@ ndicapiExport int ndiSerialComm(NDIFileHandle serial_port, int baud, const char*
 /*! \ingroup NDISerial
   Change the timeout for the serial port in milliseconds.
   The default is 5 seconds, but this might be too long for certain
-  applications.
+  applications.  The timeout is a deadline for a whole reply, with a
+  resolution of one millisecond except on the mac, where the timeout
+  is rounded down to 10ths of a second.
 
   The return value will be 0 if the call was successful.
   A negative return value signals failure.
 */
 ndicapiExport int ndiSerialTimeout(NDIFileHandle serial_port, int milliseconds);
 
+/*! \ingroup NDISerial
+  Get the timeout for the serial port in milliseconds, as set by
+  ndiSerialTimeout().
+*/
+ndicapiExport int ndiSerialGetTimeout(NDIFileHandle serial_port);
+
+/*! \ingroup NDISerial
+  Turn low-latency mode on or off, which is meant for USB-serial adapters
+  at high baud rates.  On linux this sets ASYNC_LOW_LATENCY for the port,
+  lowers the latency timer of an FTDI adapter to 1 ms if sysfs can be
+  written, and lets ndiSerialRead() wake up once for the rest of a long
+  binary reply.  Low-latency mode is turned off by ndiSerialClose().
+
+  The return value will be 0 if the port could be set up for low latency
+  by at least one of these means, and negative otherwise.
+*/
+ndicapiExport int ndiSerialLowLatency(NDIFileHandle serial_port, int enable);
+
 /*! \ingroup NDISerial
   Write a stream of 'n' characters from the string 'text' to the serial
   port.  The number of characters actually written is returned.
@@ -241,9 +263,62 @@ ndicapiExport int ndiSerialWrite(NDIFileHandle serial_port, const char* text, in
   is not a carriage return (i.e. reply[n-1] != '\r'), then the
   read was incomplete and there are more characters waiting to
   be read.
+
+  A binary read stops at the end of the reply, as given by
+  ndiBinaryReplySize().  If the reply is longer than 'n', then
+  'n' characters are read and the rest are left waiting.
+
+  If 'errorCode' is not NULL, it is set to the error code of an ERROR
+  reply, e.g. 0x01 for "ERROR01", or to zero for any other reply and
+  when no complete reply was read.
+
+  Characters that arrive after an ASCII reply within the same read are
+  not kept, and are not counted in the return value.  The ndicapi itself
+  reads through a receive buffer instead, which keeps them for the next
+  reply.
 */
 ndicapiExport int ndiSerialRead(NDIFileHandle serial_port, char* reply, int n, bool isBinary, int* errorCode);
 
+/*! \ingroup NDISerial
+  Read the characters that have arrived at the serial port, up to 'n'
+  of them, after waiting for at most 'milliseconds' for the first one.
+  There is no framing, this is what ndiSerialRead() and the receive
+  buffer of the ndicapi are built on.
+
+  The value of 'expected' is the number of characters that are known to
+  be on their way, or zero if this is not known.  A port in low-latency
+  mode uses it to wake up once for all of them, see ndiSerialLowLatency().
+
+  If the return value is negative, then an IO error occurred.
+  If the return value is zero, then a timeout error occurred.
+*/
+ndicapiExport int ndiSerialReadSome(NDIFileHandle serial_port, char* buffer, int n, int expected, int milliseconds);
+
+/*! \ingroup NDISerial
+  Get the length of the first complete reply in the 'n' characters that
+  were received, including its CRC and carriage return.  An ASCII reply
+  ends with a carriage return.  A binary reply ends where its header says
+  that it does, see ndiBinaryReplySize(), unless it is an ERROR reply.
+  This is the framing that is shared by the serial and the network
+  transports.
+
+  The return value is zero if more characters are needed.
+*/
+ndicapiExport int ndiReplyLength(const char* data, int n, bool isBinary);
+
+/*! \ingroup NDISerial
+  Get the full size of a binary reply from the first 'n' characters
+  that were received, for the A5C4 header with a 16-bit reply length
+  as well as for the A5C8 extended header with a 32-bit reply length.
+  The size includes the header and the trailing CRC.  This is shared
+  by the serial and the network transports.
+
+  The return value is zero if more characters are needed to know the
+  size, and negative if the reply does not start with a binary header,
+  as is the case for an ERROR reply.
+*/
+ndicapiExport int ndiBinaryReplySize(const char* reply, int n);
+
 /*! \ingroup NDISerial
   Sleep for the specified number of milliseconds.  The actual sleep time
   is likely to last for 10ms longer than the specifed time due to
@@ -50,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGES.
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 
 //----------------------------------------------------------------------------
@@ -281,6 +282,12 @@ ndicapiExport int ndiSerialComm(int serial_port, int baud, const char mode[4], i
   return tcsetattr(serial_port, TCSADRAIN, &t); /* set I/O information */
 }
 
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialLowLatency(int serial_port, int enable)
+{
+  return -1; /* not supported on this platform */
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSerialTimeout(int serial_port, int milliseconds)
 {
@@ -302,6 +309,18 @@ ndicapiExport int ndiSerialTimeout(int serial_port, int milliseconds)
   return 0;
 }
 
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialGetTimeout(int serial_port)
+{
+  struct termios t;
+
+  if (tcgetattr(serial_port, &t) == -1)
+  {
+    return TIMEOUT_PERIOD;
+  }
+  return t.c_cc[VTIME] * 100;
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSerialWrite(int serial_port, const char* text, int n)
 {
@@ -330,48 +349,50 @@ ndicapiExport int ndiSerialWrite(int serial_port, const char* text, int n)
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiSerialRead(int serial_port, char* reply, int numberOfBytesToRead, bool isBinary, int* errorCode)
+ndicapiExport int ndiSerialReadSome(int serial_port, char* buffer, int n, int expected, int milliseconds)
 {
-  int totalNumberOfBytesRead = 0;
-  int totalNumberOfBytesToRead = numberOfBytesToRead;
+  struct pollfd pfd;
   int numberOfBytesRead;
-  bool binarySizeCalculated = false;
 
-  do
+  pfd.fd = serial_port;
+  pfd.events = POLLIN;
+
+  for (;;)
   {
-    if ((numberOfBytesRead = read(serial_port, &reply[totalNumberOfBytesRead], numberOfBytesToRead)) == -1)
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, milliseconds);
+    if (ready == 0)   /* no characters before the timeout */
     {
-      if (errno == EAGAIN) /* canceled, so retry */
-      {
-        numberOfBytesRead = 0;
-      }
-      else
-      {
-        return -1; /* IO error occurred */
-      }
+      return 0;
     }
-    else if (numberOfBytesRead == 0)   /* no characters read, must have timed out */
+    else if (ready == -1)
     {
-      return 0;
+      if (errno == EINTR) /* interrupted, so retry */
+      {
+        continue;
+      }
+      return -1; /* IO error occurred */
     }
 
-    totalNumberOfBytesRead += numberOfBytesRead;
-    if ((!isBinary && reply[totalNumberOfBytesRead - 1] == '\r')       /* done when carriage return received (ASCII) or when ERROR... received (binary)*/
-        || (isBinary && strncmp(reply, "ERROR", 5) == 0 && reply[totalNumberOfBytesRead - 1] == '\r'))
+    if ((numberOfBytesRead = read(serial_port, buffer, n)) == -1)
     {
-      break;
+      if (errno == EAGAIN || errno == EINTR) /* canceled, so retry */
+      {
+        continue;
+      }
+      return -1; /* IO error occurred */
     }
-
-    if (isBinary && !binarySizeCalculated && reply[0] == (char)0xc4 && reply[1] == (char)0xa5)
+    else if (numberOfBytesRead == 0)
     {
-      // recalculate n based on the reply length (reported from ndi device) and the amount of data received so far
-      unsigned short size = ((unsigned char)reply[2] | (unsigned char)reply[3] << 8) + 8; // 8 bytes -> 2 for Start Sequence (a5c4), 2 for reply length, 2 for header CRC, 2 for CRC16
-      totalNumberOfBytesToRead = size;
+      if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))   /* the port has gone away */
+      {
+        return -1;
+      }
+      continue;
     }
-  }
-  while (totalNumberOfBytesRead != totalNumberOfBytesToRead);
 
-  return totalNumberOfBytesRead;
+    return numberOfBytesRead;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -50,8 +50,35 @@ POSSIBILITY OF SUCH DAMAGES.
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 
+#if defined(linux) || defined(__linux__)
+#include <limits.h>
+#include <linux/serial.h>
+
+/* termios2 allows any baud rate with BOTHER, but it cannot be included
+   along with <termios.h>, so the layout is declared here for the
+   architectures that use the generic one */
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || defined(__arm__) || defined(__riscv)
+#define NDI_HAVE_TERMIOS2
+struct ndi_termios2
+{
+  tcflag_t c_iflag;
+  tcflag_t c_oflag;
+  tcflag_t c_cflag;
+  tcflag_t c_lflag;
+  cc_t c_line;
+  cc_t c_cc[19];
+  speed_t c_ispeed;
+  speed_t c_ospeed;
+};
+#define NDI_TCGETS2  _IOR('T', 0x2A, struct ndi_termios2)
+#define NDI_TCSETSW2 _IOW('T', 0x2C, struct ndi_termios2)
+#define NDI_BOTHER   0010000
+#endif
+#endif
+
 //----------------------------------------------------------------------------
 // Some static variables to keep track of which ports are open, so that
 // we can restore the comm parameters (baud rate etc) when they are closed.
@@ -62,6 +89,39 @@ static int ndi_open_handles[4] = { -1, -1, -1, -1 };
 
 static struct termios ndi_save_termios[4];
 
+// The read timeout of each open port in milliseconds, see ndiSerialTimeout()
+static int ndi_timeouts[4];
+
+// Whether each open port is in low-latency mode, see ndiSerialLowLatency(),
+// the latency timer that it had before, or zero if that is not known, and
+// the VMIN that ndiSerialReadSome() has set for it
+static int ndi_low_latency[4];
+static int ndi_latency_timer[4];
+static int ndi_minimum[4];
+
+//----------------------------------------------------------------------------
+// The read timeout of a port in milliseconds.  A port that is not in the
+// table above falls back on the termios timeout, which is in 10ths of a second.
+ndicapiExport int ndiSerialGetTimeout(int serial_port)
+{
+  struct termios t;
+  int i;
+
+  for (i = 0; i < NDI_MAX_SAVE_STATE; i++)
+  {
+    if (ndi_open_handles[i] == serial_port)
+    {
+      return ndi_timeouts[i];
+    }
+  }
+
+  if (tcgetattr(serial_port, &t) == -1)
+  {
+    return TIMEOUT_PERIOD;
+  }
+  return t.c_cc[VTIME] * 100;
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSerialOpen(const char* device)
 {
@@ -106,6 +166,10 @@ ndicapiExport int ndiSerialOpen(const char* device)
     if (ndi_open_handles[i] == serial_port || ndi_open_handles[i] == -1)
     {
       ndi_open_handles[i] = serial_port;
+      ndi_timeouts[i] = TIMEOUT_PERIOD;
+      ndi_low_latency[i] = 0;
+      ndi_latency_timer[i] = 0;
+      ndi_minimum[i] = 0;
       tcgetattr(serial_port, &ndi_save_termios[i]);
       break;
     }
@@ -146,6 +210,10 @@ ndicapiExport void ndiSerialClose(int serial_port)
   {
     if (ndi_open_handles[i] == serial_port && ndi_open_handles[i] != -1)
     {
+      if (ndi_low_latency[i])
+      {
+        ndiSerialLowLatency(serial_port, 0);
+      }
       tcsetattr(serial_port, TCSANOW, &ndi_save_termios[i]);
       ndi_open_handles[i] = -1;
       break;
@@ -231,7 +299,12 @@ ndicapiExport int ndiSerialComm(int serial_port, int baud, const char mode[4], i
       newbaud = B230400;
       break;
     default:
+#ifdef NDI_HAVE_TERMIOS2
+      newbaud = 0; /* set with BOTHER below, e.g. 921600 or 1228739 */
+      break;
+#else
       return -1;
+#endif
   }
 #elif defined(sgi) && defined(__NEW_MAX_BAUD)
   switch (baud)
@@ -283,8 +356,11 @@ ndicapiExport int ndiSerialComm(int serial_port, int baud, const char mode[4], i
   t.c_cflag &= ~CSIZE;                /* clear flags */
 
 #if defined(linux) || defined(__linux__)
-  t.c_cflag &= ~CBAUD;
-  t.c_cflag |= newbaud;                /* set baud rate */
+  if (newbaud != 0)
+  {
+    t.c_cflag &= ~CBAUD;
+    t.c_cflag |= newbaud;              /* set baud rate */
+  }
 #elif defined(sgi) && defined(__NEW_MAX_BAUD)
   t.c_ospeed = newbaud;
 #else
@@ -355,9 +431,188 @@ ndicapiExport int ndiSerialComm(int serial_port, int baud, const char mode[4], i
 #endif
   }
 
+#ifdef NDI_HAVE_TERMIOS2
+  if (newbaud == 0)
+  {
+    struct ndi_termios2 t2;
+
+    if (tcsetattr(serial_port, TCSADRAIN, &t) == -1)
+    {
+      return -1;
+    }
+    /* the driver rounds to the nearest rate that it can produce */
+    if (ioctl(serial_port, NDI_TCGETS2, &t2) == -1)
+    {
+      return -1;
+    }
+    t2.c_cflag &= ~CBAUD;
+    t2.c_cflag |= NDI_BOTHER;
+    t2.c_ispeed = baud;
+    t2.c_ospeed = baud;
+    return ioctl(serial_port, NDI_TCSETSW2, &t2);
+  }
+#endif
+
   return tcsetattr(serial_port, TCSADRAIN, &t); /* set I/O information */
 }
 
+//----------------------------------------------------------------------------
+#if defined(linux) || defined(__linux__)
+// Set the latency timer of an FTDI USB-serial adapter, which holds back
+// a partly filled USB packet for up to 16 ms by default.  The value that
+// it had is stored in 'previous' unless that is NULL.  This needs write
+// access to sysfs, so it is done when possible and silently skipped when not.
+static int ndiSerialLatencyTimer(int serial_port, int milliseconds, int* previous)
+{
+  char path[PATH_MAX];
+  char device[PATH_MAX];
+  ssize_t n;
+  int length;
+
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", serial_port);
+  if ((n = readlink(path, device, sizeof(device) - 1)) <= 0)
+  {
+    return -1;
+  }
+  device[n] = '\0';
+
+  // a file name is at most NAME_MAX characters
+  const char* name = strrchr(device, '/');
+  name = (name ? name + 1 : device);
+  if (strlen(name) > NAME_MAX)
+  {
+    return -1;
+  }
+  length = snprintf(path, sizeof(path), "/sys/bus/usb-serial/devices/%.*s/latency_timer", NAME_MAX, name);
+  if (length < 0 || length >= (int)sizeof(path))
+  {
+    return -1;
+  }
+
+  FILE* file;
+  if (previous != NULL)
+  {
+    if ((file = fopen(path, "r")) == NULL)
+    {
+      return -1;
+    }
+    int valid = (fscanf(file, "%d", previous) == 1);
+    fclose(file);
+    if (!valid)
+    {
+      return -1;
+    }
+  }
+
+  if ((file = fopen(path, "w")) == NULL)
+  {
+    return -1;
+  }
+  int result = (fprintf(file, "%d", milliseconds) > 0 ? 0 : -1);
+  if (fclose(file) != 0)
+  {
+    result = -1;
+  }
+  return result;
+}
+#endif
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialLowLatency(int serial_port, int enable)
+{
+#if defined(linux) || defined(__linux__)
+  struct serial_struct ss;
+  int result = -1;
+  int slot;
+
+  for (slot = 0; slot < NDI_MAX_SAVE_STATE; slot++)
+  {
+    if (ndi_open_handles[slot] == serial_port)
+    {
+      break;
+    }
+  }
+
+  if (ioctl(serial_port, TIOCGSERIAL, &ss) != -1)
+  {
+    if (enable)
+    {
+      ss.flags |= ASYNC_LOW_LATENCY;
+    }
+    else
+    {
+      ss.flags &= ~ASYNC_LOW_LATENCY;
+    }
+    if (ioctl(serial_port, TIOCSSERIAL, &ss) != -1)
+    {
+      result = 0;
+    }
+  }
+
+  if (slot == NDI_MAX_SAVE_STATE)
+  {
+    // without a slot, the previous latency timer cannot be kept
+    if (ndiSerialLatencyTimer(serial_port, (enable ? 1 : 16), NULL) == 0)
+    {
+      result = 0;
+    }
+    return result;
+  }
+
+  if (enable)
+  {
+    // keep the timer from before the first enable, not our own setting
+    int previous;
+    if (ndiSerialLatencyTimer(serial_port, 1, &previous) == 0)
+    {
+      result = 0;
+      if (!ndi_low_latency[slot])
+      {
+        ndi_latency_timer[slot] = previous;
+      }
+    }
+  }
+  else
+  {
+    int restore = (ndi_latency_timer[slot] > 0 ? ndi_latency_timer[slot] : 16);
+    if (ndiSerialLatencyTimer(serial_port, restore, NULL) == 0)
+    {
+      result = 0;
+    }
+  }
+
+  ndi_low_latency[slot] = (enable != 0);
+
+  return result;
+#else
+  return -1;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Set the number of characters that wake up a reader of the port,
+// which is zero except while the rest of a long binary reply is awaited.
+// With VMIN set, VTIME limits the gap between characters instead, and it
+// is kept at one 10th of a second or more so that a reply that stops short
+// cannot block read() for good.
+static int ndiSerialSetMinimum(int serial_port, int n, int milliseconds)
+{
+  struct termios t;
+
+  if (tcgetattr(serial_port, &t) == -1)
+  {
+    return -1;
+  }
+  int tenths = milliseconds / 100;
+  if (n > 0 && tenths < 1)
+  {
+    tenths = 1;
+  }
+  t.c_cc[VMIN] = (cc_t)(n < 255 ? n : 255);
+  t.c_cc[VTIME] = (cc_t)(tenths < 255 ? tenths : 255);
+  return tcsetattr(serial_port, TCSANOW, &t);
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSerialTimeout(int serial_port, int milliseconds)
 {
@@ -376,6 +631,17 @@ ndicapiExport int ndiSerialTimeout(int serial_port, int milliseconds)
     return -1;
   }
 
+  /* ndiSerialReadSome() waits with poll(), which keeps the milliseconds */
+  for (int i = 0; i < NDI_MAX_SAVE_STATE; i++)
+  {
+    if (ndi_open_handles[i] == serial_port)
+    {
+      ndi_timeouts[i] = milliseconds;
+      ndi_minimum[i] = 0;
+      break;
+    }
+  }
+
   return 0;
 }
 
@@ -407,48 +673,85 @@ ndicapiExport int ndiSerialWrite(int serial_port, const char* text, int n)
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiSerialRead(int serial_port, char* reply, int numberOfBytesToRead, bool isBinary, int* errorCode)
+ndicapiExport int ndiSerialReadSome(int serial_port, char* buffer, int n, int expected, int milliseconds)
 {
-  int totalNumberOfBytesRead = 0;
-  int totalNumberOfBytesToRead = numberOfBytesToRead;
+  struct pollfd pfd;
   int numberOfBytesRead;
-  bool binarySizeCalculated = false;
+  int i;
 
-  do
+  // in low-latency mode, wake up once for the rest of a long binary reply
+  // instead of once for each USB packet, but never wait for more than what
+  // is on its way
+  for (i = 0; i < NDI_MAX_SAVE_STATE; i++)
   {
-    if ((numberOfBytesRead = read(serial_port, &reply[totalNumberOfBytesRead], numberOfBytesToRead)) == -1)
+    if (ndi_open_handles[i] == serial_port)
     {
-      if (errno == EAGAIN) /* canceled, so retry */
+      int minimum = ndi_minimum[i];
+      if (!ndi_low_latency[i] || expected <= 0)
       {
-        numberOfBytesRead = 0;
+        minimum = 0;
       }
-      else
+      else if (minimum > expected)
       {
-        return -1; /* IO error occurred */
+        minimum = expected;
       }
+      else if (minimum == 0 && expected > 64)
+      {
+        minimum = (expected < 255 ? expected : 255);
+      }
+      if (minimum != ndi_minimum[i] && ndiSerialSetMinimum(serial_port, minimum, ndi_timeouts[i]) == 0)
+      {
+        ndi_minimum[i] = minimum;
+      }
+      break;
     }
-    else if (numberOfBytesRead == 0)   /* no characters read, must have timed out */
+  }
+
+  pfd.fd = serial_port;
+  pfd.events = POLLIN;
+
+  for (;;)
+  {
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, milliseconds);
+    if (ready == 0)   /* no characters before the timeout */
     {
       return 0;
     }
+    else if (ready == -1)
+    {
+      if (errno == EINTR) /* interrupted, so retry */
+      {
+        continue;
+      }
+      return -1; /* IO error occurred */
+    }
 
-    totalNumberOfBytesRead += numberOfBytesRead;
-    if ((!isBinary && reply[totalNumberOfBytesRead - 1] == '\r')      /* done when carriage return received (ASCII) or when ERROR... received (binary)*/
-        || (isBinary && strncmp(reply, "ERROR", 5) == 0 && reply[totalNumberOfBytesRead - 1] == '\r'))
+    if ((numberOfBytesRead = read(serial_port, buffer, n)) == -1)
     {
-      break;
+      if (errno == EAGAIN || errno == EINTR) /* canceled, so retry */
+      {
+        continue;
+      }
+      return -1; /* IO error occurred */
+    }
+    else if (numberOfBytesRead == 0)
+    {
+      if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))   /* the port has gone away */
+      {
+        return -1;
+      }
+      continue;
     }
 
-    if (isBinary && !binarySizeCalculated && reply[0] == (char)0xc4 && reply[1] == (char)0xa5)
+    // back to the default once all that was expected has arrived
+    if (i < NDI_MAX_SAVE_STATE && ndi_minimum[i] != 0 && numberOfBytesRead >= expected && ndiSerialSetMinimum(serial_port, 0, ndi_timeouts[i]) == 0)
     {
-      // recalculate n based on the reply length (reported from ndi device) and the amount of data received so far
-      unsigned short size = ((unsigned char)reply[2] | (unsigned char)reply[3] << 8) + 8; // 8 bytes -> 2 for Start Sequence (a5c4), 2 for reply length, 2 for header CRC, 2 for CRC16
-      totalNumberOfBytesToRead = size;
+      ndi_minimum[i] = 0;
     }
-  }
-  while (totalNumberOfBytesRead != totalNumberOfBytesToRead);
 
-  return totalNumberOfBytesRead;
+    return numberOfBytesRead;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -314,6 +314,12 @@ ndicapiExport int ndiSerialComm(HANDLE serial_port, int baud, const char* mode,
   return result > 0 ? 0 : -1;
 }
 
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialLowLatency(HANDLE serial_port, int enable)
+{
+  return -1; /* not supported on this platform */
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSerialTimeout(HANDLE serial_port, int milliseconds)
 {
@@ -337,6 +343,20 @@ ndicapiExport int ndiSerialTimeout(HANDLE serial_port, int milliseconds)
   return 0;
 }
 
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSerialGetTimeout(HANDLE serial_port)
+{
+  COMMTIMEOUTS ctmo;
+
+  /* ndiSerialReadSome() changes the read timeout to what is left of the
+     timeout for a reply, so the write timeout is the one that was set */
+  if (GetCommTimeouts(serial_port, &ctmo) == FALSE)
+  {
+    return TIMEOUT_PERIOD;
+  }
+  return (int)ctmo.WriteTotalTimeoutConstant;
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSerialWrite(HANDLE serial_port, const char* text, int n)
 {
@@ -369,57 +389,41 @@ ndicapiExport int ndiSerialWrite(HANDLE serial_port, const char* text, int n)
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiSerialRead(HANDLE serial_port, char* reply, int numberOfBytesToRead, bool isBinary, int* errorCode)
+ndicapiExport int ndiSerialReadSome(HANDLE serial_port, char* buffer, int n, int expected, int milliseconds)
 {
-  int totalNumberOfBytesRead = 0;
-  int totalNumberOfBytesToRead = numberOfBytesToRead;
+  COMMTIMEOUTS ctmo;
   DWORD numberOfBytesRead;
-  bool binarySizeCalculated = false;
 
-  do
+  /* ReadFile() returns as soon as any characters have arrived, or when
+     ReadTotalTimeoutConstant has passed, see ndiSerialTimeout() */
+  if (GetCommTimeouts(serial_port, &ctmo) == FALSE)
   {
-    if (ReadFile(serial_port, &reply[totalNumberOfBytesRead], numberOfBytesToRead, &numberOfBytesRead, NULL) == FALSE)
-    {
-      if (GetLastError() == ERROR_OPERATION_ABORTED)  /* canceled */
-      {
-        DWORD dummyVariable;
-        ClearCommError(serial_port, &dummyVariable, NULL); /* so clear error and retry */
-      }
-      else
-      {
-        return -1;  /* IO error occurred */
-      }
-    }
-    else if (numberOfBytesRead == 0)   /* no characters read, must have timed out */
+    return -1;
+  }
+  if (ctmo.ReadTotalTimeoutConstant != (DWORD)milliseconds)
+  {
+    ctmo.ReadTotalTimeoutConstant = milliseconds;
+    if (SetCommTimeouts(serial_port, &ctmo) == FALSE)
     {
-      return 0;
+      return -1;
     }
+  }
 
-    totalNumberOfBytesRead += numberOfBytesRead;
-    if (!isBinary && reply[totalNumberOfBytesRead - 1] == '\r'       /* done when carriage return received (ASCII) or when ERROR... received (binary)*/
-        || isBinary && strncmp(reply, "ERROR", 5) == 0 && reply[totalNumberOfBytesRead - 1] == '\r')
+  for (;;)
+  {
+    if (ReadFile(serial_port, buffer, n, &numberOfBytesRead, NULL) == FALSE)
     {
-      if (strncmp(reply, "ERROR", 5) == 0)
+      if (GetLastError() == ERROR_OPERATION_ABORTED)  /* canceled */
       {
-        unsigned long err = ndiHexToUnsignedLong(&reply[5], 2);
-        if (errorCode != NULL)
-        {
-          *errorCode = static_cast<int>(err);
-        }
+        DWORD dummyVariable;
+        ClearCommError(serial_port, &dummyVariable, NULL); /* so clear error and retry */
+        continue;
       }
-      break;
+      return -1;  /* IO error occurred */
     }
 
-    if (isBinary && !binarySizeCalculated && reply[0] == (char)0xc4 && reply[1] == (char)0xa5)
-    {
-      // recalculate n based on the reply length (reported from ndi device) and the amount of data received so far
-      unsigned short size = ((unsigned char)reply[2] | (unsigned char)reply[3] << 8) + 8; // 8 bytes -> 2 for Start Sequence (a5c4), 2 for reply length, 2 for header CRC, 2 for CRC16
-      totalNumberOfBytesToRead = size;
-    }
+    return (int)numberOfBytesRead;
   }
-  while (totalNumberOfBytesRead != totalNumberOfBytesToRead);
-
-  return totalNumberOfBytesRead;
 }
 
 //----------------------------------------------------------------------------
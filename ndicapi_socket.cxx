@@ -8,6 +8,7 @@ See License.md for details.
 // that talk to the socket.  All these methods
 // are of the form ndiSocketXX().
 
+#include <chrono>
 #include <errno.h>
 #include <time.h>
 #include <ctype.h>
@@ -16,14 +17,37 @@ See License.md for details.
 #include <string.h>
 
 #include "ndicapi_socket.h"
+#include "ndicapi_serial.h"
+#include "ndicapi_internal.h"
 
 // time out period in milliseconds
 #define TIMEOUT_PERIOD_MS 500
 
+// socket buffer sizes, the receive buffer holds a BX2 reply with images
+#define NDI_SOCKET_RECEIVE_BUFFER (512 * 1024)
+#define NDI_SOCKET_SEND_BUFFER (64 * 1024)
+
+// a tracker that stops answering is given up on after a few seconds,
+// instead of after the system default of several minutes
+#define NDI_KEEPALIVE_IDLE_S 2
+#define NDI_KEEPALIVE_INTERVAL_S 1
+#define NDI_KEEPALIVE_COUNT 3
+#define NDI_USER_TIMEOUT_MS 5000
+
+// the number of addresses of a host that ndiSocketOpen() tries at once
+#define NDI_CONNECT_ATTEMPTS 16
+
 #ifdef _WIN32
   #include "ndicapi_socket_win32.cxx"
-#elif defined(unix) || defined(__unix__) || defined(__linux__)
+#elif defined(unix) || defined(__unix__) || defined(__linux__) || defined(__APPLE__)
   #include "ndicapi_socket_unix.cxx"
-#elif defined(__APPLE__)
-  #include "ndicapi_socket_apple.cxx"
-#endif
\ No newline at end of file
+#endif
+
+//----------------------------------------------------------------------------
+ndicapiExport int ndiSocketRead(NDISocketHandle socket, char* reply, int numberOfBytesToRead, bool isBinary, int* outErrorCode)
+{
+  ndiSocketReader reader = { socket };
+  int length = 0;
+
+  return ndiFrameReply(reader, ndiSocketGetTimeout(socket), reply, numberOfBytesToRead, length, isBinary, outErrorCode);
+}
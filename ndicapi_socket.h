@@ -41,7 +41,8 @@ typedef long NDISocketHandle;
 #endif
 
 /*! \ingroup NDISocket
-Open the specified socket.
+Open the specified socket, waiting at most NDI_CONNECT_TIMEOUT_MS for
+the connection.
 A return value of false means that an error occurred.
 
 /return Connected or not
@@ -51,13 +52,30 @@ A return value of false means that an error occurred.
 */
 ndicapiExport bool ndiSocketOpen(const char* hostname, int port, NDISocketHandle& outSocket);
 
+/*! \ingroup NDISocket
+Open the specified socket, waiting at most the given time for the
+connection.  The host name may resolve to several IPv4 and IPv6
+addresses, all of which are tried at the same time, and the first
+connection to succeed is kept.
+A return value of false means that an error occurred.
+
+/return Connected or not
+/param hostname URL to connect to
+/param port Port to connect to
+/param timeoutMs the time to wait, or 0 to wait as long as the system does
+/param outSocket variable to store the created socket
+*/
+ndicapiExport bool ndiSocketOpenTimeout(const char* hostname, int port, int timeoutMs, NDISocketHandle& outSocket);
+
+#define NDI_CONNECT_TIMEOUT_MS 2000
+
 /*! \ingroup NDISocket
 Close the socket.
 */
 ndicapiExport void ndiSocketClose(NDISocketHandle socket);
 
 /*! \ingroup NDISocket
-Flush out the serial I/O buffers. The following options are available:
+Flush out the socket I/O buffers. The following options are available:
 - NDI_IFLUSH:  discard the contents of the input buffer
 - NDI_OFLUSH:  discard the contents of the output buffer
 - NDI_IOFLUSH: discard the contents of both buffers.
@@ -73,11 +91,18 @@ ndicapiExport bool ndiSocketFlush(NDISocketHandle socket, int flushtype);
 /*! \ingroup NDISocket
 Change the timeout for the socket in milliseconds.
 The default is 0.5 seconds, but this might be too long for certain applications.
+The timeout is a deadline for a whole reply, and is not restarted
+by each piece of the reply that arrives.
 
 The return value will be true if the call was successful.
 */
 ndicapiExport bool ndiSocketTimeout(NDISocketHandle socket, int milliseconds);
 
+/*! \ingroup NDISocket
+Get the timeout for the socket in milliseconds, as set by ndiSocketTimeout().
+*/
+ndicapiExport int ndiSocketGetTimeout(NDISocketHandle socket);
+
 /*! \ingroup NDISocket
 Write a stream of 'n' characters from the string 'text' to the socket.
 The number of characters actually written is returned.
@@ -99,9 +124,33 @@ If the return value is equal to 'n' and the final character
 is not a carriage return (i.e. reply[n-1] != '\r'), then the
 read was incomplete and there are more characters waiting to
 be read.
+
+A binary read stops at the end of the reply, as given by
+ndiBinaryReplySize().  If the reply is longer than 'n', then
+'n' characters are read and the rest are left waiting.
+
+If 'outErrorCode' is not NULL, it is set to the error code of an ERROR
+reply, e.g. 0x01 for "ERROR01", or to zero for any other reply and
+when no complete reply was read.
+
+Characters that arrive after an ASCII reply within the same read are
+not kept, and are not counted in the return value.  This is the same
+framing as ndiSerialRead().
 */
 ndicapiExport int ndiSocketRead(NDISocketHandle socket, char* reply, int numberOfBytesToRead, bool isBinary, int* outErrorCode);
 
+/*! \ingroup NDISocket
+Read the bytes that have arrived at the socket, up to 'n' of them, after
+waiting for at most 'milliseconds' for the first one.  There is no framing,
+this is what ndiSocketRead() and the receive buffer of the ndicapi are
+built on.
+
+If the return value is negative, then an IO error occurred or the
+connection was closed.  If the return value is zero, then a timeout
+error occurred.
+*/
+ndicapiExport int ndiSocketReadSome(NDISocketHandle socket, char* buffer, int n, int milliseconds);
+
 /*! \ingroup NDISocket
 Sleep the socket
 */
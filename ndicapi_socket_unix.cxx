@@ -4,55 +4,188 @@ Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
 See License.md for details.
 =========================================================Plus=header=end*/
 
+// The socket methods for linux, the mac and other unix systems.  The
+// options that only some of them have are checked for where they are used.
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
-#include <arpa/inet.h>
 #include <netdb.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <sys/time.h>
 
 //----------------------------------------------------------------------------
-ndicapiExport bool ndiSocketOpen(const char* hostname, int port, NDISocketHandle& outSocket)
+// Set the socket options for talking to a tracker, before it is connected.
+// Commands are small writes that must not wait for Nagle's algorithm, and
+// a dead tracker must be noticed quickly.  The options that the system
+// does not have are skipped.
+static bool ndiSocketTune(NDISocketHandle sock)
 {
-  NDISocketHandle sock = socket(AF_INET, SOCK_STREAM, 0);
-
-  // Eliminate windows 0.2 second delay sending (buffering) data.
   int on = 1;
   if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on)))
   {
     return false;
   }
 
-  struct hostent* hp;
-  hp = gethostbyname(hostname);
-  if (!hp)
+  int size = NDI_SOCKET_RECEIVE_BUFFER;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  size = NDI_SOCKET_SEND_BUFFER;
+  setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+#if defined(TCP_KEEPIDLE)
+  int value = NDI_KEEPALIVE_IDLE_S;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &value, sizeof(value));
+#elif defined(TCP_KEEPALIVE) // Mac OS X
+  int value = NDI_KEEPALIVE_IDLE_S;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPALIVE, &value, sizeof(value));
+#endif
+#ifdef TCP_KEEPINTVL
+  int interval = NDI_KEEPALIVE_INTERVAL_S;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+#endif
+#ifdef TCP_KEEPCNT
+  int count = NDI_KEEPALIVE_COUNT;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#endif
+#ifdef TCP_USER_TIMEOUT
+  // unacknowledged commands also count as a dead tracker
+  unsigned int userTimeout = NDI_USER_TIMEOUT_MS;
+  setsockopt(sock, IPPROTO_TCP, TCP_USER_TIMEOUT, &userTimeout, sizeof(userTimeout));
+#endif
+#ifdef TCP_QUICKACK
+  setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+#endif
+#if defined(SO_NOSIGPIPE) // Mac OS X, where send() has no MSG_NOSIGNAL
+  setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport bool ndiSocketOpen(const char* hostname, int port, NDISocketHandle& outSocket)
+{
+  return ndiSocketOpenTimeout(hostname, port, NDI_CONNECT_TIMEOUT_MS, outSocket);
+}
+
+//----------------------------------------------------------------------------
+// A connect is started on each address of the host at once, without
+// waiting, and the first one to succeed is kept.  A tracker that is down
+// therefore fails after timeoutMs instead of after the system timeout.
+ndicapiExport bool ndiSocketOpenTimeout(const char* hostname, int port, int timeoutMs, NDISocketHandle& outSocket)
+{
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICSERV;
+
+  struct addrinfo* addresses = NULL;
+  if (getaddrinfo(hostname, service, &hints, &addresses) != 0)
   {
-    unsigned long addr = inet_addr(hostname);
-    hp = gethostbyaddr((char*)&addr, sizeof(addr), AF_INET);
+    return false;
   }
 
-  if (!hp)
+  struct pollfd attempts[NDI_CONNECT_ATTEMPTS];
+  int numberOfAttempts = 0;
+  for (struct addrinfo* address = addresses; address != NULL && numberOfAttempts < NDI_CONNECT_ATTEMPTS; address = address->ai_next)
   {
-    return false;
+    NDISocketHandle sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (sock == -1)
+    {
+      continue;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags == -1 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) == -1 || !ndiSocketTune(sock))
+    {
+      close(sock);
+      continue;
+    }
+
+    // a connect that finishes at once is seen by poll() like the others
+    if (connect(sock, address->ai_addr, address->ai_addrlen) == -1 && errno != EINPROGRESS)
+    {
+      close(sock);
+      continue;
+    }
+
+    attempts[numberOfAttempts].fd = sock;
+    attempts[numberOfAttempts].events = POLLOUT;
+    numberOfAttempts++;
   }
+  freeaddrinfo(addresses);
 
-  struct sockaddr_in name;
-  name.sin_family = AF_INET;
-  memcpy(&name.sin_addr, hp->h_addr, hp->h_length);
-  name.sin_port = htons(port);
+  std::chrono::steady_clock::time_point deadline = ndiDeadline(timeoutMs);
+  NDISocketHandle connected = -1;
+  int pending = numberOfAttempts;
 
-  int r = connect(sock, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+  while (connected == -1 && pending > 0)
+  {
+    for (int i = 0; i < numberOfAttempts; i++)
+    {
+      attempts[i].revents = 0;
+    }
+    int ready = poll(attempts, numberOfAttempts, (timeoutMs > 0 ? ndiMillisecondsLeft(deadline) : -1));
+    if (ready == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    if (ready < 1)
+    {
+      // timed out, or poll() failed
+      break;
+    }
+
+    for (int i = 0; i < numberOfAttempts && connected == -1; i++)
+    {
+      if (attempts[i].fd == -1 || attempts[i].revents == 0)
+      {
+        continue;
+      }
 
-  if (r < 0)
+      int error = 0;
+      socklen_t length = sizeof(error);
+      if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+      {
+        connected = attempts[i].fd;
+      }
+      else
+      {
+        // poll() skips the negative descriptors
+        close(attempts[i].fd);
+      }
+      attempts[i].fd = -1;
+      pending--;
+    }
+  }
+
+  for (int i = 0; i < numberOfAttempts; i++)
+  {
+    if (attempts[i].fd != -1)
+    {
+      close(attempts[i].fd);
+    }
+  }
+
+  if (connected == -1)
   {
-    shutdown(sock, 2);
-    close(sock);
     return false;
   }
 
-  outSocket = sock;
+  // the reads and writes expect a blocking socket
+  int flags = fcntl(connected, F_GETFL, 0);
+  fcntl(connected, F_SETFL, flags & ~O_NONBLOCK);
+
+  outSocket = connected;
   return true;
 }
 
@@ -66,6 +199,26 @@ ndicapiExport void ndiSocketClose(NDISocketHandle socket)
 //----------------------------------------------------------------------------
 ndicapiExport bool ndiSocketFlush(NDISocketHandle socket, int flushtype)
 {
+  // the output is sent as soon as it is written, but the input may hold
+  // the rest of a reply that timed out, so read until nothing is left
+  if (flushtype & NDI_IFLUSH)
+  {
+    char scratch[4096];
+    for (int i = 0; i < 256; i++)
+    {
+      ssize_t n = recv(socket, scratch, sizeof(scratch), MSG_DONTWAIT);
+      if (n > 0)
+      {
+        continue;
+      }
+      if (n == -1 && errno == EINTR)
+      {
+        continue;
+      }
+      // nothing left, or the connection is gone and the read will say so
+      return (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+  }
   return true;
 }
 
@@ -74,12 +227,30 @@ ndicapiExport bool ndiSocketTimeout(NDISocketHandle socket, int timeoutMs)
 {
   if (timeoutMs > 0)
   {
-    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (char*) & (timeoutMs), sizeof(timeoutMs));
-    return true;
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    return setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
   }
   return false;
 }
 
+//----------------------------------------------------------------------------
+// The timeout is kept in SO_RCVTIMEO, but recv() is only called once poll()
+// has seen data, so that the timeout applies to the whole reply and not to
+// each recv().
+ndicapiExport int ndiSocketGetTimeout(NDISocketHandle socket)
+{
+  struct timeval tv;
+  socklen_t length = sizeof(tv);
+
+  if (getsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &tv, &length) == -1 || (tv.tv_sec == 0 && tv.tv_usec == 0))
+  {
+    return TIMEOUT_PERIOD_MS;
+  }
+  return (int)(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSocketWrite(NDISocketHandle socket, const char* data, int length)
 {
@@ -97,7 +268,8 @@ ndicapiExport int ndiSocketWrite(NDISocketHandle socket, const char* data, int l
 
     // On unix boxes if the client disconnects and the server attempts
     // to send data through the socket then the application crashes
-    // due to SIGPIPE signal. Disable the signal to prevent crash.
+    // due to SIGPIPE signal. Disable the signal to prevent crash, the
+    // mac does it with SO_NOSIGPIPE instead, see ndiSocketTune().
 #if defined(MSG_NOSIGNAL) // For Linux > 2.2
     flags = MSG_NOSIGNAL;
 #else
@@ -115,39 +287,47 @@ ndicapiExport int ndiSocketWrite(NDISocketHandle socket, const char* data, int l
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiSocketRead(NDISocketHandle socket, char* reply, int numberOfBytesToRead, bool isBinary, int* outErrorCode)
+ndicapiExport int ndiSocketReadSome(NDISocketHandle socket, char* buffer, int n, int milliseconds)
 {
-  int totalNumberOfBytesRead = 0;
-  int totalNumberOfBytesToRead = numberOfBytesToRead;
-  int numberOfBytesRead;
-  bool binarySizeCalculated = false;
+  struct pollfd pfd;
+  pfd.fd = socket;
+  pfd.events = POLLIN;
 
-  do
+  for (;;)
   {
-    numberOfBytesRead = recv(socket, reply + totalNumberOfBytesRead, numberOfBytesToRead, 0);
-
-    if (numberOfBytesRead < 1)
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, milliseconds);
+    if (ready == 0)
+    {
+      // NDI handles 0 bytes returned as a timeout
+      return 0;
+    }
+    else if (ready == -1)
     {
+      if (errno == EINTR)
+      {
+        continue;
+      }
       return -1;
     }
 
-    totalNumberOfBytesRead += numberOfBytesRead;
-    if ((!isBinary && reply[totalNumberOfBytesRead - 1] == '\r')       /* done when carriage return received (ASCII) or when ERROR... received (binary)*/
-        || (isBinary && strncmp(reply, "ERROR", 5) == 0 && reply[totalNumberOfBytesRead - 1] == '\r'))
+    int numberOfBytesRead = recv(socket, buffer, n, 0);
+    if (numberOfBytesRead == -1 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
     {
-      break;
+      continue;
     }
-
-    if (isBinary && !binarySizeCalculated && reply[0] == (char)0xc4 && reply[1] == (char)0xa5)
+    if (numberOfBytesRead < 1)
     {
-      // recalculate n based on the reply length (reported from ndi device) and the amount of data received so far
-      unsigned short size = ((unsigned char)reply[2] | (unsigned char)reply[3] << 8) + 8; // 8 bytes -> 2 for Start Sequence (a5c4), 2 for reply length, 2 for header CRC, 2 for CRC16
-      totalNumberOfBytesToRead = size;
+      // an error, or the connection has been closed
+      return -1;
     }
+#ifdef TCP_QUICKACK
+    // acknowledge the reply at once, the system turns this off again by itself
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+#endif
+    return numberOfBytesRead;
   }
-  while (totalNumberOfBytesRead != totalNumberOfBytesToRead);
-
-  return totalNumberOfBytesRead;
 }
 
 //----------------------------------------------------------------------------
@@ -5,9 +5,53 @@ See License.md for details.
 =========================================================Plus=header=end*/
 
 #include <string.h>
+#include <ws2tcpip.h>
+
+//----------------------------------------------------------------------------
+// Set the socket options for talking to a tracker, before it is connected.
+static bool ndiSocketTune(NDISocketHandle sock)
+{
+  // Eliminate windows 0.2 second delay sending (buffering) data.
+  int on = 1;
+  if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on)))
+  {
+    return false;
+  }
+
+  int size = NDI_SOCKET_RECEIVE_BUFFER;
+  setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char*)&size, sizeof(size));
+  size = NDI_SOCKET_SEND_BUFFER;
+  setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char*)&size, sizeof(size));
+
+  // notice a tracker that stops answering within a few seconds
+  setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, (char*)&on, sizeof(on));
+#ifdef TCP_KEEPIDLE
+  int value = NDI_KEEPALIVE_IDLE_S;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, (char*)&value, sizeof(value));
+#endif
+#ifdef TCP_KEEPINTVL
+  int interval = NDI_KEEPALIVE_INTERVAL_S;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, (char*)&interval, sizeof(interval));
+#endif
+#ifdef TCP_KEEPCNT
+  int count = NDI_KEEPALIVE_COUNT;
+  setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, (char*)&count, sizeof(count));
+#endif
+
+  return true;
+}
 
 //----------------------------------------------------------------------------
 ndicapiExport bool ndiSocketOpen(const char* hostname, int port, NDISocketHandle& outSocket)
+{
+  return ndiSocketOpenTimeout(hostname, port, NDI_CONNECT_TIMEOUT_MS, outSocket);
+}
+
+//----------------------------------------------------------------------------
+// A connect is started on each address of the host at once, without
+// waiting, and the first one to succeed is kept.  A tracker that is down
+// therefore fails after timeoutMs instead of after the system timeout.
+ndicapiExport bool ndiSocketOpenTimeout(const char* hostname, int port, int timeoutMs, NDISocketHandle& outSocket)
 {
   // Declare variables
   WSADATA wsaData;
@@ -19,41 +63,120 @@ ndicapiExport bool ndiSocketOpen(const char* hostname, int port, NDISocketHandle
     return false;
   }
 
-  NDISocketHandle sock = socket(AF_INET, SOCK_STREAM, 0);
-  // Eliminate windows 0.2 second delay sending (buffering) data.
-  int on = 1;
-  if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on)))
+  char service[16];
+  _snprintf(service, sizeof(service), "%d", port);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICSERV;
+
+  struct addrinfo* addresses = NULL;
+  if (getaddrinfo(hostname, service, &hints, &addresses) != 0)
   {
     return false;
   }
 
-  struct hostent* hp;
-  hp = gethostbyname(hostname);
-  if (!hp)
+  NDISocketHandle attempts[NDI_CONNECT_ATTEMPTS];
+  int numberOfAttempts = 0;
+  for (struct addrinfo* address = addresses; address != NULL && numberOfAttempts < NDI_CONNECT_ATTEMPTS; address = address->ai_next)
   {
-    unsigned long addr = inet_addr(hostname);
-    hp = gethostbyaddr((char*)&addr, sizeof(addr), AF_INET);
+    NDISocketHandle sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (sock == INVALID_SOCKET)
+    {
+      continue;
+    }
+
+    u_long nonBlocking = 1;
+    if (ioctlsocket(sock, FIONBIO, &nonBlocking) == SOCKET_ERROR || !ndiSocketTune(sock))
+    {
+      closesocket(sock);
+      continue;
+    }
+
+    // a connect that finishes at once is seen by select() like the others
+    if (connect(sock, address->ai_addr, (int)address->ai_addrlen) == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK)
+    {
+      closesocket(sock);
+      continue;
+    }
+
+    attempts[numberOfAttempts++] = sock;
   }
+  freeaddrinfo(addresses);
+
+  std::chrono::steady_clock::time_point deadline = ndiDeadline(timeoutMs);
+  NDISocketHandle connected = INVALID_SOCKET;
+  int pending = numberOfAttempts;
 
-  if (!hp)
+  while (connected == INVALID_SOCKET && pending > 0)
   {
-    return false;
-  }
+    // windows reports a connection as writable, and a failure as an exception
+    fd_set writable;
+    fd_set failed;
+    FD_ZERO(&writable);
+    FD_ZERO(&failed);
+    for (int i = 0; i < numberOfAttempts; i++)
+    {
+      if (attempts[i] != INVALID_SOCKET)
+      {
+        FD_SET(attempts[i], &writable);
+        FD_SET(attempts[i], &failed);
+      }
+    }
+
+    struct timeval tv;
+    int milliseconds = ndiMillisecondsLeft(deadline);
+    tv.tv_sec = milliseconds / 1000;
+    tv.tv_usec = (milliseconds % 1000) * 1000;
+    int ready = select(0, NULL, &writable, &failed, (timeoutMs > 0 ? &tv : NULL));
+    if (ready == 0 || ready == SOCKET_ERROR)
+    {
+      break;
+    }
 
-  struct sockaddr_in name;
-  name.sin_family = AF_INET;
-  memcpy(&name.sin_addr, hp->h_addr, hp->h_length);
-  name.sin_port = htons(port);
+    for (int i = 0; i < numberOfAttempts && connected == INVALID_SOCKET; i++)
+    {
+      if (attempts[i] == INVALID_SOCKET)
+      {
+        continue;
+      }
+      if (FD_ISSET(attempts[i], &writable))
+      {
+        connected = attempts[i];
+      }
+      else if (FD_ISSET(attempts[i], &failed))
+      {
+        closesocket(attempts[i]);
+      }
+      else
+      {
+        continue;
+      }
+      attempts[i] = INVALID_SOCKET;
+      pending--;
+    }
+  }
 
-  int r = connect(sock, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+  for (int i = 0; i < numberOfAttempts; i++)
+  {
+    if (attempts[i] != INVALID_SOCKET)
+    {
+      closesocket(attempts[i]);
+    }
+  }
 
-  if (r < 0)
+  if (connected == INVALID_SOCKET)
   {
-    closesocket(sock);
     return false;
   }
 
-  outSocket = sock;
+  // the reads and writes expect a blocking socket
+  u_long nonBlocking = 0;
+  ioctlsocket(connected, FIONBIO, &nonBlocking);
+
+  outSocket = connected;
   return true;
 }
 
@@ -70,6 +193,28 @@ ndicapiExport void ndiSocketClose(NDISocketHandle socket)
 //----------------------------------------------------------------------------
 ndicapiExport bool ndiSocketFlush(NDISocketHandle socket, int flushtype)
 {
+  // the output is sent as soon as it is written, but the input may hold
+  // the rest of a reply that timed out, so read until nothing is left
+  if (flushtype & NDI_IFLUSH)
+  {
+    char scratch[4096];
+    u_long pending = 0;
+    for (int i = 0; i < 256; i++)
+    {
+      if (ioctlsocket(socket, FIONREAD, &pending) == SOCKET_ERROR)
+      {
+        return false;
+      }
+      if (pending == 0)
+      {
+        break;
+      }
+      if (recv(socket, scratch, (pending < sizeof(scratch) ? (int)pending : (int)sizeof(scratch)), 0) <= 0)
+      {
+        return false;
+      }
+    }
+  }
   return true;
 }
 
@@ -84,6 +229,22 @@ ndicapiExport bool ndiSocketTimeout(NDISocketHandle socket, int timeoutMs)
   return false;
 }
 
+//----------------------------------------------------------------------------
+// The timeout is kept in SO_RCVTIMEO, but recv() is only called once
+// select() has seen data, so that the timeout applies to the whole reply
+// and not to each recv().
+ndicapiExport int ndiSocketGetTimeout(NDISocketHandle socket)
+{
+  DWORD timeoutMs = 0;
+  int length = sizeof(timeoutMs);
+
+  if (getsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeoutMs, &length) == SOCKET_ERROR || timeoutMs == 0)
+  {
+    return TIMEOUT_PERIOD_MS;
+  }
+  return (int)timeoutMs;
+}
+
 //----------------------------------------------------------------------------
 ndicapiExport int ndiSocketWrite(NDISocketHandle socket, const char* data, int length)
 {
@@ -110,56 +271,47 @@ ndicapiExport int ndiSocketWrite(NDISocketHandle socket, const char* data, int l
 }
 
 //----------------------------------------------------------------------------
-ndicapiExport int ndiSocketRead(NDISocketHandle socket, char* reply, int numberOfBytesToRead, bool isBinary, int* outErrorCode)
+ndicapiExport int ndiSocketReadSome(NDISocketHandle socket, char* buffer, int n, int milliseconds)
 {
-  int totalNumberOfBytesRead = 0;
-  int totalNumberOfBytesToRead = numberOfBytesToRead;
-  int numberOfBytesRead;
-  bool binarySizeCalculated = false;
+  int trys = 0;
 
-  do
+  for (;;)
   {
-    int trys = 0;
-    numberOfBytesRead = recv(socket, reply + totalNumberOfBytesRead, numberOfBytesToRead, 0);
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(socket, &readable);
+    struct timeval tv;
+    tv.tv_sec = milliseconds / 1000;
+    tv.tv_usec = (milliseconds % 1000) * 1000;
+
+    int ready = select(0, &readable, NULL, NULL, &tv);
+    if (ready == 0)
+    {
+      // NDI handles 0 bytes returned as a timeout
+      return 0;
+    }
+    else if (ready == SOCKET_ERROR)
+    {
+      return -1;
+    }
 
+    int numberOfBytesRead = recv(socket, buffer, n, 0);
     if (numberOfBytesRead == SOCKET_ERROR)
     {
-      *outErrorCode = WSAGetLastError();
-      if ((*outErrorCode == WSAENOBUFS) && (trys++ < 1000))
+      if ((WSAGetLastError() == WSAENOBUFS) && (trys++ < 1000))
       {
         Sleep(1);
         continue;
       }
-      if (*outErrorCode == WSAETIMEDOUT)
-      {
-        // NDI handles 0 bytes returned as a timeout
-        return 0;
-      }
       return -1;
     }
     else if (numberOfBytesRead == 0)
     {
       // Connection has been closed
-      return 0;
-    }
-
-    totalNumberOfBytesRead += numberOfBytesRead;
-    if (!isBinary && reply[totalNumberOfBytesRead - 1] == '\r'       /* done when carriage return received (ASCII) or when ERROR... received (binary)*/
-        || isBinary && strncmp(reply, "ERROR", 5) == 0 && reply[totalNumberOfBytesRead - 1] == '\r')
-    {
-      break;
-    }
-
-    if (isBinary && !binarySizeCalculated && reply[0] == (char)0xc4 && reply[1] == (char)0xa5)
-    {
-      // recalculate n based on the reply length (reported from ndi device) and the amount of data received so far
-      unsigned short size = ((unsigned char)reply[2] | (unsigned char)reply[3] << 8) + 8; // 8 bytes -> 2 for Start Sequence (a5c4), 2 for reply length, 2 for header CRC, 2 for CRC16
-      totalNumberOfBytesToRead = size;
+      return -1;
     }
+    return numberOfBytesRead;
   }
-  while (totalNumberOfBytesRead != totalNumberOfBytesToRead);
-
-  return totalNumberOfBytesRead;
 }
 
 //----------------------------------------------------------------------------
@@ -0,0 +1,302 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// This file contains the built-in transports, which put the serial port
+// and the network behind the ndiTransport interface, and the list of
+// transports that ndiOpenTransport() chooses from.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ndicapi.h"
+#include "ndicapi_internal.h"
+#include "ndicapi_transport.h"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // The serial port, set to 9600 baud 8N1 when it is opened, as the device
+  // is after a reset
+  bool ndiSerialTransportOpen(ndicapi* pol, const char* address)
+  {
+    NDIFileHandle serialPort = ndiSerialOpen(address);
+    if (serialPort == NDI_INVALID_HANDLE)
+    {
+      return false;
+    }
+
+    if (ndiSerialComm(serialPort, 9600, "8N1", 0) < 0 || ndiSerialFlush(serialPort, NDI_IOFLUSH) < 0)
+    {
+      ndiSerialClose(serialPort);
+      return false;
+    }
+
+    if (pol->SerialDeviceName == NULL)
+    {
+      pol->SerialDeviceName = (char*)malloc(strlen(address) + 1);
+      if (pol->SerialDeviceName == NULL)
+      {
+        ndiSerialClose(serialPort);
+        return false;
+      }
+      strcpy(pol->SerialDeviceName, address);
+    }
+    pol->SerialDevice = serialPort;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiSerialTransportClose(ndicapi* pol)
+  {
+    ndiSerialClose(pol->SerialDevice);
+    pol->SerialDevice = NDI_INVALID_HANDLE;
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiSerialTransportWrite(ndicapi* pol, const char* data, int length)
+  {
+    return ndiSerialWrite(pol->SerialDevice, data, length);
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiSerialTransportReadSome(ndicapi* pol, char* buffer, int n, int expected, int milliseconds)
+  {
+    return ndiSerialReadSome(pol->SerialDevice, buffer, n, expected, milliseconds);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSerialTransportFlush(ndicapi* pol, int flushtype)
+  {
+    return (ndiSerialFlush(pol->SerialDevice, flushtype) >= 0);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSerialTransportSetTimeout(ndicapi* pol, int milliseconds)
+  {
+    return (ndiSerialTimeout(pol->SerialDevice, milliseconds) >= 0);
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiSerialTransportGetTimeout(ndicapi* pol)
+  {
+    return ndiSerialGetTimeout(pol->SerialDevice);
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiSerialTransportSleep(ndicapi* pol, int milliseconds)
+  {
+    ndiSerialSleep(pol->SerialDevice, milliseconds);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSerialTransportBreak(ndicapi* pol)
+  {
+    return (ndiSerialBreak(pol->SerialDevice) == 0);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSerialTransportComm(ndicapi* pol, int baud, const char* dps, int handshake)
+  {
+    return (ndiSerialComm(pol->SerialDevice, baud, dps, handshake) == 0);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSerialTransportLowLatency(ndicapi* pol, bool enable)
+  {
+    return (ndiSerialLowLatency(pol->SerialDevice, enable) == 0);
+  }
+
+  const ndiTransport ndiSerialTransport =
+  {
+    "serial",
+    &ndiSerialTransportOpen,
+    &ndiSerialTransportClose,
+    &ndiSerialTransportWrite,
+    &ndiSerialTransportReadSome,
+    &ndiSerialTransportFlush,
+    &ndiSerialTransportSetTimeout,
+    &ndiSerialTransportGetTimeout,
+    &ndiSerialTransportSleep,
+    &ndiSerialTransportBreak,
+    &ndiSerialTransportComm,
+    &ndiSerialTransportLowLatency
+  };
+
+  //----------------------------------------------------------------------------
+  // The network, at "host:port" or "[host]:port"
+  bool ndiSocketTransportOpen(ndicapi* pol, const char* address)
+  {
+    const char* colon = strrchr(address, ':');
+    if (colon == NULL)
+    {
+      return false;
+    }
+
+    char host[256];
+    const char* start = address;
+    const char* end = colon;
+    if (*start == '[' && end > start && end[-1] == ']')
+    {
+      start++;
+      end--;
+    }
+    if (end - start >= (int)sizeof(host))
+    {
+      return false;
+    }
+    memcpy(host, start, end - start);
+    host[end - start] = '\0';
+    int port = atoi(colon + 1);
+
+    NDISocketHandle socket;
+    if (!ndiSocketOpenTimeout(host, port, NDI_CONNECT_TIMEOUT_MS, socket))
+    {
+      return false;
+    }
+
+    if (pol->Hostname == NULL)
+    {
+      pol->Hostname = (char*)malloc(strlen(host) + 1);
+      if (pol->Hostname == NULL)
+      {
+        ndiSocketClose(socket);
+        return false;
+      }
+      strcpy(pol->Hostname, host);
+      pol->Port = port;
+    }
+    pol->Socket = socket;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiSocketTransportClose(ndicapi* pol)
+  {
+    ndiSocketClose(pol->Socket);
+    pol->Socket = -1;
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiSocketTransportWrite(ndicapi* pol, const char* data, int length)
+  {
+    return ndiSocketWrite(pol->Socket, data, length);
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiSocketTransportReadSome(ndicapi* pol, char* buffer, int n, int expected, int milliseconds)
+  {
+    return ndiSocketReadSome(pol->Socket, buffer, n, milliseconds);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSocketTransportFlush(ndicapi* pol, int flushtype)
+  {
+    return ndiSocketFlush(pol->Socket, flushtype);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiSocketTransportSetTimeout(ndicapi* pol, int milliseconds)
+  {
+    return ndiSocketTimeout(pol->Socket, milliseconds);
+  }
+
+  //----------------------------------------------------------------------------
+  int ndiSocketTransportGetTimeout(ndicapi* pol)
+  {
+    return ndiSocketGetTimeout(pol->Socket);
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiSocketTransportSleep(ndicapi* pol, int milliseconds)
+  {
+    ndiSocketSleep(pol->Socket, milliseconds);
+  }
+
+  const ndiTransport ndiSocketTransport =
+  {
+    "tcp",
+    &ndiSocketTransportOpen,
+    &ndiSocketTransportClose,
+    &ndiSocketTransportWrite,
+    &ndiSocketTransportReadSome,
+    &ndiSocketTransportFlush,
+    &ndiSocketTransportSetTimeout,
+    &ndiSocketTransportGetTimeout,
+    &ndiSocketTransportSleep,
+    NULL,
+    NULL,
+    NULL
+  };
+}
+
+#if defined(NDI_IO_URING) && defined(__linux__)
+  #include "ndicapi_transport_uring.cxx"
+#endif
+
+namespace
+{
+  // The transports that ndiOpenTransport() can find by name
+  const ndiTransport* ndiTransports[NDI_MAX_TRANSPORTS] =
+  {
+    &ndiSerialTransport,
+    &ndiSocketTransport,
+#if defined(NDI_IO_URING) && defined(__linux__)
+    &ndiUringSerialTransport,
+    &ndiUringSocketTransport
+#endif
+  };
+#if defined(NDI_IO_URING) && defined(__linux__)
+  int ndiNumberOfTransports = 4;
+#else
+  int ndiNumberOfTransports = 2;
+#endif
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport bool ndiRegisterTransport(const ndiTransport* transport)
+{
+  for (int i = 0; i < ndiNumberOfTransports; i++)
+  {
+    if (strcmp(ndiTransports[i]->Name, transport->Name) == 0)
+    {
+      ndiTransports[i] = transport;
+      return true;
+    }
+  }
+
+  if (ndiNumberOfTransports >= NDI_MAX_TRANSPORTS)
+  {
+    return false;
+  }
+  ndiTransports[ndiNumberOfTransports++] = transport;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport const ndiTransport* ndiFindTransport(const char* name)
+{
+  for (int i = 0; i < ndiNumberOfTransports; i++)
+  {
+    if (strcmp(ndiTransports[i]->Name, name) == 0)
+    {
+      return ndiTransports[i];
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport const ndiTransport* ndiGetSerialTransport()
+{
+  return &ndiSerialTransport;
+}
+
+//----------------------------------------------------------------------------
+ndicapiExport const ndiTransport* ndiGetSocketTransport()
+{
+  return &ndiSocketTransport;
+}
@@ -0,0 +1,109 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+/*! \file ndicapi_transport.h
+This file contains the interface through which the NDICAPI C API talks
+to the device, so that other ways of reaching a device can be used in
+place of the serial port and the network.
+*/
+
+#ifndef NDICAPI_TRANSPORT_H
+#define NDICAPI_TRANSPORT_H
+
+#include "ndicapiExport.h"
+
+struct ndicapi;
+
+/*=====================================================================*/
+/*! \defgroup NDITransport NDI Transport Methods
+A transport is a set of functions that move bytes to and from the
+device.  The serial port and the network are transports, and others can
+be registered, such as an in-memory loopback or the replay of a recorded
+session for testing.  The framing of the replies, the reconnect and the
+tracking thread are done by the NDICAPI on top of the transport.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \ingroup NDITransport
+The functions of a transport.  Each one is given the device handle, and
+a transport keeps its state in pol->TransportData, or for the built-in
+transports in pol->SerialDevice and pol->Socket.  The return values are
+as for the ndiSerial functions of the same name: ReadSome() returns zero
+on a timeout and a negative value when the link is lost, which starts a
+reconnect if ndiSetReconnectMode() is on.
+
+Break and Comm may be NULL for a transport that cannot send a break or
+has no baud rate.  A device that cannot be reset by a break is sent
+TSTOP instead after a reconnect.  LowLatency may be NULL for a transport
+that has no low-latency mode, see ndiSetSerialLowLatency().
+*/
+struct ndiTransport
+{
+  const char* Name;                       // the name for ndiOpenTransport(), e.g. "serial" or "tcp"
+
+  // open the transport at the given address, or return false
+  bool (*Open)(ndicapi* pol, const char* address);
+  void (*Close)(ndicapi* pol);
+
+  int (*Write)(ndicapi* pol, const char* data, int length);
+  // read up to n bytes that have arrived, waiting at most 'milliseconds' for
+  // the first one; 'expected' is the number of bytes known to be on their way
+  int (*ReadSome)(ndicapi* pol, char* buffer, int n, int expected, int milliseconds);
+  bool (*Flush)(ndicapi* pol, int flushtype);
+  bool (*SetTimeout)(ndicapi* pol, int milliseconds);
+  int (*GetTimeout)(ndicapi* pol);
+  // also called while the transport is closed, between reconnect attempts
+  void (*Sleep)(ndicapi* pol, int milliseconds);
+
+  bool (*Break)(ndicapi* pol);
+  bool (*Comm)(ndicapi* pol, int baud, const char* dps, int handshake);
+  bool (*LowLatency)(ndicapi* pol, bool enable);
+};
+
+#define NDI_MAX_TRANSPORTS 16
+
+/*! \ingroup NDITransport
+Make a transport available to ndiOpenTransport() under its name.  A
+transport with the same name, including a built-in one, is replaced.
+The structure must stay valid for as long as it is in use.  Transports
+should be registered before devices are opened from other threads.
+
+\return false if NDI_MAX_TRANSPORTS are already registered
+*/
+ndicapiExport bool ndiRegisterTransport(const ndiTransport* transport);
+
+/*! \ingroup NDITransport
+Find a transport by name.  "serial" and "tcp" are built in.  On linux,
+when ndicapi is built with ndicapi_USE_IO_URING, "serial-uring" and
+"tcp-uring" are also built in: they take the same addresses, and use
+io_uring to send each command in the same system call that waits for its
+reply.  Their Open fails on kernels older than 6.0.
+
+\return the transport, or NULL if there is none with that name
+*/
+ndicapiExport const ndiTransport* ndiFindTransport(const char* name);
+
+/*! \ingroup NDITransport
+The built-in serial transport, whose address is a serial port device
+name.  A transport that wraps it, e.g. to record a session, can call
+its functions.
+*/
+ndicapiExport const ndiTransport* ndiGetSerialTransport();
+
+/*! \ingroup NDITransport
+The built-in network transport, whose address is "host:port", with an
+IPv6 host in square brackets.
+*/
+ndicapiExport const ndiTransport* ndiGetSocketTransport();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
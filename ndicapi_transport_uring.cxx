@@ -0,0 +1,672 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.md for details.
+=========================================================Plus=header=end*/
+
+// The io_uring transports for linux, "serial-uring" and "tcp-uring".  This
+// file is included by ndicapi_transport.cxx when ndicapi is built with
+// ndicapi_USE_IO_URING.  The ring is set up with the system calls and the
+// kernel header, liburing is not needed.
+//
+// A command is queued by Write() and goes to the kernel together with the
+// wait for its reply, in a single io_uring_enter().  On a socket a multishot
+// receive stays armed and fills a ring of registered buffers as the data
+// arrives, so a reply that is already there, e.g. the next frame of a
+// stream, is read without any system call, and a flush of the input only
+// throws away what was received.  A serial port is read into a registered
+// buffer, with a linked timeout.
+
+#include <chrono>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+// enough entries for a command, its reply and the timeout of the reply
+#define NDI_URING_ENTRIES 16
+
+// the buffers that the multishot receive of a socket fills, a power of two
+#define NDI_URING_BUFFERS 64
+#define NDI_URING_BUFFER_SIZE 16384
+
+// the registered buffer that a serial port is read into
+#define NDI_URING_READ_SIZE 65536
+
+namespace
+{
+  // what each completion is for
+  enum
+  {
+    NDI_URING_SEND = 1,
+    NDI_URING_RECEIVE,
+    NDI_URING_READ,
+    NDI_URING_TIMEOUT
+  };
+
+  // data from the multishot receive that has not been read yet
+  struct ndiUringChunk
+  {
+    unsigned short Buffer;
+    int Start;
+    int Length;
+  };
+
+  struct ndiUring
+  {
+    int RingFd;
+    int Fd;                                 // the serial port or the socket
+    bool IsSocket;
+
+    // the rings that are shared with the kernel
+    void* Ring;
+    size_t RingSize;
+    io_uring_sqe* Sqes;
+    size_t SqesSize;
+    unsigned SqEntries;
+    unsigned* SqHead;
+    unsigned* SqTail;
+    unsigned SqMask;
+    unsigned* SqArray;
+    unsigned SqLocalTail;                   // entries before this one are prepared
+    unsigned* CqHead;
+    unsigned* CqTail;
+    unsigned CqMask;
+    io_uring_cqe* Cqes;
+
+    char* SendBuffer;                       // a copy of the command, until it is sent
+    int SendSize;
+    int SendsInFlight;
+    bool Failed;                            // a send or a receive failed, or the peer closed
+
+    // for a socket, the provided buffers and what they hold
+    io_uring_buf_ring* BufferRing;
+    size_t BufferRingSize;
+    unsigned short BufferTail;
+    char* Buffers;
+    bool IsReceiving;                       // the multishot receive is armed
+    ndiUringChunk Pending[NDI_URING_BUFFERS];
+    int PendingFirst;
+    int PendingCount;
+
+    // for a serial port, the registered buffer and the reply timeout
+    char* ReadBuffer;
+    __kernel_timespec ReadTimeout;
+    bool IsReadDone;
+    int ReadResult;
+  };
+
+  //----------------------------------------------------------------------------
+  // Submit the prepared entries, and wait for at least 'minComplete'
+  // completions for at most 'milliseconds', or without a limit if it is
+  // negative.  The return value is zero, or minus the errno.
+  int ndiUringEnter(ndiUring* u, unsigned minComplete, int milliseconds)
+  {
+    unsigned toSubmit = u->SqLocalTail - __atomic_load_n(u->SqHead, __ATOMIC_ACQUIRE);
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    void* argp = NULL;
+    size_t argSize = 0;
+
+    if (minComplete > 0)
+    {
+      flags |= IORING_ENTER_GETEVENTS;
+      if (milliseconds >= 0)
+      {
+        ts.tv_sec = milliseconds / 1000;
+        ts.tv_nsec = (milliseconds % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (__u64)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argSize = sizeof(arg);
+      }
+    }
+    else if (toSubmit == 0)
+    {
+      return 0;
+    }
+
+    if (syscall(__NR_io_uring_enter, u->RingFd, toSubmit, minComplete, flags, argp, argSize) < 0)
+    {
+      return -errno;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Get a cleared submission entry, which is queued by ndiUringQueue()
+  io_uring_sqe* ndiUringGetSqe(ndiUring* u)
+  {
+    if (u->SqLocalTail - __atomic_load_n(u->SqHead, __ATOMIC_ACQUIRE) >= u->SqEntries)
+    {
+      // the queue is full, which a command and its reply never fill
+      ndiUringEnter(u, 0, -1);
+    }
+    io_uring_sqe* sqe = &u->Sqes[u->SqLocalTail & u->SqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiUringQueue(ndiUring* u)
+  {
+    unsigned index = u->SqLocalTail & u->SqMask;
+    u->SqArray[index] = index;
+    u->SqLocalTail++;
+    __atomic_store_n(u->SqTail, u->SqLocalTail, __ATOMIC_RELEASE);
+  }
+
+  //----------------------------------------------------------------------------
+  // Give a buffer back to the multishot receive
+  void ndiUringRecycle(ndiUring* u, unsigned short buffer)
+  {
+    // not through bufs[], which the kernel header declares in a way that
+    // moves it in C++
+    io_uring_buf* b = (io_uring_buf*)u->BufferRing + (u->BufferTail & (NDI_URING_BUFFERS - 1));
+    b->addr = (__u64)(uintptr_t)(u->Buffers + (size_t)buffer * NDI_URING_BUFFER_SIZE);
+    b->len = NDI_URING_BUFFER_SIZE;
+    b->bid = buffer;
+    u->BufferTail++;
+    __atomic_store_n(&u->BufferRing->tail, u->BufferTail, __ATOMIC_RELEASE);
+  }
+
+  //----------------------------------------------------------------------------
+  // Go through the completions, which are in memory and need no system call
+  void ndiUringReap(ndiUring* u)
+  {
+    unsigned head = *u->CqHead;
+    unsigned tail = __atomic_load_n(u->CqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+      const io_uring_cqe* cqe = &u->Cqes[head & u->CqMask];
+      switch (cqe->user_data)
+      {
+        case NDI_URING_SEND:
+          u->SendsInFlight--;
+          if (cqe->res < 0)
+          {
+            u->Failed = true;
+          }
+          break;
+        case NDI_URING_RECEIVE:
+          if (cqe->flags & IORING_CQE_F_BUFFER)
+          {
+            unsigned short buffer = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe->res > 0)
+            {
+              ndiUringChunk& chunk = u->Pending[(u->PendingFirst + u->PendingCount) % NDI_URING_BUFFERS];
+              chunk.Buffer = buffer;
+              chunk.Start = 0;
+              chunk.Length = cqe->res;
+              u->PendingCount++;
+            }
+            else
+            {
+              ndiUringRecycle(u, buffer);
+            }
+          }
+          if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED))
+          {
+            // the connection was closed or broken; without buffers, or when
+            // the thread that armed the receive has exited, it is armed
+            // again by the next read
+            u->Failed = true;
+          }
+          if (!(cqe->flags & IORING_CQE_F_MORE))
+          {
+            u->IsReceiving = false;
+          }
+          break;
+        case NDI_URING_READ:
+          u->IsReadDone = true;
+          u->ReadResult = cqe->res;
+          break;
+        default:
+          break;
+      }
+    }
+
+    __atomic_store_n(u->CqHead, head, __ATOMIC_RELEASE);
+  }
+
+  //----------------------------------------------------------------------------
+  // Copy received data out of the provided buffers, and give back the
+  // buffers that have been emptied
+  int ndiUringCopy(ndiUring* u, char* buffer, int n)
+  {
+    int total = 0;
+    while (u->PendingCount > 0 && total < n)
+    {
+      ndiUringChunk& chunk = u->Pending[u->PendingFirst];
+      int m = (chunk.Length < n - total ? chunk.Length : n - total);
+      memcpy(buffer + total, u->Buffers + (size_t)chunk.Buffer * NDI_URING_BUFFER_SIZE + chunk.Start, m);
+      total += m;
+      chunk.Start += m;
+      chunk.Length -= m;
+      if (chunk.Length == 0)
+      {
+        ndiUringRecycle(u, chunk.Buffer);
+        u->PendingFirst = (u->PendingFirst + 1) % NDI_URING_BUFFERS;
+        u->PendingCount--;
+      }
+    }
+    return total;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiUringDestroy(ndiUring* u)
+  {
+    // closing the ring cancels whatever is still in flight
+    close(u->RingFd);
+    if (u->Ring != MAP_FAILED)
+    {
+      munmap(u->Ring, u->RingSize);
+    }
+    if (u->Sqes != MAP_FAILED)
+    {
+      munmap(u->Sqes, u->SqesSize);
+    }
+    if (u->BufferRing != MAP_FAILED)
+    {
+      munmap(u->BufferRing, u->BufferRingSize);
+    }
+    free(u->Buffers);
+    free(u->ReadBuffer);
+    free(u->SendBuffer);
+    free(u);
+  }
+
+  //----------------------------------------------------------------------------
+  // Set up a ring for a serial port or a socket.  This needs linux 6.0 for
+  // the multishot receive, and returns NULL on older kernels.
+  ndiUring* ndiUringCreate(int fd, bool isSocket)
+  {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ringFd = (int)syscall(__NR_io_uring_setup, NDI_URING_ENTRIES, &params);
+    if (ringFd < 0)
+    {
+      return NULL;
+    }
+
+    ndiUring* u = (ndiUring*)calloc(1, sizeof(ndiUring));
+    if (u == NULL)
+    {
+      close(ringFd);
+      return NULL;
+    }
+    u->RingFd = ringFd;
+    u->Fd = fd;
+    u->IsSocket = isSocket;
+    u->Ring = MAP_FAILED;
+    u->Sqes = (io_uring_sqe*)MAP_FAILED;
+    u->BufferRing = (io_uring_buf_ring*)MAP_FAILED;
+
+    // the waits have a timeout, and the rings are in one mapping
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+      ndiUringDestroy(u);
+      return NULL;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    u->RingSize = (sqSize > cqSize ? sqSize : cqSize);
+    u->Ring = mmap(NULL, u->RingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    u->SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    u->Sqes = (io_uring_sqe*)mmap(NULL, u->SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (u->Ring == MAP_FAILED || u->Sqes == MAP_FAILED)
+    {
+      ndiUringDestroy(u);
+      return NULL;
+    }
+
+    char* ring = (char*)u->Ring;
+    u->SqEntries = params.sq_entries;
+    u->SqHead = (unsigned*)(ring + params.sq_off.head);
+    u->SqTail = (unsigned*)(ring + params.sq_off.tail);
+    u->SqMask = *(unsigned*)(ring + params.sq_off.ring_mask);
+    u->SqArray = (unsigned*)(ring + params.sq_off.array);
+    u->SqLocalTail = *u->SqTail;
+    u->CqHead = (unsigned*)(ring + params.cq_off.head);
+    u->CqTail = (unsigned*)(ring + params.cq_off.tail);
+    u->CqMask = *(unsigned*)(ring + params.cq_off.ring_mask);
+    u->Cqes = (io_uring_cqe*)(ring + params.cq_off.cqes);
+
+    if (isSocket)
+    {
+      // the ring of buffers must be page aligned
+      u->BufferRingSize = NDI_URING_BUFFERS * sizeof(io_uring_buf);
+      u->BufferRing = (io_uring_buf_ring*)mmap(NULL, u->BufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      u->Buffers = (char*)malloc((size_t)NDI_URING_BUFFERS * NDI_URING_BUFFER_SIZE);
+      if (u->BufferRing == MAP_FAILED || u->Buffers == NULL)
+      {
+        ndiUringDestroy(u);
+        return NULL;
+      }
+
+      io_uring_buf_reg reg;
+      memset(&reg, 0, sizeof(reg));
+      reg.ring_addr = (__u64)(uintptr_t)u->BufferRing;
+      reg.ring_entries = NDI_URING_BUFFERS;
+      reg.bgid = 0;
+      if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+      {
+        ndiUringDestroy(u);
+        return NULL;
+      }
+      for (unsigned short i = 0; i < NDI_URING_BUFFERS; i++)
+      {
+        ndiUringRecycle(u, i);
+      }
+    }
+    else
+    {
+      u->ReadBuffer = (char*)malloc(NDI_URING_READ_SIZE);
+      struct iovec iov;
+      iov.iov_base = u->ReadBuffer;
+      iov.iov_len = NDI_URING_READ_SIZE;
+      if (u->ReadBuffer == NULL || syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, &iov, 1) < 0)
+      {
+        ndiUringDestroy(u);
+        return NULL;
+      }
+    }
+
+    return u;
+  }
+
+  //----------------------------------------------------------------------------
+  // Queue a write of the command, which is sent along with the wait for
+  // the reply.  The command is copied, because the caller's buffer may be
+  // gone by then.
+  int ndiUringWrite(ndicapi* pol, const char* data, int length)
+  {
+    ndiUring* u = (ndiUring*)pol->TransportData;
+
+    // the send buffer is in use until the previous command has been sent
+    while (u->SendsInFlight > 0 && !u->Failed)
+    {
+      int r = ndiUringEnter(u, 1, -1);
+      if (r < 0 && r != -EINTR)
+      {
+        return -1;
+      }
+      ndiUringReap(u);
+    }
+    if (u->Failed)
+    {
+      return -1;
+    }
+
+    if (length > u->SendSize)
+    {
+      char* buffer = (char*)realloc(u->SendBuffer, length);
+      if (buffer == NULL)
+      {
+        return -1;
+      }
+      u->SendBuffer = buffer;
+      u->SendSize = length;
+    }
+    memcpy(u->SendBuffer, data, length);
+
+    io_uring_sqe* sqe = ndiUringGetSqe(u);
+    if (u->IsSocket)
+    {
+      sqe->opcode = IORING_OP_SEND;
+      sqe->msg_flags = MSG_NOSIGNAL;
+    }
+    else
+    {
+      sqe->opcode = IORING_OP_WRITE;
+      sqe->off = (__u64) - 1;
+    }
+    sqe->fd = u->Fd;
+    sqe->addr = (__u64)(uintptr_t)u->SendBuffer;
+    sqe->len = length;
+    sqe->user_data = NDI_URING_SEND;
+    ndiUringQueue(u);
+    u->SendsInFlight++;
+
+    return length;
+  }
+
+  //----------------------------------------------------------------------------
+  // The serial port, as for the built-in transport apart from the reads
+  // and writes
+  bool ndiUringSerialOpen(ndicapi* pol, const char* address)
+  {
+    if (!ndiSerialTransportOpen(pol, address))
+    {
+      return false;
+    }
+
+    ndiUring* u = ndiUringCreate(pol->SerialDevice, false);
+    if (u == NULL)
+    {
+      ndiSerialTransportClose(pol);
+      return false;
+    }
+    pol->TransportData = u;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiUringSerialClose(ndicapi* pol)
+  {
+    ndiUringDestroy((ndiUring*)pol->TransportData);
+    pol->TransportData = NULL;
+    ndiSerialTransportClose(pol);
+  }
+
+  //----------------------------------------------------------------------------
+  // The queued command, the read and its timeout are submitted at once
+  int ndiUringSerialReadSome(ndicapi* pol, char* buffer, int n, int expected, int milliseconds)
+  {
+    ndiUring* u = (ndiUring*)pol->TransportData;
+    if (u->Failed)
+    {
+      return -1;
+    }
+
+    io_uring_sqe* sqe = ndiUringGetSqe(u);
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = u->Fd;
+    sqe->off = (__u64) - 1;
+    sqe->addr = (__u64)(uintptr_t)u->ReadBuffer;
+    sqe->len = (n < NDI_URING_READ_SIZE ? n : NDI_URING_READ_SIZE);
+    sqe->buf_index = 0;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = NDI_URING_READ;
+    ndiUringQueue(u);
+
+    u->ReadTimeout.tv_sec = milliseconds / 1000;
+    u->ReadTimeout.tv_nsec = (milliseconds % 1000) * 1000000;
+    sqe = ndiUringGetSqe(u);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (__u64)(uintptr_t)&u->ReadTimeout;
+    sqe->len = 1;
+    sqe->user_data = NDI_URING_TIMEOUT;
+    ndiUringQueue(u);
+
+    u->IsReadDone = false;
+    while (!u->IsReadDone)
+    {
+      int r = ndiUringEnter(u, 1, -1);
+      if (r < 0 && r != -EINTR)
+      {
+        return -1;
+      }
+      ndiUringReap(u);
+    }
+
+    if (u->Failed)
+    {
+      return -1;
+    }
+    if (u->ReadResult > 0)
+    {
+      memcpy(buffer, u->ReadBuffer, u->ReadResult);
+      return u->ReadResult;
+    }
+    if (u->ReadResult == 0)
+    {
+      // nothing to read, or the port has gone away
+      struct pollfd pfd;
+      pfd.fd = u->Fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      return (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) ? -1 : 0);
+    }
+    // cancelled by the timeout
+    return (u->ReadResult == -ECANCELED || u->ReadResult == -EINTR ? 0 : -1);
+  }
+
+  //----------------------------------------------------------------------------
+  bool ndiUringSerialFlush(ndicapi* pol, int flushtype)
+  {
+    ndiUringReap((ndiUring*)pol->TransportData);
+    return ndiSerialTransportFlush(pol, flushtype);
+  }
+
+  const ndiTransport ndiUringSerialTransport =
+  {
+    "serial-uring",
+    &ndiUringSerialOpen,
+    &ndiUringSerialClose,
+    &ndiUringWrite,
+    &ndiUringSerialReadSome,
+    &ndiUringSerialFlush,
+    &ndiSerialTransportSetTimeout,
+    &ndiSerialTransportGetTimeout,
+    &ndiSerialTransportSleep,
+    &ndiSerialTransportBreak,
+    &ndiSerialTransportComm,
+    &ndiSerialTransportLowLatency
+  };
+
+  //----------------------------------------------------------------------------
+  // The network, as for the built-in transport apart from the reads and
+  // writes
+  bool ndiUringSocketOpen(ndicapi* pol, const char* address)
+  {
+    if (!ndiSocketTransportOpen(pol, address))
+    {
+      return false;
+    }
+
+    ndiUring* u = ndiUringCreate(pol->Socket, true);
+    if (u == NULL)
+    {
+      ndiSocketTransportClose(pol);
+      return false;
+    }
+    pol->TransportData = u;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void ndiUringSocketClose(ndicapi* pol)
+  {
+    ndiUringDestroy((ndiUring*)pol->TransportData);
+    pol->TransportData = NULL;
+    ndiSocketTransportClose(pol);
+  }
+
+  //----------------------------------------------------------------------------
+  // Data that has already been received is returned at once.  Otherwise the
+  // queued command is submitted, and the receive armed if it is not, in
+  // the same system call that waits for the reply.
+  int ndiUringSocketReadSome(ndicapi* pol, char* buffer, int n, int expected, int milliseconds)
+  {
+    ndiUring* u = (ndiUring*)pol->TransportData;
+    std::chrono::steady_clock::time_point deadline = ndiDeadline(milliseconds);
+
+    for (;;)
+    {
+      ndiUringReap(u);
+      if (u->PendingCount > 0)
+      {
+        // a command that is still queued must not wait for the next read
+        ndiUringEnter(u, 0, -1);
+        return ndiUringCopy(u, buffer, n);
+      }
+      if (u->Failed)
+      {
+        return -1;
+      }
+
+      if (!u->IsReceiving)
+      {
+        io_uring_sqe* sqe = ndiUringGetSqe(u);
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = u->Fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        sqe->user_data = NDI_URING_RECEIVE;
+        ndiUringQueue(u);
+        u->IsReceiving = true;
+      }
+
+      int r = ndiUringEnter(u, 1, ndiMillisecondsLeft(deadline));
+      if (r == -ETIME)
+      {
+        ndiUringReap(u);
+        if (u->PendingCount == 0)
+        {
+          // NDI handles 0 bytes returned as a timeout
+          return (u->Failed ? -1 : 0);
+        }
+      }
+      else if (r < 0 && r != -EINTR)
+      {
+        return -1;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // What has been received is thrown away, there is nothing else to drain
+  bool ndiUringSocketFlush(ndicapi* pol, int flushtype)
+  {
+    ndiUring* u = (ndiUring*)pol->TransportData;
+    ndiUringReap(u);
+    if (flushtype & NDI_IFLUSH)
+    {
+      while (u->PendingCount > 0)
+      {
+        ndiUringRecycle(u, u->Pending[u->PendingFirst].Buffer);
+        u->PendingFirst = (u->PendingFirst + 1) % NDI_URING_BUFFERS;
+        u->PendingCount--;
+      }
+    }
+    return !u->Failed;
+  }
+
+  const ndiTransport ndiUringSocketTransport =
+  {
+    "tcp-uring",
+    &ndiUringSocketOpen,
+    &ndiUringSocketClose,
+    &ndiUringWrite,
+    &ndiUringSocketReadSome,
+    &ndiUringSocketFlush,
+    &ndiSocketTransportSetTimeout,
+    &ndiSocketTransportGetTimeout,
+    &ndiSocketTransportSleep,
+    NULL,
+    NULL,
+    NULL
+  };
+}
@@ -671,7 +671,11 @@ static PyObject* Py_ndiClose(PyObject* module, PyObject* args)
 
   if (PyArg_ParseTuple(args, "O&:plClose", &_ndiConverter, &pol))
   {
-    ndiSerialClose(pol->SerialDevice);
+    if (pol->IsTransportOpen)
+    {
+      pol->Transport->Close(pol);
+      pol->IsTransportOpen = false;
+    }
     Py_INCREF(Py_None);
     return Py_None;
   }